@@ -0,0 +1,23 @@
+LIBMOWGLI_SHARED_LIB = libmowgli-2.so
+LIBMOWGLI_STATIC_LIB = 
+LIBMOWGLI_MODULES = core base container dns eventloop ext linebuf module object platform thread vio
+LIBMOWGLI_SHARED_MODULES =  core/mowgli.core.lib.a base/mowgli.base.lib.a container/mowgli.container.lib.a dns/mowgli.dns.lib.a eventloop/mowgli.eventloop.lib.a ext/mowgli.ext.lib.a linebuf/mowgli.linebuf.lib.a module/mowgli.module.lib.a object/mowgli.object.lib.a platform/mowgli.platform.lib.a thread/mowgli.thread.lib.a vio/mowgli.vio.lib.a
+LIBMOWGLI_STATIC_MODULES = 
+LIBMOWGLI_OS = posix
+
+EXAMPLES_BUILD = examples
+
+LIBMOWGLI_MODULE_BUILD = 
+LIBMOWGLI_SHARED_CORE = mowgli.core.lib.a
+LIBMOWGLI_SHARED_BASE = mowgli.base.lib.a
+LIBMOWGLI_SHARED_CONTAINER = mowgli.container.lib.a
+LIBMOWGLI_SHARED_DNS = mowgli.dns.lib.a
+LIBMOWGLI_SHARED_EVENTLOOP = mowgli.eventloop.lib.a
+LIBMOWGLI_SHARED_EXT = mowgli.ext.lib.a
+LIBMOWGLI_SHARED_LINEBUF = mowgli.linebuf.lib.a
+LIBMOWGLI_SHARED_MODULE = mowgli.module.lib.a
+LIBMOWGLI_SHARED_OBJECT = mowgli.object.lib.a
+LIBMOWGLI_SHARED_PLATFORM = mowgli.platform.lib.a
+LIBMOWGLI_SHARED_THREAD = mowgli.thread.lib.a
+LIBMOWGLI_SHARED_VIO = mowgli.vio.lib.a
+
@@ -0,0 +1,226 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * busypoll-bench.c: Ping-pong wakeup latency with and without busy-polling
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Two processes bounce a byte across a socketpair, each running its own
+ * eventloop.  Every round trip costs two wakeups, so the round trip time is a
+ * direct measure of how long the loop takes to notice readiness.  The run is
+ * repeated with busy-polling disabled and enabled and the percentiles of both
+ * are printed side by side.
+ */
+
+#include <mowgli.h>
+
+static int rounds = 100000;
+static unsigned int spin_usec = 50;
+
+static long long *samples;
+static int sample_count;
+static long long sent_at;
+static double child_cpu;
+
+static long long
+now_usec(void)
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return (long long) tp.tv_sec * 1000000 + tp.tv_nsec / 1000;
+}
+
+static void
+echo_read(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_pollable_t *pollable = mowgli_eventloop_io_pollable(io);
+	char buf[64];
+	ssize_t r;
+
+	if ((r = read(pollable->fd, buf, sizeof buf)) <= 0)
+	{
+		mowgli_eventloop_break(eventloop);
+		return;
+	}
+
+	if (write(pollable->fd, buf, r) != r)
+		mowgli_eventloop_break(eventloop);
+}
+
+static void
+ping_read(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_pollable_t *pollable = mowgli_eventloop_io_pollable(io);
+	char c;
+
+	if (read(pollable->fd, &c, 1) != 1)
+	{
+		mowgli_eventloop_break(eventloop);
+		return;
+	}
+
+	samples[sample_count++] = now_usec() - sent_at;
+
+	if (sample_count == rounds)
+	{
+		mowgli_eventloop_break(eventloop);
+		return;
+	}
+
+	sent_at = now_usec();
+
+	if (write(pollable->fd, "p", 1) != 1)
+		mowgli_eventloop_break(eventloop);
+}
+
+static void
+run_loop(int fd, mowgli_eventloop_io_cb_t *cb, unsigned int busypoll)
+{
+	mowgli_eventloop_t *eventloop;
+	mowgli_eventloop_pollable_t *pollable;
+
+	eventloop = mowgli_eventloop_create();
+	mowgli_eventloop_set_busypoll(eventloop, busypoll);
+
+	pollable = mowgli_pollable_create(eventloop, fd, NULL);
+	mowgli_pollable_set_nonblocking(pollable, true);
+	mowgli_pollable_setselect(eventloop, pollable, MOWGLI_EVENTLOOP_IO_READ, cb);
+
+	if (cb == ping_read)
+	{
+		sent_at = now_usec();
+
+		if (write(fd, "p", 1) != 1)
+			return;
+	}
+
+	mowgli_eventloop_run(eventloop);
+
+	mowgli_pollable_destroy(eventloop, pollable);
+	mowgli_eventloop_destroy(eventloop);
+}
+
+static int
+compare_samples(const void *a, const void *b)
+{
+	long long x = *(const long long *) a, y = *(const long long *) b;
+
+	return (x > y) - (x < y);
+}
+
+static long long
+percentile(double p)
+{
+	int idx = (int) (p * (sample_count - 1));
+
+	return samples[idx];
+}
+
+static void
+run_phase(const char *name, unsigned int busypoll)
+{
+	int fds[2];
+	pid_t pid;
+	struct rusage ru;
+	double cpu;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	if ((pid = fork()) == -1)
+	{
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pid == 0)
+	{
+		close(fds[0]);
+		run_loop(fds[1], echo_read, busypoll);
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(fds[1]);
+
+	sample_count = 0;
+	run_loop(fds[0], ping_read, busypoll);
+
+	close(fds[0]);
+	waitpid(pid, NULL, 0);
+
+	getrusage(RUSAGE_CHILDREN, &ru);
+	cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+	cpu -= child_cpu;
+	child_cpu += cpu;
+
+	qsort(samples, sample_count, sizeof *samples, compare_samples);
+
+	printf("%-10s %8d %8lld %8lld %8lld %8lld %10.2f\n", name, sample_count,
+	       percentile(0.50), percentile(0.90), percentile(0.99), samples[sample_count - 1], cpu);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "n:s:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			spin_usec = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n rounds] [-s max spin usec]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (rounds <= 0 || spin_usec == 0)
+	{
+		fprintf(stderr, "rounds and spin window must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	mowgli_thread_set_policy(MOWGLI_THREAD_POLICY_DISABLED);
+
+	samples = mowgli_alloc_array(sizeof *samples, rounds);
+
+	printf("round trip latency over %d ping-pongs, usec (busypoll window %u usec)\n", rounds, spin_usec);
+	if (sysconf(_SC_NPROCESSORS_ONLN) == 1)
+		printf("note: uniprocessor system, the library will not busy-poll\n");
+
+	printf("%-10s %8s %8s %8s %8s %8s %10s\n", "mode", "samples", "p50", "p90", "p99", "max", "child cpu");
+
+	run_phase("blocking", 0);
+	run_phase("busypoll", spin_usec);
+
+	mowgli_free(samples);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,289 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * connect-storm.c: Accepting a flood of connections, one or many at a time.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+#include <poll.h>
+
+/* A child process keeps -w connects to a loopback listener under way for
+ * -d seconds, starting another each time one is hung up on.  The listener
+ * takes each connection into a VIO, attaches it to the eventloop, and
+ * resets it, two ways:
+ *
+ *   single  mowgli_vio_accept() once per readiness event, as before
+ *   batch   mowgli_vio_acceptmany() until none are waiting or -b are taken
+ *
+ * The loop sleeps -p usec a round to stand in for the rest of a busy
+ * server's work, so that connections queue up between rounds as they do in
+ * a real storm.  CPU is the listener's alone.  Resetting rather than
+ * closing leaves no TIME_WAIT behind to run the client out of ports.
+ */
+
+static double duration = 2;
+static int window = 256, budget = 64, pause_usec = 1000;
+
+static mowgli_eventloop_t *base_eventloop;
+static mowgli_vio_t *listener;
+static mowgli_vio_sockaddr_t listen_addr;
+static mowgli_vio_evops_t listener_evops;
+
+static mowgli_vio_t **spares;
+static uint64_t accepted, wakeups;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double
+cpu(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/* The clients: connect, wait to be hung up on, go again */
+static void
+storm(void)
+{
+	struct pollfd *fds = mowgli_alloc_array(sizeof *fds, window);
+	int i, n;
+	char c;
+
+	for (i = 0; i < window; i++)
+		fds[i].fd = -1;
+
+	while (true)
+	{
+		for (i = 0; i < window; i++)
+		{
+			if (fds[i].fd != -1)
+				continue;
+
+			if ((fds[i].fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+				_exit(EXIT_FAILURE);
+
+			fcntl(fds[i].fd, F_SETFL, O_NONBLOCK);
+			fds[i].events = POLLIN;
+
+			if ((connect(fds[i].fd, (struct sockaddr *) &listen_addr.addr, listen_addr.addrlen) == -1) &&
+			    (errno != EINPROGRESS))
+			{
+				close(fds[i].fd);
+				fds[i].fd = -1;
+			}
+		}
+
+		if ((n = poll(fds, window, 1000)) <= 0)
+			continue;
+
+		for (i = 0; i < window; i++)
+		{
+			if ((fds[i].fd == -1) || (fds[i].revents == 0))
+				continue;
+
+			if (read(fds[i].fd, &c, 1) > 0)
+				continue;
+
+			close(fds[i].fd);
+			fds[i].fd = -1;
+		}
+	}
+}
+
+static void
+reset(mowgli_vio_t *vio)
+{
+	struct linger linger = { 1, 0 };
+
+	mowgli_vio_eventloop_attach(vio, base_eventloop, NULL);
+	setsockopt(mowgli_vio_getfd(vio), SOL_SOCKET, SO_LINGER, &linger, sizeof linger);
+	mowgli_vio_destroy(vio);
+}
+
+static void
+accept_single(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	wakeups++;
+
+	if (spares[0] == NULL)
+		spares[0] = mowgli_vio_create(NULL);
+
+	if ((mowgli_vio_accept(listener, spares[0]) != 0) || (mowgli_vio_getfd(spares[0]) == -1))
+		return;
+
+	reset(spares[0]);
+	spares[0] = NULL;
+	accepted++;
+}
+
+static void
+accept_batch(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	int i, n;
+
+	wakeups++;
+
+	for (i = 0; i < budget; i++)
+		if (spares[i] == NULL)
+			spares[i] = mowgli_vio_create(NULL);
+
+	if ((n = mowgli_vio_acceptmany(listener, spares, budget)) <= 0)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		reset(spares[i]);
+		spares[i] = NULL;
+	}
+
+	accepted += n;
+}
+
+static void
+bench(const char *name, mowgli_eventloop_io_cb_t *cb)
+{
+	double start, secs, cpu_start;
+	pid_t pid;
+
+	if ((pid = fork()) == -1)
+	{
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pid == 0)
+		storm();
+
+	listener_evops.read_cb = cb;
+	mowgli_pollable_setselect(base_eventloop, listener->io.e, MOWGLI_EVENTLOOP_IO_READ, cb);
+
+	accepted = wakeups = 0;
+	start = now();
+	cpu_start = cpu();
+
+	while (now() - start < duration)
+	{
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+		if (pause_usec > 0)
+			usleep(pause_usec);
+	}
+
+	secs = now() - start;
+	cpu_start = cpu() - cpu_start;
+
+	mowgli_pollable_setselect(base_eventloop, listener->io.e, MOWGLI_EVENTLOOP_IO_READ, NULL);
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+
+	printf("%-7s %9.0f conns/s  %6.2f usec CPU/conn  %6.1f conns/wakeup\n", name, accepted / secs,
+	       accepted ? cpu_start * 1e6 / accepted : 0.0, wakeups ? (double) accepted / wakeups : 0.0);
+
+	/* drain whatever the storm left behind */
+	while (accepted > 0)
+	{
+		accepted = 0;
+		accept_batch(base_eventloop, listener->io.e, MOWGLI_EVENTLOOP_IO_READ, NULL);
+	}
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: connect-storm [-w connects in flight] [-b budget] [-p usec] [-d seconds]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof ss;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "w:b:p:d:")) != -1)
+	{
+		switch (c)
+		{
+		case 'w':
+			window = atoi(optarg);
+			break;
+		case 'b':
+			budget = atoi(optarg);
+			break;
+		case 'p':
+			pause_usec = atoi(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((window <= 0) || (budget <= 0) || (pause_usec < 0) || (duration <= 0))
+		usage();
+
+	base_eventloop = mowgli_eventloop_create();
+	listener = mowgli_vio_create(NULL);
+
+	if ((mowgli_vio_socket(listener, AF_INET, SOCK_STREAM, 0) != 0) ||
+	    (mowgli_vio_reuseaddr(listener) != 0) ||
+	    (mowgli_vio_bind(listener, mowgli_vio_sockaddr_create(&listen_addr, AF_INET, "127.0.0.1", 0)) != 0) ||
+	    (mowgli_vio_listen(listener, SOMAXCONN) != 0))
+	{
+		fprintf(stderr, "listener: %s\n", listener->error.string);
+		return EXIT_FAILURE;
+	}
+
+	getsockname(mowgli_vio_getfd(listener), (struct sockaddr *) &ss, &len);
+	mowgli_vio_sockaddr_from_struct(&listen_addr, &ss, len);
+
+	mowgli_vio_eventloop_attach(listener, base_eventloop, &listener_evops);
+	spares = mowgli_alloc_array(sizeof *spares, budget);
+
+	printf("%d connects in flight, up to %d accepted at a time, %d usec between rounds\n", window, budget, pause_usec);
+
+	bench("single", accept_single);
+	bench("batch", accept_batch);
+
+	for (i = 0; i < budget; i++)
+		if (spares[i] != NULL)
+			mowgli_vio_destroy(spares[i]);
+
+	mowgli_free(spares);
+	mowgli_vio_destroy(listener);
+	mowgli_eventloop_destroy(base_eventloop);
+
+	return EXIT_SUCCESS;
+}
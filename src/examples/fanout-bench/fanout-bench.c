@@ -0,0 +1,214 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * fanout-bench.c: Sending the same lines to many linebufs.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* Broadcasts bursts of channel-sized lines to a crowd of linebufs, once
+ * with mowgli_linebuf_write() copying each line into every write queue and
+ * once with mowgli_linebuf_write_shared() queueing references to a single
+ * copy.  A socket per recipient and another per peer would not fit under
+ * the usual descriptor limits at 10k recipients, so recipients are dups of
+ * a handful of sink sockets, which we drain ourselves.  The buffer column
+ * is the line data held at the top of a burst: pool buffers, plus the
+ * messages themselves when shared; queue entries are not counted.
+ */
+
+static mowgli_eventloop_t *base_eventloop;
+
+static int recipients = 10000, burst = 16, rounds = 50, linelen = 200, nsinks = 64;
+static int (*sinks)[2];
+static char drain_buf[65536];
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static size_t
+drain(void)
+{
+	size_t total = 0;
+	ssize_t ret;
+	int i;
+
+	for (i = 0; i < nsinks; i++)
+		while ((ret = read(sinks[i][1], drain_buf, sizeof drain_buf)) > 0)
+			total += ret;
+
+	return total;
+}
+
+static void
+run(bool shared)
+{
+	mowgli_linebuf_t **linebufs = mowgli_alloc_array(sizeof(mowgli_linebuf_t *), recipients);
+	mowgli_linebuf_pool_stats_t stats;
+	char *line = mowgli_alloc(linelen);
+	uint64_t copied = 0, expected, received = 0;
+	size_t queued, peak = 0;
+	double start, secs;
+	int i, j, r;
+
+	for (i = 0; i < recipients; i++)
+	{
+		linebufs[i] = mowgli_linebuf_create(NULL, NULL);
+		linebufs[i]->vio->io.fd = dup(sinks[i % nsinks][0]);
+		mowgli_linebuf_attach_to_eventloop(linebufs[i], base_eventloop);
+	}
+
+	memset(line, 'x', linelen);
+	line[0] = ':';
+
+	expected = (uint64_t) recipients * burst * rounds * (linelen + 2);
+
+	start = now();
+
+	for (r = 0; r < rounds; r++)
+	{
+		for (j = 0; j < burst; j++)
+		{
+			line[1 + (r * burst + j) % (linelen - 1)]++;
+
+			if (shared)
+			{
+				mowgli_linebuf_msg_t *msg = mowgli_linebuf_msg_create(line, linelen, "\r\n");
+
+				for (i = 0; i < recipients; i++)
+					mowgli_linebuf_write_shared(linebufs[i], msg);
+
+				copied += msg->len;
+				mowgli_object_unref(msg);
+			}
+			else
+			{
+				for (i = 0; i < recipients; i++)
+					mowgli_linebuf_write(linebufs[i], line, linelen);
+			}
+		}
+
+		/* line data held at the top of the burst */
+		mowgli_linebuf_pool_get_stats(&stats);
+		queued = stats.in_use + (shared ? burst * (sizeof(mowgli_linebuf_msg_t) + linelen + 2) : 0);
+		peak = MAX(peak, queued);
+
+		/* let the eventloop flush everything, draining as we go */
+		while (received < (uint64_t) recipients * burst * (r + 1) * (linelen + 2))
+		{
+			mowgli_eventloop_timeout_once(base_eventloop, 10);
+			received += drain();
+		}
+	}
+
+	secs = now() - start;
+
+	for (i = 0; i < recipients; i++)
+	{
+		copied += linebufs[i]->write_copied;
+		mowgli_linebuf_destroy(linebufs[i]);
+	}
+
+	printf("%-7s %8.0f klines/s %8.1f MiB/s  copied %6.1f MiB  buffers %7.1f KiB%s\n",
+	       shared ? "shared" : "copy", (double) recipients * burst * rounds / secs / 1000,
+	       received / secs / 1048576.0, copied / 1048576.0, peak / 1024.0,
+	       received == expected ? "" : "  (short!)");
+
+	mowgli_free(line);
+	mowgli_free(linebufs);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: fanout-bench [-n recipients] [-b burst] [-r rounds] [-l line length] [-k sinks]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct rlimit rl;
+	int c, i, bufsize = 4 * 1024 * 1024;
+
+	while ((c = getopt(argc, argv, "n:b:r:l:k:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			recipients = atoi(optarg);
+			break;
+		case 'b':
+			burst = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 'l':
+			linelen = atoi(optarg);
+			break;
+		case 'k':
+			nsinks = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((recipients <= 0) || (burst <= 0) || (rounds <= 0) || (linelen < 2) || (nsinks <= 0))
+		usage();
+
+	if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < (rlim_t) (recipients + 2 * nsinks + 16)))
+	{
+		rl.rlim_cur = MIN((rlim_t) (recipients + 2 * nsinks + 16), rl.rlim_max);
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	sinks = mowgli_alloc_array(sizeof(*sinks), nsinks);
+
+	for (i = 0; i < nsinks; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sinks[i]) == -1)
+		{
+			perror("socketpair");
+			return EXIT_FAILURE;
+		}
+
+		setsockopt(sinks[i][0], SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof bufsize);
+		fcntl(sinks[i][1], F_SETFL, O_NONBLOCK);
+	}
+
+	base_eventloop = mowgli_eventloop_create();
+
+	printf("%d recipients, bursts of %d %d byte lines, %d rounds\n", recipients, burst, linelen + 2, rounds);
+
+	run(false);
+	run(true);
+
+	mowgli_eventloop_destroy(base_eventloop);
+
+	return EXIT_SUCCESS;
+}
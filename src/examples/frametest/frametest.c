@@ -0,0 +1,150 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * frametest.c: Length-prefixed framing between two linebufs.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* Sends binary frames of every size up to the limit, from empty to bigger
+ * than the initial read buffer, between two linebufs over a socketpair in
+ * each framing mode, and checks every one arrives intact and in order.
+ */
+
+#define FRAMES 2000
+#define MAX_FRAME 65535
+
+static mowgli_eventloop_t *base_eventloop;
+static unsigned long received, bad, copied_frames;
+static size_t lengths[FRAMES];
+
+static unsigned char
+frame_byte(unsigned long frame, size_t i)
+{
+	return (unsigned char) (frame * 31 + i * 7);
+}
+
+static void
+eat_frame(mowgli_linebuf_t *linebuf, char *frame, size_t len, void *userdata)
+{
+	size_t i;
+
+	if ((received >= FRAMES) || (len != lengths[received]))
+	{
+		bad++;
+		received++;
+		return;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		if ((unsigned char) frame[i] != frame_byte(received, i))
+		{
+			bad++;
+			break;
+		}
+	}
+
+	received++;
+}
+
+static bool
+run(mowgli_linebuf_framing_t framing, const char *name)
+{
+	mowgli_linebuf_t *sender, *receiver;
+	mowgli_random_t *r = mowgli_random_create_with_seed(framing);
+	unsigned char *frame = mowgli_alloc(MAX_FRAME);
+	size_t bytes = 0, i;
+	int sv[2], spins = 0;
+	unsigned long n;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	received = bad = 0;
+
+	sender = mowgli_linebuf_create(NULL, NULL);
+	mowgli_linebuf_framing(sender, framing, MAX_FRAME);
+	mowgli_linebuf_setbuflen(&sender->writebuf, 64 * 1024 * 1024);
+	sender->vio->io.fd = sv[0];
+	mowgli_linebuf_attach_to_eventloop(sender, base_eventloop);
+
+	receiver = mowgli_linebuf_create(eat_frame, NULL);
+	mowgli_linebuf_framing(receiver, framing, MAX_FRAME);
+	receiver->vio->io.fd = sv[1];
+	mowgli_linebuf_attach_to_eventloop(receiver, base_eventloop);
+
+	for (n = 0; n < FRAMES; n++)
+	{
+		/* mostly small, with the odd big one and a few empty */
+		if (n % 100 == 0)
+			lengths[n] = mowgli_random_int_ranged(r, 0, MAX_FRAME);
+		else if (n % 10 == 0)
+			lengths[n] = 0;
+		else
+			lengths[n] = mowgli_random_int_ranged(r, 1, 300);
+
+		for (i = 0; i < lengths[n]; i++)
+			frame[i] = frame_byte(n, i);
+
+		mowgli_linebuf_write_frame(sender, frame, lengths[n]);
+		bytes += lengths[n];
+	}
+
+	while ((received < FRAMES) && (spins++ < 10000))
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+	copied_frames = receiver->read_copied;
+
+	printf("%-7s %lu/%d frames, %zu payload bytes, %lu bad, %" PRIu64 " bytes copied for wrapped frames\n",
+	       name, received, FRAMES, bytes, bad, receiver->read_copied);
+
+	mowgli_linebuf_destroy(sender);
+	mowgli_linebuf_destroy(receiver);
+	mowgli_object_unref(r);
+	mowgli_free(frame);
+
+	return (received == FRAMES) && (bad == 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	bool ok = true;
+
+	base_eventloop = mowgli_eventloop_create();
+
+	ok &= run(MOWGLI_LINEBUF_FRAMING_BE16, "be16");
+	ok &= run(MOWGLI_LINEBUF_FRAMING_BE32, "be32");
+	ok &= run(MOWGLI_LINEBUF_FRAMING_VARINT, "varint");
+
+	mowgli_eventloop_destroy(base_eventloop);
+
+	if (!ok)
+	{
+		fprintf(stderr, "frames lost or mangled!\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
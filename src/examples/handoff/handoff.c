@@ -0,0 +1,339 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * handoff.c: Handing accepted connections to pre-forked helpers.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+#include <poll.h>
+
+/* The front process forks -n helpers, then accepts connections on
+ * loopback and hands each to the next helper in turn, along with its
+ * number.  It never reads from them: a helper answers a line with its pid
+ * and the number and hangs up.
+ *
+ * A client child makes -c connections, -w at a time, and reports how many
+ * were answered per second and by which helper.
+ */
+
+static int nworkers = 4, nconns = 10000, window = 32;
+
+static mowgli_eventloop_t *base_eventloop;
+static mowgli_vio_t *listener;
+static mowgli_vio_sockaddr_t listen_addr;
+static mowgli_vio_evops_t listener_evops;
+
+static mowgli_eventloop_helper_proc_t **workers;
+static unsigned int next_worker;
+static uint32_t handed;
+
+#define BATCH 32
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Helper side */
+
+typedef struct
+{
+	mowgli_vio_t vio;
+	uint32_t number;
+} conn_t;
+
+static void
+conn_read(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	conn_t *conn = userdata;
+	mowgli_vio_t *vio = &conn->vio;
+	char line[128], reply[192];
+	int ret, n;
+
+	if ((ret = mowgli_vio_read(vio, line, sizeof line - 1)) == 0)
+		return;
+
+	if (ret > 0)
+	{
+		line[ret] = '\0';
+		line[strcspn(line, "\r\n")] = '\0';
+
+		n = snprintf(reply, sizeof reply, "%d %u %s\n", (int) getpid(), conn->number, line);
+		mowgli_vio_write(vio, reply, n);
+	}
+
+	mowgli_vio_destroy(vio);
+	mowgli_free(conn);
+}
+
+static mowgli_vio_evops_t conn_evops = { .read_cb = conn_read };
+
+static void
+worker_handoff(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_helper_proc_t *helper = mowgli_eventloop_io_helper(io);
+	conn_t *conn;
+	size_t len;
+	int ret;
+
+	do
+	{
+		conn = mowgli_alloc(sizeof *conn);
+		mowgli_vio_init(&conn->vio, conn);
+		len = sizeof conn->number;
+
+		if ((ret = mowgli_helper_recv_vio(helper, &conn->vio, &conn->number, &len)) <= 0)
+		{
+			mowgli_free(conn);
+			break;
+		}
+
+		mowgli_vio_eventloop_attach(&conn->vio, eventloop, &conn_evops);
+		mowgli_pollable_setselect(eventloop, conn->vio.io.e, MOWGLI_EVENTLOOP_IO_READ, conn_read);
+	} while (true);
+
+	/* the front is gone */
+	if (ret < 0)
+		mowgli_eventloop_break(eventloop);
+}
+
+static void
+worker_start(mowgli_eventloop_helper_proc_t *helper, void *userdata)
+{
+	mowgli_helper_set_read_cb(helper->eventloop, helper, worker_handoff);
+	mowgli_eventloop_run(helper->eventloop);
+
+	_exit(EXIT_SUCCESS);
+}
+
+/* Front side */
+
+static void
+front_accept(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	static mowgli_vio_t *spares[BATCH];
+	int i, n, tries, ret;
+
+	for (i = 0; i < BATCH; i++)
+		if (spares[i] == NULL)
+			spares[i] = mowgli_vio_create(NULL);
+
+	if ((n = mowgli_vio_acceptmany(listener, spares, BATCH)) <= 0)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		/* a helper that is behind gets passed over; if all are, drop it */
+		for (tries = 0, ret = 1; (ret == 1) && (tries < nworkers); tries++)
+			ret = mowgli_helper_send_vio(workers[next_worker++ % nworkers], spares[i], &handed, sizeof handed);
+
+		if (ret == 0)
+			handed++;
+
+		mowgli_vio_destroy(spares[i]);
+		spares[i] = NULL;
+	}
+}
+
+/* Client side */
+
+typedef struct
+{
+	int pid;
+	unsigned int count;
+} tally_t;
+
+static void
+tally(tally_t *tallies, const char *reply)
+{
+	int i, pid = atoi(reply);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		if (tallies[i].pid == pid)
+			break;
+
+		if (tallies[i].pid == 0)
+		{
+			tallies[i].pid = pid;
+			break;
+		}
+	}
+
+	if (i < nworkers)
+		tallies[i].count++;
+}
+
+static void
+client(void)
+{
+	struct pollfd *fds = mowgli_alloc_array(sizeof *fds, window);
+	tally_t *tallies = mowgli_alloc_array(sizeof *tallies, nworkers);
+	int i, started = 0, done = 0, answered = 0;
+	double start = now(), secs;
+	char buf[192];
+	ssize_t n;
+
+	for (i = 0; i < window; i++)
+		fds[i].fd = -1;
+
+	while (done < nconns)
+	{
+		for (i = 0; (i < window) && (started < nconns); i++)
+		{
+			if (fds[i].fd != -1)
+				continue;
+
+			if (((fds[i].fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) ||
+			    (connect(fds[i].fd, (struct sockaddr *) &listen_addr.addr, listen_addr.addrlen) == -1) ||
+			    (write(fds[i].fd, "ping\n", 5) != 5))
+				_exit(EXIT_FAILURE);
+
+			fds[i].events = POLLIN;
+			started++;
+		}
+
+		if (poll(fds, window, 5000) <= 0)
+			_exit(EXIT_FAILURE);
+
+		for (i = 0; i < window; i++)
+		{
+			if ((fds[i].fd == -1) || (fds[i].revents == 0))
+				continue;
+
+			if ((n = read(fds[i].fd, buf, sizeof buf - 1)) > 0)
+			{
+				buf[n] = '\0';
+				tally(tallies, buf);
+				answered++;
+			}
+
+			close(fds[i].fd);
+			fds[i].fd = -1;
+			done++;
+		}
+	}
+
+	secs = now() - start;
+
+	printf("%d connections, %d answered, %.0f/s\n", nconns, answered, nconns / secs);
+
+	for (i = 0; (i < nworkers) && (tallies[i].pid != 0); i++)
+		printf("  helper %d: %u\n", tallies[i].pid, tallies[i].count);
+
+	fflush(stdout);
+	_exit(answered == nconns ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: handoff [-n helpers] [-c connections] [-w connects in flight]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof ss;
+	pid_t pid;
+	int c, i, status;
+
+	argv = mowgli_proctitle_init(argc, argv);
+
+	while ((c = getopt(argc, argv, "n:c:w:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			nworkers = atoi(optarg);
+			break;
+		case 'c':
+			nconns = atoi(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((nworkers <= 0) || (nconns <= 0) || (window <= 0))
+		usage();
+
+	base_eventloop = mowgli_eventloop_create();
+	workers = mowgli_alloc_array(sizeof *workers, nworkers);
+
+	for (i = 0; i < nworkers; i++)
+		if ((workers[i] = mowgli_helper_create(base_eventloop, worker_start, "handoff helper", NULL)) == NULL)
+		{
+			fprintf(stderr, "could not start a helper\n");
+			return EXIT_FAILURE;
+		}
+
+	listener = mowgli_vio_create(NULL);
+
+	if ((mowgli_vio_socket(listener, AF_INET, SOCK_STREAM, 0) != 0) ||
+	    (mowgli_vio_reuseaddr(listener) != 0) ||
+	    (mowgli_vio_bind(listener, mowgli_vio_sockaddr_create(&listen_addr, AF_INET, "127.0.0.1", 0)) != 0) ||
+	    (mowgli_vio_listen(listener, SOMAXCONN) != 0))
+	{
+		fprintf(stderr, "listener: %s\n", listener->error.string);
+		return EXIT_FAILURE;
+	}
+
+	getsockname(mowgli_vio_getfd(listener), (struct sockaddr *) &ss, &len);
+	mowgli_vio_sockaddr_from_struct(&listen_addr, &ss, len);
+
+	listener_evops.read_cb = front_accept;
+	mowgli_vio_eventloop_attach(listener, base_eventloop, &listener_evops);
+	mowgli_pollable_setselect(base_eventloop, listener->io.e, MOWGLI_EVENTLOOP_IO_READ, front_accept);
+
+	if ((pid = fork()) == -1)
+	{
+		perror("fork");
+		return EXIT_FAILURE;
+	}
+
+	if (pid == 0)
+		client();
+
+	while (waitpid(pid, &status, WNOHANG) == 0)
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+	printf("%u handed off\n", handed);
+
+	for (i = 0; i < nworkers; i++)
+		mowgli_helper_destroy(base_eventloop, workers[i]);
+
+	mowgli_free(workers);
+	mowgli_vio_destroy(listener);
+	mowgli_eventloop_destroy(base_eventloop);
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
@@ -0,0 +1,128 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * helperpool.c: Testing of helper pools
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+#define JOBS 20000
+#define HELPERS 4
+
+static int submitted = 0;
+static int answered = 0;
+static int failed = 0;
+static int crash_at = -1;
+
+static struct timeval start;
+static mowgli_eventloop_t *eventloop;
+
+/* runs in the helpers: "hash" the request.  a request of "crash" kills the
+ * helper so that respawning gets exercised.
+ */
+static void
+work(mowgli_eventloop_helper_proc_t *helper, const void *data, size_t len, void *userdata)
+{
+	const unsigned char *p = data;
+	unsigned int hash = 5381;
+	size_t i;
+	int round;
+
+	if ((len == 5) && !memcmp(data, "crash", 5))
+		_exit(EXIT_FAILURE);
+
+	for (round = 0; round < 64; round++)
+		for (i = 0; i < len; i++)
+			hash = hash * 33 + p[i];
+
+	mowgli_helper_pool_reply(helper, &hash, sizeof hash);
+}
+
+static void submit_more(mowgli_helper_pool_t *pool);
+
+static void
+done(mowgli_helper_pool_t *pool, const void *data, size_t len, void *userdata)
+{
+	if (data == NULL)
+		failed++;
+	else
+		answered++;
+
+	if (answered + failed == JOBS)
+	{
+		struct timeval end;
+		double secs;
+
+		gettimeofday(&end, NULL);
+		secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+
+		printf("%d jobs on %d helpers: %d answered, %d failed, %.3fs (%.0f jobs/s)\n",
+		       JOBS, HELPERS, answered, failed, secs, JOBS / secs);
+
+		mowgli_eventloop_break(eventloop);
+		return;
+	}
+
+	submit_more(pool);
+}
+
+static void
+submit_more(mowgli_helper_pool_t *pool)
+{
+	char buf[64];
+
+	while (submitted < JOBS)
+	{
+		size_t len;
+
+		if (submitted == crash_at)
+			len = mowgli_strlcpy(buf, "crash", sizeof buf);
+		else
+			len = snprintf(buf, sizeof buf, "password-%d", submitted);
+
+		/* pool is saturated, done() refills it */
+		if (!mowgli_helper_pool_submit(pool, buf, len, done, NULL))
+			break;
+
+		submitted++;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	mowgli_helper_pool_t *pool;
+
+	if (argc > 1)
+		crash_at = atoi(argv[1]);
+
+	eventloop = mowgli_eventloop_create();
+	pool = mowgli_helper_pool_create(eventloop, "helperpool worker", HELPERS, work, NULL);
+
+	gettimeofday(&start, NULL);
+
+	submit_more(pool);
+	mowgli_eventloop_run(eventloop);
+
+	mowgli_helper_pool_destroy(pool);
+	mowgli_eventloop_destroy(eventloop);
+
+	return EXIT_SUCCESS;
+}
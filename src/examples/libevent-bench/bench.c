@@ -64,135 +64,644 @@
  *
  */
 
-#define timersub(tvp, uvp, vvp)	\
-	do \
-	{ \
-		(vvp)->tv_sec = (tvp)->tv_sec - (uvp)->tv_sec; \
-		(vvp)->tv_usec = (tvp)->tv_usec - (uvp)->tv_usec; \
-		if ((vvp)->tv_usec < 0)	\
-		{ \
-			(vvp)->tv_sec--; \
-			(vvp)->tv_usec += 1000000; \
-		} \
-	} while (0)
+/*
+ * Turned into a suite covering every poller backend, 2026.
+ */
 
 #include <mowgli.h>
 
-static int count, writes, fired;
+#ifndef _WIN32
+# include <sys/select.h>
+#endif
+
+/* Runs every scenario against every compiled-in poller backend (or the ones
+ * given with -b) and reports events per second and latency percentiles,
+ * as a table or, with -j, as JSON for tracking across releases.
+ *
+ *   pipechain  the libevent benchmark: -a active writers relaying -w writes
+ *              around a ring of -n socketpairs
+ *   idle       one ping-ponging socketpair among -i idle ones
+ *   timers     adding and removing one-shot timers between polls
+ *   accept     bursts of loopback TCP connects, accepted until EAGAIN
+ *   fanout     one message written to each of -f sockets per round
+ */
+
+typedef struct
+{
+	double *samples;
+	size_t nsamples, cap;
+	unsigned long events;
+	double seconds;
+	bool skipped;
+} result_t;
+
+typedef struct
+{
+	const char *name;
+	int (*fds_needed)(void);
+	void (*run)(mowgli_eventloop_t *eventloop, result_t *result);
+} scenario_t;
+
+static int num_pipes = 100, num_active = 1, num_writes = 100;
+static int num_idle = 5000, num_fanout = 1000, num_accept = 2000;
+static int iterations = 20000;
+
 static mowgli_eventloop_t *base_eventloop;
-static mowgli_descriptor_t *pipes;
-static int num_pipes, num_active, num_writes;
-static mowgli_eventloop_pollable_t **events;
-static int timers;
+static result_t *cur;
 
-void
-timer_cb(void *unused)
+static double
+now_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void
+sample(double usec)
 {
-	/* nop */
+	if (cur->nsamples == cur->cap)
+	{
+		double *n;
+
+		cur->cap = cur->cap ? cur->cap * 2 : 4096;
+		n = mowgli_alloc_array(sizeof(double), cur->cap);
+
+		if (cur->samples != NULL)
+		{
+			memcpy(n, cur->samples, cur->nsamples * sizeof(double));
+			mowgli_free(cur->samples);
+		}
+
+		cur->samples = n;
+	}
+
+	cur->samples[cur->nsamples++] = usec;
 }
 
-void
-read_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+static int
+cmp_double(const void *a, const void *b)
 {
-	mowgli_eventloop_pollable_t *pollable = mowgli_eventloop_io_pollable(io);
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
 
+static double
+percentile(result_t *r, double p)
+{
+	size_t i;
+
+	if (r->nsamples == 0)
+		return 0;
+
+	i = (size_t) (p / 100.0 * (r->nsamples - 1) + 0.5);
+
+	return r->samples[i];
+}
+
+static void
+make_pairs(mowgli_descriptor_t *fds, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, &fds[2 * i]) == -1)
+		{
+			perror("socketpair");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void
+close_pairs(mowgli_descriptor_t *fds, int n)
+{
+	int i;
+
+	for (i = 0; i < 2 * n; i++)
+		close(fds[i]);
+}
+
+static void
+drain(mowgli_descriptor_t fd)
+{
+	char buf[4096];
+
+	while (read(fd, buf, sizeof buf) > 0)
+		;
+}
+
+/*
+ * pipechain
+ */
+static mowgli_descriptor_t *pipes;
+static double *stamps;
+static int count, writes, fired;
+
+static void
+chain_read_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+{
+	mowgli_eventloop_pollable_t *pollable = mowgli_eventloop_io_pollable(io);
 	int idx = (int) (long) arg, widx = idx + 1;
-	u_char ch;
+	unsigned char ch;
+	double t = now_usec();
 
 	count += read(pollable->fd, &ch, sizeof(ch));
+	sample(t - stamps[idx]);
+	cur->events++;
 
 	if (writes)
 	{
 		if (widx >= num_pipes)
 			widx -= num_pipes;
 
-		write(pipes[2 * widx + 1], "e", 1);
+		stamps[widx] = now_usec();
+
+		if (write(pipes[2 * widx + 1], "e", 1) == 1)
+			fired++;
+
 		writes--;
-		fired++;
 	}
 }
 
-#if NATIVE
-void
-read_thunk(struct ev_io *w, int revents)
+static int
+chain_fds(void)
 {
-	read_cb(w->fd, revents, w->data);
+	return num_pipes * 2;
 }
 
-void
-timer_cb(struct ev_timer *w, int revents)
+static void
+chain_run(mowgli_eventloop_t *eventloop, result_t *result)
 {
-	/* nop */
+	mowgli_eventloop_pollable_t **events;
+	int i, round, space;
+	double start;
+
+	pipes = mowgli_alloc_array(sizeof(mowgli_descriptor_t), num_pipes * 2);
+	stamps = mowgli_alloc_array(sizeof(double), num_pipes);
+	events = mowgli_alloc_array(sizeof(mowgli_eventloop_pollable_t *), num_pipes);
+
+	make_pairs(pipes, num_pipes);
+
+	for (i = 0; i < num_pipes; i++)
+	{
+		events[i] = mowgli_pollable_create(eventloop, pipes[2 * i], (void *) (long) i);
+		mowgli_pollable_setselect(eventloop, events[i], MOWGLI_EVENTLOOP_IO_READ, chain_read_cb);
+	}
+
+	start = now_usec();
+
+	for (round = 0; round < 10; round++)
+	{
+		fired = 0;
+		space = num_pipes / num_active * 2;
+
+		for (i = 0; i < num_active; i++, fired++)
+		{
+			stamps[i * space / 2] = now_usec();
+
+			if (write(pipes[i * space + 1], "e", 1) != 1)
+				fired--;
+		}
+
+		count = 0;
+		writes = num_writes;
+
+		do
+			mowgli_eventloop_run_once(eventloop);
+		while (count != fired);
+	}
+
+	result->seconds = (now_usec() - start) / 1e6;
+
+	for (i = 0; i < num_pipes; i++)
+		mowgli_pollable_destroy(eventloop, events[i]);
+
+	close_pairs(pipes, num_pipes);
+
+	mowgli_free(events);
+	mowgli_free(stamps);
+	mowgli_free(pipes);
 }
 
-#endif
+/*
+ * idle
+ */
+static mowgli_descriptor_t active[2];
+static double active_stamp;
+static int remaining;
+
+static void
+pingpong_read_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+{
+	unsigned char ch;
+
+	if (read(active[0], &ch, 1) != 1)
+		return;
+
+	sample(now_usec() - active_stamp);
+	cur->events++;
+
+	if (--remaining > 0)
+	{
+		active_stamp = now_usec();
+
+		if (write(active[1], "p", 1) != 1)
+			remaining = 0;
+	}
+}
+
+static int
+idle_fds(void)
+{
+	return num_idle * 2 + 2;
+}
+
+static void
+idle_run(mowgli_eventloop_t *eventloop, result_t *result)
+{
+	mowgli_descriptor_t *fds = mowgli_alloc_array(sizeof(mowgli_descriptor_t), num_idle * 2);
+	mowgli_eventloop_pollable_t **idle = mowgli_alloc_array(sizeof(mowgli_eventloop_pollable_t *), num_idle);
+	mowgli_eventloop_pollable_t *pfd;
+	double start;
+	int i;
+
+	make_pairs(fds, num_idle);
+	make_pairs(active, 1);
+
+	for (i = 0; i < num_idle; i++)
+	{
+		idle[i] = mowgli_pollable_create(eventloop, fds[2 * i], NULL);
+		mowgli_pollable_setselect(eventloop, idle[i], MOWGLI_EVENTLOOP_IO_READ, pingpong_read_cb);
+	}
+
+	pfd = mowgli_pollable_create(eventloop, active[0], NULL);
+	mowgli_pollable_setselect(eventloop, pfd, MOWGLI_EVENTLOOP_IO_READ, pingpong_read_cb);
+
+	remaining = iterations;
+	start = active_stamp = now_usec();
+
+	if (write(active[1], "p", 1) == 1)
+		while (remaining > 0)
+			mowgli_eventloop_run_once(eventloop);
+
+	result->seconds = (now_usec() - start) / 1e6;
+
+	mowgli_pollable_destroy(eventloop, pfd);
+
+	for (i = 0; i < num_idle; i++)
+		mowgli_pollable_destroy(eventloop, idle[i]);
+
+	close_pairs(active, 1);
+	close_pairs(fds, num_idle);
+
+	mowgli_free(idle);
+	mowgli_free(fds);
+}
+
+/*
+ * timers
+ */
+static void
+timer_cb(void *unused)
+{
+	cur->events++;
+}
+
+static void
+ready_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+{
+	/* left readable so every poll returns at once */
+}
 
-struct timeval *
-run_once(void)
+static int
+timers_fds(void)
 {
-	int *cp, i, space;
+	return 2;
+}
 
-	static struct timeval ta, ts, te;
+static void
+timers_run(mowgli_eventloop_t *eventloop, result_t *result)
+{
+	mowgli_eventloop_timer_t *timers[8];
+	mowgli_eventloop_timer_t **resident;
+	mowgli_eventloop_pollable_t *pfd;
+	mowgli_descriptor_t ready[2];
+	double start, t;
+	int i, j;
 
-	gettimeofday(&ta, NULL);
+	make_pairs(ready, 1);
 
-	for (cp = pipes, i = 0; i < num_pipes; i++, cp += 2)
+	if (write(ready[1], "r", 1) != 1)
 	{
-		if (events[i] != NULL)
-			mowgli_pollable_destroy(base_eventloop, events[i]);
+		close_pairs(ready, 1);
+		result->skipped = true;
+		return;
+	}
+
+	pfd = mowgli_pollable_create(eventloop, ready[0], NULL);
+	mowgli_pollable_setselect(eventloop, pfd, MOWGLI_EVENTLOOP_IO_READ, ready_cb);
+
+	/* a standing population the churn has to be scheduled around */
+	resident = mowgli_alloc_array(sizeof(mowgli_eventloop_timer_t *), 1000);
+
+	for (i = 0; i < 1000; i++)
+		resident[i] = mowgli_timer_add_once(eventloop, "resident", timer_cb, NULL, 3600 + i);
+
+	start = now_usec();
+
+	/* each round: eight timers that fire on the next poll, and eight that
+	 * are cancelled before they can.
+	 */
+	for (i = 0; i < iterations; i++)
+	{
+		t = now_usec();
+
+		for (j = 0; j < 8; j++)
+		{
+			mowgli_timer_add_once(eventloop, "fire", timer_cb, NULL, 0);
+			timers[j] = mowgli_timer_add_once(eventloop, "cancel", timer_cb, NULL, 60 + j);
+		}
+
+		for (j = 0; j < 8; j++)
+			mowgli_timer_destroy(eventloop, timers[j]);
+
+		result->events += 8;
+
+		mowgli_eventloop_timeout_once(eventloop, 0);
 
-		events[i] = mowgli_pollable_create(base_eventloop, cp[0], (void *) (long) i);
-		mowgli_pollable_setselect(base_eventloop, events[i], MOWGLI_EVENTLOOP_IO_READ, read_cb);
+		sample(now_usec() - t);
 	}
 
-	fired = 0;
-	space = num_pipes / num_active;
-	space = space * 2;
+	result->seconds = (now_usec() - start) / 1e6;
+
+	for (i = 0; i < 1000; i++)
+		mowgli_timer_destroy(eventloop, resident[i]);
+
+	mowgli_pollable_destroy(eventloop, pfd);
+	close_pairs(ready, 1);
+
+	mowgli_free(resident);
+}
+
+/*
+ * accept
+ */
+static mowgli_descriptor_t listener;
+static int accepted, batch_pending;
+static double batch_stamp;
+
+static void
+accept_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+{
+	mowgli_descriptor_t fd;
+
+	while ((fd = accept(listener, NULL, NULL)) >= 0)
+	{
+		close(fd);
+		sample(now_usec() - batch_stamp);
+		cur->events++;
+		accepted++;
+		batch_pending--;
+	}
+}
+
+static int
+accept_fds(void)
+{
+	return 64 * 2 + 1;
+}
 
-	for (i = 0; i < num_active; i++, fired++)
-		write(pipes[i * space + 1], "e", 1);
+static void
+accept_run(mowgli_eventloop_t *eventloop, result_t *result)
+{
+	struct sockaddr_in sin;
+	socklen_t len = sizeof sin;
+	mowgli_eventloop_pollable_t *pfd;
+	mowgli_descriptor_t clients[64];
+	struct linger lin = { 1, 0 };
+	double start;
+	int i, one = 1;
+
+	memset(&sin, 0, sizeof sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+
+	if ((bind(listener, (struct sockaddr *) &sin, sizeof sin) < 0) || (listen(listener, 1024) < 0) ||
+	    (getsockname(listener, (struct sockaddr *) &sin, &len) < 0))
+	{
+		perror("listener");
+		close(listener);
+		result->skipped = true;
+		return;
+	}
 
-	count = 0;
-	writes = num_writes;
+	pfd = mowgli_pollable_create(eventloop, listener, NULL);
+	mowgli_pollable_set_nonblocking(pfd, true);
+	mowgli_pollable_setselect(eventloop, pfd, MOWGLI_EVENTLOOP_IO_READ, accept_cb);
 
-	int xcount = 0;
-	gettimeofday(&ts, NULL);
+	accepted = 0;
+	start = now_usec();
 
-	do
+	while (accepted < num_accept)
 	{
-		mowgli_eventloop_run_once(base_eventloop);
-		xcount++;
-	} while (count != fired);
+		int n = MIN(64, num_accept - accepted);
+
+		batch_stamp = now_usec();
+		batch_pending = n;
+
+		for (i = 0; i < n; i++)
+		{
+			clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+
+			/* reset instead of piling up TIME_WAIT sockets */
+			setsockopt(clients[i], SOL_SOCKET, SO_LINGER, &lin, sizeof lin);
+			fcntl(clients[i], F_SETFL, fcntl(clients[i], F_GETFL) | O_NONBLOCK);
+
+			if ((connect(clients[i], (struct sockaddr *) &sin, sizeof sin) < 0) && (errno != EINPROGRESS))
+				batch_pending--;
+		}
+
+		while (batch_pending > 0)
+			mowgli_eventloop_run_once(eventloop);
+
+		for (i = 0; i < n; i++)
+			close(clients[i]);
+
+		if (batch_pending < 0)
+			break;
+	}
 
-	gettimeofday(&te, NULL);
+	result->seconds = (now_usec() - start) / 1e6;
 
-	timersub(&te, &ta, &ta);
-	timersub(&te, &ts, &ts);
-	fprintf(stdout, "%ld\t%ld\n",
-		ta.tv_sec * 1000000L + ta.tv_usec,
-		ts.tv_sec * 1000000L + ts.tv_usec
-		);
+	mowgli_pollable_destroy(eventloop, pfd);
+	close(listener);
+}
+
+/*
+ * fanout
+ */
+static mowgli_descriptor_t *fan;
+static mowgli_eventloop_pollable_t **fan_w, **fan_r;
+static int fan_reads;
+static double round_stamp;
+static char message[512];
+
+static void
+fan_write_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+{
+	mowgli_eventloop_pollable_t *pollable = mowgli_eventloop_io_pollable(io);
 
-	return &te;
+	if (write(pollable->fd, message, sizeof message) > 0)
+		cur->events++;
+
+	mowgli_pollable_setselect(eventloop, pollable, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
+}
+
+static void
+fan_read_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *arg)
+{
+	mowgli_eventloop_pollable_t *pollable = mowgli_eventloop_io_pollable(io);
+
+	drain(pollable->fd);
+	sample(now_usec() - round_stamp);
+	cur->events++;
+	fan_reads++;
+}
+
+static int
+fanout_fds(void)
+{
+	return num_fanout * 2;
+}
+
+static void
+fanout_run(mowgli_eventloop_t *eventloop, result_t *result)
+{
+	double start;
+	int i, round, rounds = MAX(iterations / num_fanout, 10);
+
+	fan = mowgli_alloc_array(sizeof(mowgli_descriptor_t), num_fanout * 2);
+	fan_w = mowgli_alloc_array(sizeof(mowgli_eventloop_pollable_t *), num_fanout);
+	fan_r = mowgli_alloc_array(sizeof(mowgli_eventloop_pollable_t *), num_fanout);
+
+	make_pairs(fan, num_fanout);
+
+	for (i = 0; i < num_fanout; i++)
+	{
+		fan_w[i] = mowgli_pollable_create(eventloop, fan[2 * i], NULL);
+		fan_r[i] = mowgli_pollable_create(eventloop, fan[2 * i + 1], NULL);
+		mowgli_pollable_set_nonblocking(fan_w[i], true);
+		mowgli_pollable_set_nonblocking(fan_r[i], true);
+		mowgli_pollable_setselect(eventloop, fan_r[i], MOWGLI_EVENTLOOP_IO_READ, fan_read_cb);
+	}
+
+	start = now_usec();
+
+	for (round = 0; round < rounds; round++)
+	{
+		fan_reads = 0;
+		round_stamp = now_usec();
+
+		for (i = 0; i < num_fanout; i++)
+			mowgli_pollable_setselect(eventloop, fan_w[i], MOWGLI_EVENTLOOP_IO_WRITE, fan_write_cb);
+
+		while (fan_reads < num_fanout)
+			mowgli_eventloop_run_once(eventloop);
+	}
+
+	result->seconds = (now_usec() - start) / 1e6;
+
+	for (i = 0; i < num_fanout; i++)
+	{
+		mowgli_pollable_destroy(eventloop, fan_w[i]);
+		mowgli_pollable_destroy(eventloop, fan_r[i]);
+	}
+
+	close_pairs(fan, num_fanout);
+
+	mowgli_free(fan_r);
+	mowgli_free(fan_w);
+	mowgli_free(fan);
+}
+
+static const scenario_t scenarios[] = {
+	{ "pipechain", chain_fds, chain_run },
+	{ "idle", idle_fds, idle_run },
+	{ "timers", timers_fds, timers_run },
+	{ "accept", accept_fds, accept_run },
+	{ "fanout", fanout_fds, fanout_run },
+};
+
+#define NSCENARIOS (sizeof scenarios / sizeof scenarios[0])
+
+static bool
+selected(const char *list, const char *name)
+{
+	char buf[256], *p, *saveptr = NULL;
+
+	if (list == NULL)
+		return true;
+
+	mowgli_strlcpy(buf, list, sizeof buf);
+
+	for (p = strtok_r(buf, ",", &saveptr); p != NULL; p = strtok_r(NULL, ",", &saveptr))
+		if (!strcmp(p, name))
+			return true;
+
+	return false;
+}
+
+static void
+json_out_string(mowgli_json_output_t *out, const char *str, size_t len)
+{
+	fwrite(str, 1, len, stdout);
+}
+
+static void
+json_out_char(mowgli_json_output_t *out, const char c)
+{
+	fputc(c, stdout);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench [-j] [-b backend,...] [-s scenario,...] [-n pipes] [-a active] [-w writes]\n"
+		"             [-i idle] [-f fanout] [-c connections] [-r iterations]\n");
+	exit(EXIT_FAILURE);
 }
 
 int
 main(int argc, char **argv)
 {
+	const char *backends = NULL, *only = NULL, *name;
+	mowgli_json_t *root = NULL, *runs = NULL;
 	struct rlimit rl;
+	bool json = false;
+	size_t b, s;
+	int c, maxfds = 0;
 
-	int i, c;
-	int *cp;
-	extern char *optarg;
-
-	num_pipes = 100;
-	num_active = 1;
-	num_writes = num_pipes;
-
-	while ((c = getopt(argc, argv, "n:a:w:te")) != -1)
+	while ((c = getopt(argc, argv, "jb:s:n:a:w:i:f:c:r:")) != -1)
 	{
 		switch (c)
 		{
+		case 'j':
+			json = true;
+			break;
+		case 'b':
+			backends = optarg;
+			break;
+		case 's':
+			only = optarg;
+			break;
 		case 'n':
 			num_pipes = atoi(optarg);
 			break;
@@ -202,53 +711,132 @@ main(int argc, char **argv)
 		case 'w':
 			num_writes = atoi(optarg);
 			break;
-		case 't':
-			timers = 1;
+		case 'i':
+			num_idle = atoi(optarg);
+			break;
+		case 'f':
+			num_fanout = atoi(optarg);
+			break;
+		case 'c':
+			num_accept = atoi(optarg);
+			break;
+		case 'r':
+			iterations = atoi(optarg);
 			break;
 		default:
-			fprintf(stderr, "Illegal argument \"%c\"\n", c);
-			exit(1);
+			usage();
 		}
 	}
 
-#if 1
-	rl.rlim_cur = rl.rlim_max = num_pipes * 2 + 50;
-
-	if (setrlimit(RLIMIT_NOFILE, &rl) == -1)
-		perror("setrlimit");
-
-#endif
+	if ((num_pipes < 1) || (num_active < 1) || (num_active > num_pipes) || (iterations < 1) ||
+	    (num_idle < 0) || (num_fanout < 1) || (num_accept < 1))
+		usage();
 
-	events = calloc(num_pipes * 2, sizeof(mowgli_eventloop_pollable_t *));
-	pipes = calloc(num_pipes * 2, sizeof(mowgli_descriptor_t));
+	for (s = 0; s < NSCENARIOS; s++)
+		maxfds = MAX(maxfds, scenarios[s].fds_needed());
 
-	if ((events == NULL) || (pipes == NULL))
+	if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < (rlim_t) maxfds + 50))
 	{
-		perror("malloc");
-		exit(1);
+		rl.rlim_cur = MIN((rlim_t) maxfds + 50, rl.rlim_max);
+
+		if (setrlimit(RLIMIT_NOFILE, &rl) == -1)
+			perror("setrlimit");
 	}
 
 	mowgli_thread_set_policy(MOWGLI_THREAD_POLICY_DISABLED);
-	base_eventloop = mowgli_eventloop_create();
+	memset(message, 'm', sizeof message);
 
-	for (cp = pipes, i = 0; i < num_pipes; i++, cp += 2)
+	if (json)
+	{
+		root = mowgli_json_create_object();
+		runs = mowgli_json_create_array();
+		mowgli_json_object_add(root, "benchmark", mowgli_json_create_string("eventloop"));
+		mowgli_json_object_add(root, "iterations", mowgli_json_create_integer(iterations));
+		mowgli_json_object_add(root, "runs", runs);
+	}
+	else
 	{
-#ifdef USE_PIPES
+		printf("%-8s %-10s %12s %10s %10s %10s %10s\n", "backend", "scenario", "events/s", "p50 us", "p90 us", "p99 us", "max us");
+	}
 
-		if (pipe(cp) == -1)
-		{
-#else
+	for (b = 0; (name = mowgli_eventloop_backend_nth(b)) != NULL; b++)
+	{
+		if (!strcmp(name, "null") || !selected(backends, name))
+			continue;
 
-		if (socketpair(AF_UNIX, SOCK_STREAM, 0, cp) == -1)
+		for (s = 0; s < NSCENARIOS; s++)
 		{
-#endif
-			perror("pipe");
-			exit(1);
+			result_t result;
+
+			if (!selected(only, scenarios[s].name))
+				continue;
+
+			memset(&result, 0, sizeof result);
+			cur = &result;
+
+			/* the select and poll backends keep fixed FD_SETSIZE tables */
+			if ((!strcmp(name, "select") || !strcmp(name, "poll")) &&
+			    (scenarios[s].fds_needed() + 10 >= FD_SETSIZE))
+			{
+				result.skipped = true;
+			}
+			else
+			{
+				base_eventloop = mowgli_eventloop_create_backend(name);
+				scenarios[s].run(base_eventloop, &result);
+				mowgli_eventloop_destroy(base_eventloop);
+			}
+
+			qsort(result.samples, result.nsamples, sizeof(double), cmp_double);
+
+			if (json)
+			{
+				mowgli_json_t *run = mowgli_json_create_object();
+
+				mowgli_json_object_add(run, "backend", mowgli_json_create_string(name));
+				mowgli_json_object_add(run, "scenario", mowgli_json_create_string(scenarios[s].name));
+				mowgli_json_object_add(run, "skipped", result.skipped ? mowgli_json_true : mowgli_json_false);
+
+				if (!result.skipped)
+				{
+					mowgli_json_t *lat = mowgli_json_create_object();
+
+					mowgli_json_object_add(run, "events", mowgli_json_create_float(result.events));
+					mowgli_json_object_add(run, "seconds", mowgli_json_create_float(result.seconds));
+					mowgli_json_object_add(run, "events_per_sec", mowgli_json_create_float(result.events / result.seconds));
+					mowgli_json_object_add(lat, "p50", mowgli_json_create_float(percentile(&result, 50)));
+					mowgli_json_object_add(lat, "p90", mowgli_json_create_float(percentile(&result, 90)));
+					mowgli_json_object_add(lat, "p99", mowgli_json_create_float(percentile(&result, 99)));
+					mowgli_json_object_add(lat, "max", mowgli_json_create_float(percentile(&result, 100)));
+					mowgli_json_object_add(run, "latency_usec", lat);
+				}
+
+				mowgli_json_array_add(runs, run);
+			}
+			else if (result.skipped)
+			{
+				printf("%-8s %-10s %12s\n", name, scenarios[s].name, "skipped");
+			}
+			else
+			{
+				printf("%-8s %-10s %12.0f %10.1f %10.1f %10.1f %10.1f\n", name, scenarios[s].name,
+				       result.events / result.seconds, percentile(&result, 50), percentile(&result, 90),
+				       percentile(&result, 99), percentile(&result, 100));
+			}
+
+			if (result.samples != NULL)
+				mowgli_free(result.samples);
 		}
 	}
 
-	for (i = 0; i < 2; i++)
-		run_once();
+	if (json)
+	{
+		mowgli_json_output_t out = { json_out_string, json_out_char, NULL };
+
+		mowgli_json_serialize(root, &out, 1);
+		putchar('\n');
+		mowgli_json_decref(root);
+	}
 
-	exit(0);
+	return EXIT_SUCCESS;
 }
@@ -0,0 +1,291 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * linebuf-bench.c: Line buffer behaviour under fragmented input.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* Feeds streams of IRC-sized lines to a linebuf over a socketpair.
+ *
+ * fragments: the data goes over in randomly sized fragments, one read
+ * each, and we count the bytes of input the read path had to copy.  The
+ * memmove column is what the old linear buffer moved: the partial line
+ * left over after every read that completed a line.
+ *
+ * bulk: the data goes over as fast as the socket takes it, and we count
+ * read calls and eventloop wakeups with the linebuf reading one
+ * buffer-full per wakeup, then reading until the socket is dry.
+ */
+
+static mowgli_eventloop_t *base_eventloop;
+static unsigned long lines, bad;
+static char *data;
+static size_t datalen;
+static unsigned long expected;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void
+eat_line(mowgli_linebuf_t *linebuf, char *line, size_t len, void *userdata)
+{
+	/* a \r\n split across reads shows up as an empty line */
+	if (len == 0)
+		return;
+
+	if ((line[0] != ':') || (line[len - 1] == '\r'))
+		bad++;
+
+	lines++;
+}
+
+static void
+generate(size_t size)
+{
+	static const char text[] = "nick!user@host PRIVMSG #channel :the quick brown fox jumps over the lazy dog ";
+	mowgli_random_t *r = mowgli_random_create_with_seed(1);
+	size_t i;
+
+	data = mowgli_alloc(size);
+
+	while (datalen < size - 512)
+	{
+		size_t len = 20 + mowgli_random_int_ranged(r, 0, 400);
+
+		data[datalen++] = ':';
+
+		for (i = 1; i < len; i++)
+			data[datalen++] = text[i % (sizeof(text) - 1)];
+
+		data[datalen++] = '\r';
+		data[datalen++] = '\n';
+		expected++;
+	}
+
+	mowgli_object_unref(r);
+}
+
+static bool
+check_lines(void)
+{
+	bool ok = (lines == expected) && (bad == 0);
+
+	if (!ok)
+		fprintf(stderr, "lost or mangled lines!\n");
+
+	lines = bad = 0;
+
+	return ok;
+}
+
+static bool
+fragments_test(size_t maxfrag, size_t buflen)
+{
+	mowgli_linebuf_t *linebuf;
+	mowgli_random_t *r = mowgli_random_create_with_seed(2);
+	size_t off = 0, line_start = 0, i;
+	uint64_t memmoved = 0;
+	unsigned long reads = 0;
+	double start, secs;
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	linebuf = mowgli_linebuf_create(eat_line, NULL);
+	mowgli_linebuf_setbuflen(&linebuf->readbuf, buflen);
+
+	/* adopt our end of the socketpair */
+	linebuf->vio->io.fd = sv[0];
+	mowgli_linebuf_attach_to_eventloop(linebuf, base_eventloop);
+
+	start = now();
+
+	while (off < datalen)
+	{
+		size_t frag = MIN((size_t) mowgli_random_int_ranged(r, 1, maxfrag), datalen - off);
+		size_t last = line_start;
+
+		if (write(sv[1], data + off, frag) != (ssize_t) frag)
+		{
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+
+		off += frag;
+		reads++;
+
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+		/* where the old buffer would have been left after this read */
+		for (i = off; i > last; i--)
+		{
+			if (data[i - 1] == '\n')
+			{
+				line_start = i;
+				break;
+			}
+		}
+
+		if ((line_start != last) && (line_start != off))
+			memmoved += off - line_start;
+	}
+
+	secs = now() - start;
+
+	printf("fragments: %zu bytes in %lu reads (fragments up to %zu, %zu byte buffer)\n", datalen, reads, maxfrag, buflen);
+	printf("  %lu/%lu lines, %.1f MiB/s\n", lines, expected, datalen / secs / 1048576.0);
+	printf("  bytes copied: memmove %" PRIu64 " (%.1f%%), ring %" PRIu64 " (%.1f%%)\n",
+	       memmoved, 100.0 * memmoved / datalen, linebuf->read_copied, 100.0 * linebuf->read_copied / datalen);
+
+	mowgli_linebuf_destroy(linebuf);
+	mowgli_object_unref(r);
+	close(sv[1]);
+
+	return check_lines();
+}
+
+static bool
+bulk_run(const char *name, size_t budget, size_t buflen)
+{
+	mowgli_linebuf_t *linebuf;
+	size_t off = 0;
+	double start, secs;
+	ssize_t ret;
+	int sv[2], sockbuf = 1024 * 1024;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	setsockopt(sv[1], SOL_SOCKET, SO_SNDBUF, &sockbuf, sizeof sockbuf);
+	fcntl(sv[1], F_SETFL, O_NONBLOCK);
+
+	linebuf = mowgli_linebuf_create(eat_line, NULL);
+	mowgli_linebuf_setbuflen(&linebuf->readbuf, buflen);
+	mowgli_linebuf_set_read_budget(linebuf, budget, 0);
+
+	linebuf->vio->io.fd = sv[0];
+	mowgli_linebuf_attach_to_eventloop(linebuf, base_eventloop);
+
+	start = now();
+
+	while (lines < expected)
+	{
+		/* keep the socket topped up */
+		while ((off < datalen) && ((ret = write(sv[1], data + off, datalen - off)) > 0))
+			off += ret;
+
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+	}
+
+	secs = now() - start;
+
+	printf("  %-10s %8" PRIu64 " wakeups %8" PRIu64 " reads %8.1f KiB/wakeup %8.1f MiB/s\n", name,
+	       linebuf->read_events, linebuf->read_calls, datalen / 1024.0 / linebuf->read_events,
+	       datalen / secs / 1048576.0);
+
+	mowgli_linebuf_destroy(linebuf);
+	close(sv[1]);
+
+	return check_lines();
+}
+
+static bool
+bulk_test(size_t buflen)
+{
+	bool ok = true;
+
+	printf("bulk: %zu bytes, %zu byte buffer\n", datalen, buflen);
+
+	/* a budget of one byte stops after the first buffer-full */
+	ok &= bulk_run("one read", 1, buflen);
+	ok &= bulk_run("until dry", MOWGLI_LINEBUF_READ_BUDGET, buflen);
+
+	return ok;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: linebuf-bench [-t fragments,bulk] [-m MiB] [-f max fragment] [-b read buffer]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *tests = "fragments,bulk";
+	size_t size = 64, maxfrag = 1460, buflen = 65536;
+	bool ok = true;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:m:f:b:")) != -1)
+	{
+		switch (c)
+		{
+		case 't':
+			tests = optarg;
+			break;
+		case 'm':
+			size = atoi(optarg);
+			break;
+		case 'f':
+			maxfrag = atoi(optarg);
+			break;
+		case 'b':
+			buflen = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((size == 0) || (maxfrag == 0) || (buflen < 1024))
+		usage();
+
+	generate(size * 1024 * 1024);
+
+	base_eventloop = mowgli_eventloop_create();
+
+	if (strstr(tests, "fragments") != NULL)
+		ok &= fragments_test(maxfrag, buflen);
+
+	if (strstr(tests, "bulk") != NULL)
+		ok &= bulk_test(buflen);
+
+	mowgli_eventloop_destroy(base_eventloop);
+	mowgli_free(data);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
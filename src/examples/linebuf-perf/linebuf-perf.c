@@ -0,0 +1,640 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * linebuf-perf.c: Line throughput and latency between pairs of linebufs.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+#include "platform/autoconf.h"	/* HAVE_OPENSSL */
+
+#ifndef _WIN32
+# include <netinet/tcp.h>
+#endif
+
+#ifdef HAVE_OPENSSL
+# include <openssl/pem.h>
+# include <openssl/rsa.h>
+# include <openssl/x509.h>
+#endif
+
+/* Connects -n pairs of linebufs, a client and a server end each, over
+ * socketpairs, loopback TCP or TLS over loopback TCP, and keeps -w lines
+ * of -l bytes in flight per pair for -d seconds in one of three patterns:
+ *
+ *   echo    clients send, servers echo back; latency is the round trip
+ *   fanin   clients send, servers take them in; latency is one way
+ *   fanout  every server end is sent each line once, shared; latency is
+ *           one way, to each client
+ *
+ * Every line carries the time it was queued, so latency includes waiting
+ * in the write queue.  Both ends live in this process, so the CPU per line
+ * is the cost of sending and receiving it.  Counting starts once every
+ * pair has got a line through (for TLS, once the handshakes are done) and
+ * a tenth of the run has gone by as a warm-up.
+ */
+
+typedef enum
+{
+	TRANSPORT_UNIX,
+	TRANSPORT_TCP,
+	TRANSPORT_TLS,
+} transport_t;
+
+typedef enum
+{
+	PATTERN_ECHO,
+	PATTERN_FANIN,
+	PATTERN_FANOUT,
+} pattern_t;
+
+typedef struct
+{
+	mowgli_linebuf_t *client;
+	mowgli_linebuf_t *server;
+	bool up;	/* a line has made it through */
+} pair_t;
+
+static const char *transport_names[] = { "unix", "tcp", "tls" };
+static const char *pattern_names[] = { "echo", "fanin", "fanout" };
+
+static mowgli_eventloop_t *base_eventloop;
+
+static transport_t transport = TRANSPORT_UNIX;
+static pattern_t pattern = PATTERN_ECHO;
+static int npairs = 64, linelen = 100, window = 8;
+static double duration = 3;
+static const char *cert_path, *key_path;
+
+static pair_t *pairs;
+static char *line;
+
+static bool measuring, stopping;
+static int pairs_up;
+static uint64_t lines, bytes, broadcasts, fanout_received;
+
+static double *samples;
+static size_t nsamples, cap;
+
+static int listen_fd = -1;
+static mowgli_vio_t *listener;
+static mowgli_vio_sockaddr_t listen_addr;
+
+static double
+now_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static double
+cpu_usec(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static void
+sample(double usec)
+{
+	if (nsamples == cap)
+	{
+		double *n;
+
+		cap = cap ? cap * 2 : 65536;
+		n = mowgli_alloc_array(sizeof(double), cap);
+
+		if (samples != NULL)
+		{
+			memcpy(n, samples, nsamples * sizeof(double));
+			mowgli_free(samples);
+		}
+
+		samples = n;
+	}
+
+	samples[nsamples++] = usec;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double
+percentile(double p)
+{
+	if (nsamples == 0)
+		return 0;
+
+	return samples[(size_t) (p / 100.0 * (nsamples - 1) + 0.5)];
+}
+
+/* Stamp the line with the time and pad it out to linelen */
+static void
+stamp_line(void)
+{
+	int len = snprintf(line, linelen + 1, "%.0f ", now_usec());
+
+	if (len < linelen)
+		memset(line + len, 'x', linelen - len);
+}
+
+static void
+arrived(pair_t *pair, const char *data, size_t len)
+{
+	double sent = strtod(data, NULL);
+
+	if (!pair->up)
+	{
+		pair->up = true;
+		pairs_up++;
+	}
+
+	if (!measuring)
+		return;
+
+	sample(now_usec() - sent);
+	lines++;
+	bytes += len + 2;
+}
+
+static void
+send_line(mowgli_linebuf_t *linebuf)
+{
+	stamp_line();
+	mowgli_linebuf_write(linebuf, line, linelen);
+}
+
+static void
+broadcast(void)
+{
+	mowgli_linebuf_msg_t *msg;
+	int i;
+
+	stamp_line();
+	msg = mowgli_linebuf_msg_create(line, linelen, "\r\n");
+
+	for (i = 0; i < npairs; i++)
+		mowgli_linebuf_write_shared(pairs[i].server, msg);
+
+	mowgli_object_unref(msg);
+	broadcasts++;
+}
+
+static void
+client_line(mowgli_linebuf_t *linebuf, char *data, size_t len, void *userdata)
+{
+	arrived(userdata, data, len);
+
+	if (stopping)
+		return;
+
+	if (pattern == PATTERN_ECHO)
+	{
+		send_line(linebuf);
+	}
+	else if (pattern == PATTERN_FANOUT)
+	{
+		/* keep window lines in flight to everyone */
+		fanout_received++;
+
+		while (broadcasts * npairs - fanout_received < (uint64_t) window * npairs)
+			broadcast();
+	}
+}
+
+static void
+server_line(mowgli_linebuf_t *linebuf, char *data, size_t len, void *userdata)
+{
+	pair_t *pair = userdata;
+
+	if (pattern == PATTERN_ECHO)
+	{
+		mowgli_linebuf_write(linebuf, data, len);
+		return;
+	}
+
+	arrived(pair, data, len);
+
+	if (!stopping)
+		send_line(pair->client);
+}
+
+static void
+set_nodelay(int fd)
+{
+	int one = 1;
+
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+}
+
+#ifdef HAVE_OPENSSL
+
+static char cert_tmp[] = "/tmp/linebuf-perf-cert.XXXXXX";
+static char key_tmp[] = "/tmp/linebuf-perf-key.XXXXXX";
+
+static void
+remove_cert(void)
+{
+	unlink(cert_tmp);
+	unlink(key_tmp);
+}
+
+static bool
+write_pem(char *path, X509 *x509, EVP_PKEY *pkey)
+{
+	int fd = mkstemp(path);
+	FILE *f;
+	bool ok;
+
+	if ((fd == -1) || ((f = fdopen(fd, "w")) == NULL))
+		return false;
+
+	ok = x509 != NULL ? PEM_write_X509(f, x509) : PEM_write_PrivateKey(f, pkey, NULL, NULL, 0, NULL, NULL);
+
+	fclose(f);
+
+	return ok;
+}
+
+/* A throwaway self-signed certificate for when none is given */
+static bool
+make_cert(void)
+{
+	EVP_PKEY_CTX *kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+	EVP_PKEY *pkey = NULL;
+	X509 *x509 = X509_new();
+	X509_NAME *name;
+	bool ok = false;
+
+	if ((kctx == NULL) || (x509 == NULL) || (EVP_PKEY_keygen_init(kctx) <= 0) ||
+	    (EVP_PKEY_CTX_set_rsa_keygen_bits(kctx, 2048) <= 0) || (EVP_PKEY_keygen(kctx, &pkey) <= 0))
+		goto out;
+
+	ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+	X509_gmtime_adj(X509_get_notBefore(x509), 0);
+	X509_gmtime_adj(X509_get_notAfter(x509), 86400);
+	X509_set_pubkey(x509, pkey);
+
+	name = X509_get_subject_name(x509);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "localhost", -1, -1, 0);
+	X509_set_issuer_name(x509, name);
+
+	if (!X509_sign(x509, pkey, EVP_sha256()))
+		goto out;
+
+	atexit(remove_cert);
+
+	if (!write_pem(cert_tmp, x509, NULL) || !write_pem(key_tmp, NULL, pkey))
+		goto out;
+
+	cert_path = cert_tmp;
+	key_path = key_tmp;
+	ok = true;
+
+out:
+	EVP_PKEY_CTX_free(kctx);
+	EVP_PKEY_free(pkey);
+	X509_free(x509);
+
+	return ok;
+}
+
+#endif
+
+static void
+make_listener(void)
+{
+	struct sockaddr_in sin;
+	socklen_t len = sizeof sin;
+	int fd;
+
+	if (transport == TRANSPORT_TCP)
+	{
+		int one = 1;
+
+		memset(&sin, 0, sizeof sin);
+		sin.sin_family = AF_INET;
+		sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (((listen_fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) ||
+		    (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) == -1) ||
+		    (bind(listen_fd, (struct sockaddr *) &sin, sizeof sin) == -1) ||
+		    (listen(listen_fd, SOMAXCONN) == -1) ||
+		    (getsockname(listen_fd, (struct sockaddr *) &sin, &len) == -1))
+		{
+			perror("listen");
+			exit(EXIT_FAILURE);
+		}
+
+		mowgli_vio_sockaddr_from_struct(&listen_addr, &sin, sizeof sin);
+		return;
+	}
+
+	mowgli_vio_ssl_settings_t settings = { cert_path, key_path, NULL, NULL };
+
+	listener = mowgli_vio_create(NULL);
+
+	if ((mowgli_vio_openssl_setssl(listener, &settings, NULL) != 0) ||
+	    (mowgli_vio_socket(listener, AF_INET, SOCK_STREAM, 0) != 0) ||
+	    (mowgli_vio_reuseaddr(listener) != 0) ||
+	    (mowgli_vio_bind(listener, mowgli_vio_sockaddr_create(&listen_addr, AF_INET, "127.0.0.1", 0)) != 0) ||
+	    (mowgli_vio_listen(listener, SOMAXCONN) != 0))
+	{
+		fprintf(stderr, "TLS listener: %s\n", listener->error.string);
+		exit(EXIT_FAILURE);
+	}
+
+	fd = mowgli_vio_getfd(listener);
+	getsockname(fd, (struct sockaddr *) &sin, &len);
+	mowgli_vio_sockaddr_from_struct(&listen_addr, &sin, sizeof sin);
+}
+
+static mowgli_linebuf_t *
+make_linebuf(mowgli_linebuf_readline_cb_t *cb, pair_t *pair)
+{
+	mowgli_linebuf_t *linebuf = mowgli_linebuf_create(cb, pair);
+
+	/* room for the whole window, shared or not */
+	mowgli_linebuf_setbuflen(&linebuf->readbuf, MAX(65536, 4 * (linelen + 2)));
+	mowgli_linebuf_setbuflen(&linebuf->writebuf, MAX(65536, 4 * window * (linelen + 2)));
+
+	return linebuf;
+}
+
+static void
+connect_pair(pair_t *pair)
+{
+	int sv[2];
+
+	pair->client = make_linebuf(client_line, pair);
+	pair->server = make_linebuf(server_line, pair);
+
+	switch (transport)
+	{
+	case TRANSPORT_UNIX:
+
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+		{
+			perror("socketpair");
+			exit(EXIT_FAILURE);
+		}
+
+		break;
+	case TRANSPORT_TCP:
+
+		/* loopback connects complete without the accept */
+		if (((sv[0] = socket(AF_INET, SOCK_STREAM, 0)) == -1) ||
+		    (connect(sv[0], (struct sockaddr *) &listen_addr.addr, listen_addr.addrlen) == -1) ||
+		    ((sv[1] = accept(listen_fd, NULL, NULL)) == -1))
+		{
+			perror("connect");
+			exit(EXIT_FAILURE);
+		}
+
+		set_nodelay(sv[0]);
+		set_nodelay(sv[1]);
+		break;
+	case TRANSPORT_TLS:
+	{
+		mowgli_vio_ssl_settings_t settings = { NULL, NULL, NULL, NULL };
+		mowgli_vio_t *vio = pair->client->vio;
+
+		/* the handshake is done by the first reads and writes */
+		if ((mowgli_vio_openssl_setssl(vio, &settings, NULL) != 0) ||
+		    (mowgli_vio_socket(vio, AF_INET, SOCK_STREAM, 0) != 0))
+		{
+			fprintf(stderr, "TLS client: %s\n", vio->error.string);
+			exit(EXIT_FAILURE);
+		}
+
+		set_nodelay(mowgli_vio_getfd(vio));
+		mowgli_linebuf_attach_to_eventloop(pair->client, base_eventloop);
+
+		if ((mowgli_vio_connect(vio, &listen_addr) != 0) ||
+		    (mowgli_vio_accept(listener, pair->server->vio) != 0) ||
+		    (mowgli_vio_getfd(pair->server->vio) == -1))
+		{
+			fprintf(stderr, "TLS connect: %s\n", vio->error.string);
+			exit(EXIT_FAILURE);
+		}
+
+		set_nodelay(mowgli_vio_getfd(pair->server->vio));
+		mowgli_linebuf_attach_to_eventloop(pair->server, base_eventloop);
+		return;
+	}
+	}
+
+	pair->client->vio->io.fd = sv[0];
+	pair->server->vio->io.fd = sv[1];
+	mowgli_linebuf_attach_to_eventloop(pair->client, base_eventloop);
+	mowgli_linebuf_attach_to_eventloop(pair->server, base_eventloop);
+}
+
+static void
+run(void)
+{
+	double start, warm, end, cpu = 0, secs;
+	uint64_t bad = 0;
+	int i, j;
+
+	for (i = 0; i < npairs; i++)
+		connect_pair(&pairs[i]);
+
+	for (i = 0; i < npairs; i++)
+		for (j = 0; j < window && pattern != PATTERN_FANOUT; j++)
+			send_line(pairs[i].client);
+
+	for (j = 0; j < window && pattern == PATTERN_FANOUT; j++)
+		broadcast();
+
+	start = now_usec();
+	warm = start + duration * 1e5;
+	end = start + 60 * 1e6;
+
+	while (now_usec() < end)
+	{
+		if (!measuring && (pairs_up == npairs) && (now_usec() >= warm))
+		{
+			measuring = true;
+			warm = now_usec();
+			end = warm + duration * 1e6;
+			cpu = cpu_usec();
+		}
+
+		mowgli_eventloop_timeout_once(base_eventloop, 10);
+	}
+
+	if (!measuring)
+	{
+		fprintf(stderr, "only %d of %d pairs got going\n", pairs_up, npairs);
+		exit(EXIT_FAILURE);
+	}
+
+	measuring = false;
+	secs = (now_usec() - warm) / 1e6;
+	cpu = cpu_usec() - cpu;
+
+	/* let what is in flight land, so nothing is left in an error state */
+	stopping = true;
+
+	for (i = 0; i < 20; i++)
+		mowgli_eventloop_timeout_once(base_eventloop, 10);
+
+	for (i = 0; i < npairs; i++)
+		if (pairs[i].client->flags & (MOWGLI_LINEBUF_ERR_READBUF_FULL | MOWGLI_LINEBUF_ERR_WRITEBUF_FULL) ||
+		    pairs[i].server->flags & (MOWGLI_LINEBUF_ERR_READBUF_FULL | MOWGLI_LINEBUF_ERR_WRITEBUF_FULL))
+			bad++;
+
+	qsort(samples, nsamples, sizeof(double), cmp_double);
+
+	printf("%-4s %-6s %5d pairs %6d byte lines  window %3d  %9.0f lines/s %8.1f MiB/s  %6.2f usec CPU/line\n",
+	       transport_names[transport], pattern_names[pattern], npairs, linelen + 2, window,
+	       lines / secs, bytes / secs / 1048576.0, lines ? cpu / lines : 0.0);
+	printf("     latency usec  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f%s\n",
+	       percentile(50), percentile(90), percentile(99), percentile(100),
+	       bad ? "  (buffers overflowed!)" : "");
+
+	for (i = 0; i < npairs; i++)
+	{
+		mowgli_linebuf_destroy(pairs[i].client);
+		mowgli_linebuf_destroy(pairs[i].server);
+	}
+
+	if (listen_fd != -1)
+		close(listen_fd);
+
+	if (listener != NULL)
+		mowgli_vio_destroy(listener);
+}
+
+static int
+lookup(const char *name, const char **names, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (!strcmp(name, names[i]))
+			return i;
+
+	return -1;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: linebuf-perf [-t unix|tcp|tls] [-p echo|fanin|fanout] [-n pairs] [-l line length]\n"
+		"                    [-w window] [-d seconds] [-c cert -k key]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct rlimit rl;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "t:p:n:l:w:d:c:k:")) != -1)
+	{
+		switch (c)
+		{
+		case 't':
+
+			if ((i = lookup(optarg, transport_names, 3)) == -1)
+				usage();
+
+			transport = i;
+			break;
+		case 'p':
+
+			if ((i = lookup(optarg, pattern_names, 3)) == -1)
+				usage();
+
+			pattern = i;
+			break;
+		case 'n':
+			npairs = atoi(optarg);
+			break;
+		case 'l':
+			linelen = atoi(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'c':
+			cert_path = optarg;
+			break;
+		case 'k':
+			key_path = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	/* room for the timestamp */
+	if ((npairs <= 0) || (linelen < 24) || (window <= 0) || (duration <= 0) || ((cert_path == NULL) != (key_path == NULL)))
+		usage();
+
+	if (transport == TRANSPORT_TLS)
+	{
+#ifdef HAVE_OPENSSL
+
+		if ((cert_path == NULL) && !make_cert())
+		{
+			fprintf(stderr, "could not make a certificate\n");
+			return EXIT_FAILURE;
+		}
+
+#else
+		fprintf(stderr, "built without OpenSSL\n");
+		return EXIT_FAILURE;
+#endif
+	}
+
+	if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < (rlim_t) (2 * npairs + 16)))
+	{
+		rl.rlim_cur = MIN((rlim_t) (2 * npairs + 16), rl.rlim_max);
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	base_eventloop = mowgli_eventloop_create();
+	pairs = mowgli_alloc_array(sizeof(pair_t), npairs);
+	line = mowgli_alloc(linelen + 1);
+
+	if (transport != TRANSPORT_UNIX)
+		make_listener();
+
+	run();
+
+	return EXIT_SUCCESS;
+}
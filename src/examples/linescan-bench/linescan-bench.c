@@ -0,0 +1,173 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * linescan-bench.c: Line splitting throughput of the linebuf scanner.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* Splits the same block of IRC-sized lines with the byte-at-a-time
+ * strchr() loop linebuf used to have, and with mowgli_linebuf_scan().
+ */
+
+#define DATA_SIZE (64 * 1024 * 1024)
+#define PASSES 5
+
+static char *data;
+static size_t datalen;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void
+generate(void)
+{
+	static const char words[] = "PRIVMSG #channel :the quick brown fox jumps over the lazy dog ";
+	mowgli_random_t *r = mowgli_random_create_with_seed(1);
+
+	data = mowgli_alloc(DATA_SIZE);
+
+	while (datalen < DATA_SIZE - 520)
+	{
+		size_t len = 20 + mowgli_random_int_ranged(r, 0, 400), i;
+
+		for (i = 0; i < len; i++)
+			data[datalen++] = words[i % (sizeof(words) - 1)];
+
+		data[datalen++] = '\r';
+		data[datalen++] = '\n';
+	}
+
+	mowgli_object_unref(r);
+}
+
+/* the loop from mowgli_linebuf_process() before it had a scanner */
+static size_t
+split_strchr(const char *delim)
+{
+	size_t len = 0, lines = 0;
+	char *cptr = data;
+
+	while (len < datalen)
+	{
+		if (!strchr(delim, *cptr))
+		{
+			cptr++;
+			len++;
+			continue;
+		}
+
+		lines++;
+
+		while (len < datalen && strchr(delim, *cptr))
+		{
+			len++;
+			cptr++;
+		}
+	}
+
+	return lines;
+}
+
+static size_t
+split_scan(mowgli_linebuf_t *linebuf)
+{
+	size_t len = 0, lines = 0;
+	char *cptr = data;
+
+	while (len < datalen)
+	{
+		size_t span = mowgli_linebuf_scan(linebuf, cptr, datalen - len);
+
+		cptr += span;
+		len += span;
+
+		if (len == datalen)
+			break;
+
+		lines++;
+
+		do
+		{
+			len++;
+			cptr++;
+		}
+		while (len < datalen && (*cptr == '\r' || *cptr == '\n'));
+	}
+
+	return lines;
+}
+
+static void
+report(const char *name, size_t lines, double secs)
+{
+	printf("%-8s %10zu lines %8.2f Mlines/s %8.1f MiB/s\n", name, lines,
+	       lines * PASSES / secs / 1e6, (double) datalen * PASSES / secs / 1048576.0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	mowgli_linebuf_t *linebuf;
+	size_t lines_strchr = 0, lines_scan = 0;
+	double start, t_strchr, t_scan;
+	int i;
+
+	generate();
+
+	linebuf = mowgli_linebuf_create(NULL, NULL);
+	mowgli_linebuf_delim(linebuf, "\r\n", "\r\n");
+
+	start = now();
+
+	for (i = 0; i < PASSES; i++)
+		lines_strchr = split_strchr("\r\n");
+
+	t_strchr = now() - start;
+
+	start = now();
+
+	for (i = 0; i < PASSES; i++)
+		lines_scan = split_scan(linebuf);
+
+	t_scan = now() - start;
+
+	printf("%zu bytes, %d passes, scanner: %s\n", datalen, PASSES, mowgli_linebuf_scan_impl());
+	report("strchr", lines_strchr, t_strchr);
+	report("scan", lines_scan, t_scan);
+	printf("speedup  %.2fx\n", t_strchr / t_scan);
+
+	mowgli_free(data);
+
+	if (lines_strchr != lines_scan)
+	{
+		fprintf(stderr, "line counts differ!\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
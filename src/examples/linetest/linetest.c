@@ -136,17 +136,131 @@ eat_line(mowgli_linebuf_t *linebuf, char *line, size_t len, void *userdata)
 	return;
 }
 
+static int idle_lines;
+
+void
+idle_line(mowgli_linebuf_t *linebuf, char *line, size_t len, void *userdata)
+{
+	idle_lines++;
+	mowgli_linebuf_write(linebuf, "PONG :idle", 10);
+}
+
+static long
+rss_kib(void)
+{
+	long pages = 0, rss = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+
+	if (f == NULL)
+		return 0;
+
+	if (fscanf(f, "%ld %ld", &pages, &rss) != 2)
+		rss = 0;
+
+	fclose(f);
+
+	return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* Memory held by count connections that have each exchanged a line and
+ * then gone quiet, over socketpairs so no server is needed.
+ */
+int
+idle_test(int count)
+{
+	mowgli_linebuf_t **linebufs = mowgli_alloc_array(sizeof(mowgli_linebuf_t *), count);
+	mowgli_descriptor_t *peers = mowgli_alloc_array(sizeof(mowgli_descriptor_t), count);
+	mowgli_linebuf_pool_stats_t stats;
+	size_t bufbytes = 0;
+	struct rlimit rl;
+	long rss_before;
+	int i, sv[2];
+
+	if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < (rlim_t) count * 2 + 16))
+	{
+		rl.rlim_cur = MIN((rlim_t) count * 2 + 16, rl.rlim_max);
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	rss_before = rss_kib();
+
+	for (i = 0; i < count; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+		{
+			perror("socketpair");
+			return EXIT_FAILURE;
+		}
+
+		linebufs[i] = mowgli_linebuf_create(idle_line, NULL);
+		linebufs[i]->vio->io.fd = sv[0];
+		mowgli_linebuf_attach_to_eventloop(linebufs[i], base_eventloop);
+
+		peers[i] = sv[1];
+
+		if (write(peers[i], "PING :idle\r\n", 12) != 12)
+			return EXIT_FAILURE;
+	}
+
+	while (idle_lines < count)
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+	/* let the replies drain */
+	mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+	/* only count buffers still held; the rest went back to the pool, as
+	 * do write queue segments once they are sent
+	 */
+	for (i = 0; i < count; i++)
+	{
+		bufbytes += sizeof(mowgli_linebuf_t);
+
+		if (linebufs[i]->readbuf.buffer != NULL)
+			bufbytes += linebufs[i]->readbuf.bufsize;
+	}
+
+	mowgli_linebuf_pool_get_stats(&stats);
+
+	printf("%d idle connections\n", count);
+	printf("linebuf memory per connection: %zu bytes (was %zu with fixed 64 KiB buffers)\n",
+	       bufbytes / count, sizeof(mowgli_linebuf_t) + 2 * 65536);
+	printf("buffer pool: %zu bytes lent out, %zu bytes cached\n", stats.in_use, stats.cached);
+
+	if (rss_before > 0)
+		printf("process RSS growth per connection: %ld bytes\n", (rss_kib() - rss_before) * 1024 / count);
+
+	for (i = 0; i < count; i++)
+	{
+		mowgli_linebuf_destroy(linebufs[i]);
+		close(peers[i]);
+	}
+
+	mowgli_free(linebufs);
+	mowgli_free(peers);
+
+	return EXIT_SUCCESS;
+}
+
 int
 main(int argc, const char *argv[])
 {
 	client_t *client;
 	const char *serv, *port;
 
+	if ((argc == 3) && !strcmp(argv[1], "-i"))
+	{
+		base_eventloop = mowgli_eventloop_create();
+
+		return idle_test(atoi(argv[2]) > 0 ? atoi(argv[2]) : 1000);
+	}
+
 	if (argc < 3)
 	{
 		fprintf(stderr, "Not enough arguments\n");
 		fprintf(stderr, "Usage: %s [server] [(+)port]\n", argv[0]);
+		fprintf(stderr, "       %s -i [connections]\n", argv[0]);
 		fprintf(stderr, "For SSL, put a + in front of port\n");
+		fprintf(stderr, "-i reports the memory held by idle connections\n");
 		return EXIT_FAILURE;
 	}
 
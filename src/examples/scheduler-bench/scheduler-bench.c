@@ -0,0 +1,160 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * scheduler-bench.c: Scaling of the work-stealing scheduler
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* below this, recursion is done serially so task overhead stays small */
+#define CUTOFF 18
+
+#define ARRAY_SIZE (16 * 1024 * 1024)
+
+typedef struct
+{
+	mowgli_scheduler_t *scheduler;
+	int n;
+	uint64_t result;
+} fib_t;
+
+static uint64_t
+fib_serial(int n)
+{
+	return n < 2 ? (uint64_t) n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+static void
+fib_task(void *arg)
+{
+	fib_t *f = arg;
+	fib_t a, b;
+	mowgli_task_group_t group;
+
+	if (f->n < CUTOFF)
+	{
+		f->result = fib_serial(f->n);
+		return;
+	}
+
+	a.scheduler = b.scheduler = f->scheduler;
+	a.n = f->n - 1;
+	b.n = f->n - 2;
+
+	mowgli_task_group_init(&group, f->scheduler);
+	mowgli_task_group_spawn(&group, fib_task, &a);
+	fib_task(&b);
+	mowgli_task_group_wait(&group);
+
+	f->result = a.result + b.result;
+}
+
+static double *array;
+static double partial[1024];
+
+static void
+sum_range(size_t begin, size_t end, void *arg)
+{
+	double sum = 0;
+	size_t i;
+
+	for (i = begin; i < end; i++)
+		sum += array[i] * array[i];
+
+	/* ranges are grain-aligned, so each slot is written by one range */
+	partial[begin / (ARRAY_SIZE / 1024)] = sum;
+}
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned int threads, maxthreads = 0;
+	int n = argc > 1 ? atoi(argv[1]) : 40;
+	double t, serial;
+	uint64_t expected;
+	size_t i;
+
+	if (argc > 2)
+		maxthreads = atoi(argv[2]);
+
+	if (maxthreads == 0)
+		maxthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	array = mowgli_alloc_array(sizeof(double), ARRAY_SIZE);
+
+	for (i = 0; i < ARRAY_SIZE; i++)
+		array[i] = i % 1000;
+
+	t = now();
+	expected = fib_serial(n);
+	serial = now() - t;
+
+	printf("fib(%d) = %" PRIu64 ", serial %.3fs, %u CPUs online\n", n, expected, serial,
+	       (unsigned int) sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%8s %10s %8s %12s\n", "threads", "fib", "speedup", "parallel_for");
+
+	for (threads = 1; threads <= maxthreads; threads *= 2)
+	{
+		mowgli_scheduler_t *scheduler = mowgli_scheduler_create(threads);
+		fib_t f = { scheduler, n, 0 };
+		double tfib, tfor, sum = 0;
+
+		if (scheduler == NULL)
+		{
+			fprintf(stderr, "couldn't start %u threads\n", threads);
+			break;
+		}
+
+		t = now();
+		fib_task(&f);
+		tfib = now() - t;
+
+		if (f.result != expected)
+			printf("wrong result %" PRIu64 "\n", f.result);
+
+		t = now();
+		mowgli_parallel_for(scheduler, 0, ARRAY_SIZE, ARRAY_SIZE / 1024, sum_range, NULL);
+		tfor = now() - t;
+
+		for (i = 0; i < 1024; i++)
+			sum += partial[i];
+
+		printf("%8u %9.3fs %7.2fx %11.4fs (sum %.0f)\n", threads, tfib, serial / tfib, tfor, sum);
+
+		mowgli_scheduler_destroy(scheduler);
+
+		if ((threads < maxthreads) && (threads * 2 > maxthreads))
+			threads = maxthreads / 2;
+	}
+
+	mowgli_free(array);
+
+	return EXIT_SUCCESS;
+}
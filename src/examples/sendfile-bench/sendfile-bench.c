@@ -0,0 +1,334 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * sendfile-bench.c: Sending a file over a socket with and without copies.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* Sends a -s MiB scratch file (in the page cache, having just been
+ * written) over a socketpair or loopback TCP to a child process which
+ * hashes it, three ways:
+ *
+ *   copy      pread() into a buffer and mowgli_vio_write() it out, as had
+ *             to be done before
+ *   sendfile  mowgli_vio_sendfile() from the eventloop's write callback
+ *   linebuf   mowgli_linebuf_write_file() and let the linebuf get on with it
+ *
+ * CPU is the sending process's alone.
+ */
+
+#define CHUNK 65536
+
+static mowgli_eventloop_t *base_eventloop;
+
+static size_t file_size = 128 * 1024 * 1024;
+static bool use_tcp;
+static int file_fd;
+static uint32_t file_hash;
+
+static mowgli_vio_t *vio;
+static int send_fd;
+static off_t sent;
+static bool done;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double
+cpu(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static uint32_t
+hash(uint32_t h, const unsigned char *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ data[i]) * 16777619U;
+
+	return h;
+}
+
+static void
+make_file(void)
+{
+	char path[] = "/tmp/sendfile-bench.XXXXXX";
+	unsigned char *buf = mowgli_alloc(CHUNK);
+	mowgli_random_t *r = mowgli_random_create_with_seed(42);
+	size_t done_bytes, i, n;
+
+	if ((file_fd = mkstemp(path)) == -1)
+	{
+		perror("mkstemp");
+		exit(EXIT_FAILURE);
+	}
+
+	unlink(path);
+	file_hash = 2166136261U;
+
+	for (done_bytes = 0; done_bytes < file_size; done_bytes += n)
+	{
+		n = MIN(CHUNK, file_size - done_bytes);
+
+		for (i = 0; i < n; i++)
+			buf[i] = mowgli_random_int(r);
+
+		file_hash = hash(file_hash, buf, n);
+
+		if (write(file_fd, buf, n) != (ssize_t) n)
+		{
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	mowgli_object_unref(r);
+	mowgli_free(buf);
+}
+
+/* The child: hash everything until EOF and send the hash back */
+static void
+receive(int fd)
+{
+	unsigned char *buf = mowgli_alloc(CHUNK);
+	uint32_t h = 2166136261U;
+	ssize_t n;
+
+	while ((n = read(fd, buf, CHUNK)) > 0)
+		h = hash(h, buf, n);
+
+	if (write(fd, &h, sizeof h) != sizeof h)
+		_exit(EXIT_FAILURE);
+
+	_exit(EXIT_SUCCESS);
+}
+
+static void
+connect_pair(int fds[2])
+{
+	struct sockaddr_in sin;
+	socklen_t len = sizeof sin;
+	int lfd, one = 1;
+
+	if (!use_tcp)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+		{
+			perror("socketpair");
+			exit(EXIT_FAILURE);
+		}
+
+		return;
+	}
+
+	memset(&sin, 0, sizeof sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (((lfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) ||
+	    (setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) == -1) ||
+	    (bind(lfd, (struct sockaddr *) &sin, sizeof sin) == -1) ||
+	    (listen(lfd, 1) == -1) ||
+	    (getsockname(lfd, (struct sockaddr *) &sin, &len) == -1) ||
+	    ((fds[0] = socket(AF_INET, SOCK_STREAM, 0)) == -1) ||
+	    (connect(fds[0], (struct sockaddr *) &sin, sizeof sin) == -1) ||
+	    ((fds[1] = accept(lfd, NULL, NULL)) == -1))
+	{
+		perror("connect");
+		exit(EXIT_FAILURE);
+	}
+
+	close(lfd);
+}
+
+static void
+send_copy(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	static char buf[CHUNK];
+	ssize_t n;
+	int ret;
+
+	while ((size_t) sent < file_size)
+	{
+		if ((n = pread(file_fd, buf, MIN(CHUNK, file_size - sent), sent)) <= 0)
+			break;
+
+		/* write drops the callback when the socket is full */
+		if ((ret = mowgli_vio_write(vio, buf, n)) <= 0)
+		{
+			mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_WRITE, send_copy);
+			return;
+		}
+
+		sent += ret;
+
+		if (ret < n)
+			return;
+	}
+
+	done = true;
+}
+
+static void
+send_file(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	while ((size_t) sent < file_size)
+		if (mowgli_vio_sendfile(vio, file_fd, &sent, file_size - sent) <= 0)
+			return;
+
+	done = true;
+}
+
+static void
+run(const char *name)
+{
+	mowgli_vio_evops_t evops = { 0 };
+	mowgli_linebuf_t *linebuf;
+	double start, secs, cpu_start;
+	uint32_t h;
+	pid_t pid;
+	int fds[2];
+
+	connect_pair(fds);
+
+	if ((pid = fork()) == -1)
+	{
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pid == 0)
+	{
+		close(fds[0]);
+		receive(fds[1]);
+	}
+
+	close(fds[1]);
+
+	sent = 0;
+	done = false;
+	start = now();
+	cpu_start = cpu();
+
+	if (!strcmp(name, "linebuf"))
+	{
+		linebuf = mowgli_linebuf_create(NULL, NULL);
+		linebuf->vio->io.fd = fds[0];
+		mowgli_linebuf_attach_to_eventloop(linebuf, base_eventloop);
+		mowgli_linebuf_write_file(linebuf, dup(file_fd), 0, file_size);
+
+		while (linebuf->writeq.head != NULL)
+			mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+		/* the linebuf closes the socket too */
+		send_fd = dup(fds[0]);
+		mowgli_linebuf_destroy(linebuf);
+	}
+	else
+	{
+		vio = mowgli_vio_create(NULL);
+		vio->io.fd = fds[0];
+		evops.write_cb = !strcmp(name, "copy") ? send_copy : send_file;
+		mowgli_vio_eventloop_attach(vio, base_eventloop, &evops);
+		mowgli_pollable_setselect(base_eventloop, vio->io.e, MOWGLI_EVENTLOOP_IO_WRITE, evops.write_cb);
+
+		while (!done)
+			mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+		send_fd = dup(fds[0]);
+		mowgli_vio_destroy(vio);
+	}
+
+	secs = now() - start;
+	cpu_start = cpu() - cpu_start;
+
+	/* back to blocking for the hash */
+	fcntl(send_fd, F_SETFL, fcntl(send_fd, F_GETFL) & ~O_NONBLOCK);
+	shutdown(send_fd, SHUT_WR);
+
+	if (read(send_fd, &h, sizeof h) != sizeof h)
+		h = ~file_hash;
+
+	close(send_fd);
+	waitpid(pid, NULL, 0);
+
+	printf("%-8s %8.1f MiB/s  %6.3f s CPU  %6.2f ms CPU/MiB  %s\n", name, file_size / secs / 1048576.0,
+	       cpu_start, cpu_start * 1e3 / (file_size / 1048576.0), h == file_hash ? "ok" : "MISMATCH");
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: sendfile-bench [-s MiB] [-t]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "s:t")) != -1)
+	{
+		switch (c)
+		{
+		case 's':
+			file_size = strtoul(optarg, NULL, 10) * 1024 * 1024;
+			break;
+		case 't':
+			use_tcp = true;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (file_size == 0)
+		usage();
+
+	make_file();
+
+	base_eventloop = mowgli_eventloop_create();
+
+	printf("%zu MiB over %s\n", file_size / 1048576, use_tcp ? "loopback TCP" : "a socketpair");
+
+	run("copy");
+	run("sendfile");
+	run("linebuf");
+
+	mowgli_eventloop_destroy(base_eventloop);
+	close(file_fd);
+
+	return EXIT_SUCCESS;
+}
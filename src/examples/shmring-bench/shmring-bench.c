@@ -0,0 +1,202 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * shmring-bench.c: Bulk transfer to a helper, socketpair vs shared memory
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+#define TOTAL ((uint64_t) 1024 * 1024 * 1024)
+#define CHUNK 65536
+#define RINGSIZE (1024 * 1024)
+
+static char chunk[CHUNK];
+static uint64_t sent;
+static struct timeval start;
+
+static void
+report(const char *what, uint64_t sum)
+{
+	struct timeval end;
+	double secs;
+
+	gettimeofday(&end, NULL);
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+
+	printf("%-12s %" PRIu64 " MiB in %.3fs, %.0f MiB/s (checksum %" PRIu64 ")\n",
+	       what, TOTAL >> 20, secs, (TOTAL >> 20) / secs, sum);
+}
+
+/* helpers: add up every byte received, send the sum back over the socket */
+static void
+socket_helper(mowgli_eventloop_helper_proc_t *helper, void *userdata)
+{
+	static char buf[CHUNK];
+	uint64_t got = 0, sum = 0;
+
+	mowgli_pollable_set_nonblocking(helper->pfd, false);
+
+	while (got < TOTAL)
+	{
+		ssize_t i, ret = read(helper->fd, buf, sizeof buf);
+
+		if (ret <= 0)
+			_exit(EXIT_FAILURE);
+
+		for (i = (64 - got % 64) % 64; i < ret; i += 64)
+			sum += (unsigned char) buf[i];
+
+		got += ret;
+	}
+
+	if (write(helper->fd, &sum, sizeof sum) != sizeof sum)
+		_exit(EXIT_FAILURE);
+
+	_exit(EXIT_SUCCESS);
+}
+
+static void
+shm_helper(mowgli_eventloop_helper_proc_t *helper, void *userdata)
+{
+	uint64_t got = 0, sum = 0;
+
+	while (got < TOTAL)
+	{
+		const unsigned char *p;
+		size_t i, len;
+
+		p = mowgli_shmring_peek(helper->in_ring, &len);
+
+		if (len == 0)
+		{
+			mowgli_shmring_wait(helper->in_ring, MOWGLI_EVENTLOOP_IO_READ, -1);
+			continue;
+		}
+
+		for (i = (64 - got % 64) % 64; i < len; i += 64)
+			sum += p[i];
+
+		mowgli_shmring_consume(helper->in_ring, len);
+		got += len;
+	}
+
+	if (write(helper->fd, &sum, sizeof sum) != sizeof sum)
+		_exit(EXIT_FAILURE);
+
+	_exit(EXIT_SUCCESS);
+}
+
+static void
+sum_read(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_helper_proc_t *helper = mowgli_eventloop_io_helper(io);
+	uint64_t sum;
+
+	if (read(helper->fd, &sum, sizeof sum) != sizeof sum)
+		return;
+
+	report(helper->out_ring != NULL ? "shmring" : "socketpair", sum);
+	mowgli_eventloop_break(eventloop);
+}
+
+static void
+socket_write(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_helper_proc_t *helper = userdata;
+
+	while (sent < TOTAL)
+	{
+		ssize_t ret = write(helper->fd, chunk + sent % CHUNK, MIN(CHUNK - sent % CHUNK, TOTAL - sent));
+
+		if (ret <= 0)
+			return;
+
+		sent += ret;
+	}
+
+	mowgli_pollable_setselect(eventloop, helper->pfd, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
+}
+
+static void
+shm_write(mowgli_eventloop_t *eventloop, mowgli_shmring_t *ring, void *userdata)
+{
+	while (sent < TOTAL)
+	{
+		size_t ret = mowgli_shmring_write(ring, chunk + sent % CHUNK, MIN(CHUNK - sent % CHUNK, TOTAL - sent));
+
+		if (ret == 0)
+			return;
+
+		sent += ret;
+	}
+
+	mowgli_shmring_setselect(eventloop, ring, MOWGLI_EVENTLOOP_IO_WRITE, NULL, NULL);
+}
+
+static void
+run(bool shm)
+{
+	mowgli_eventloop_t *eventloop = mowgli_eventloop_create();
+	mowgli_eventloop_helper_proc_t *helper;
+	mowgli_process_t *child;
+
+	sent = 0;
+	gettimeofday(&start, NULL);
+
+	if (shm)
+		helper = mowgli_helper_create_shm(eventloop, shm_helper, "shmring-bench helper", NULL, RINGSIZE);
+	else
+		helper = mowgli_helper_create(eventloop, socket_helper, "shmring-bench helper", NULL);
+
+	if (helper == NULL)
+	{
+		fprintf(stderr, "couldn't create helper\n");
+		exit(EXIT_FAILURE);
+	}
+
+	mowgli_helper_set_read_cb(eventloop, helper, sum_read);
+
+	if (shm)
+		mowgli_shmring_setselect(eventloop, helper->out_ring, MOWGLI_EVENTLOOP_IO_WRITE, shm_write, NULL);
+	else
+		mowgli_pollable_setselect(eventloop, helper->pfd, MOWGLI_EVENTLOOP_IO_WRITE, socket_write);
+
+	mowgli_eventloop_run(eventloop);
+
+	child = helper->child;
+	mowgli_helper_destroy(eventloop, helper);
+	waitpid(child->pid, NULL, 0);
+	mowgli_free(child);
+	mowgli_eventloop_destroy(eventloop);
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t i;
+
+	for (i = 0; i < sizeof chunk; i++)
+		chunk[i] = i * 7;
+
+	run(false);
+	run(true);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * smallio-bench.c: Many small reads and writes, with and without buffering.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* A child writes -n records of -s bytes over a socketpair the way a DNS
+ * or protocol encoder might: a two-byte length, then the body, each its
+ * own mowgli_vio_write().  The parent parses them back the same way, a
+ * mowgli_vio_read() for the length and another for the body.  Both ends
+ * do it once over plain VIOs and once with mowgli_vio_buffered_push().
+ * Each side's CPU is counted, as both share the machine.
+ */
+
+static int nrecords = 200000;
+static size_t size = 24;
+static size_t bufsize = 16384;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double
+cpu(int who)
+{
+	struct rusage ru;
+
+	getrusage(who, &ru);
+
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static mowgli_vio_t *
+make_vio(int fd, bool buffered)
+{
+	mowgli_vio_t *vio = mowgli_vio_create(NULL);
+
+	vio->io.fd = fd;
+
+	if (buffered)
+		mowgli_vio_buffered_push(vio, bufsize, bufsize);
+
+	return vio;
+}
+
+static bool
+io_full(mowgli_vio_t *vio, void *buf, size_t len, bool do_read)
+{
+	char *p = buf;
+	int ret;
+
+	while (len > 0)
+	{
+		if ((ret = do_read ? mowgli_vio_read(vio, p, len) : mowgli_vio_write(vio, p, len)) <= 0)
+			return false;
+
+		p += ret;
+		len -= ret;
+	}
+
+	return true;
+}
+
+static void
+writer(int fd, bool buffered)
+{
+	mowgli_vio_t *vio = make_vio(fd, buffered);
+	char *body = mowgli_alloc(size);
+	unsigned char hdr[2] = { size >> 8, size & 0xff };
+	int i;
+
+	memset(body, 'x', size);
+
+	for (i = 0; i < nrecords; i++)
+		if (!io_full(vio, hdr, sizeof hdr, false) || !io_full(vio, body, size, false))
+			_exit(EXIT_FAILURE);
+
+	while (mowgli_vio_flush(vio) > 0)
+		;
+
+	mowgli_vio_destroy(vio);
+	_exit(EXIT_SUCCESS);
+}
+
+static void
+bench(const char *name, bool buffered)
+{
+	mowgli_vio_t *vio;
+	unsigned char hdr[2];
+	char body[65536];
+	double start, secs, cpu_self, cpu_child;
+	int sv[2], i, status;
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	start = now();
+	cpu_self = cpu(RUSAGE_SELF);
+	cpu_child = cpu(RUSAGE_CHILDREN);
+
+	if ((pid = fork()) == -1)
+	{
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pid == 0)
+	{
+		close(sv[0]);
+		writer(sv[1], buffered);
+	}
+
+	close(sv[1]);
+	vio = make_vio(sv[0], buffered);
+
+	for (i = 0; i < nrecords; i++)
+	{
+		if (!io_full(vio, hdr, sizeof hdr, true) || !io_full(vio, body, (hdr[0] << 8) | hdr[1], true))
+		{
+			fprintf(stderr, "%s: short after %d records\n", name, i);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	waitpid(pid, &status, 0);
+
+	secs = now() - start;
+	cpu_self = cpu(RUSAGE_SELF) - cpu_self;
+	cpu_child = cpu(RUSAGE_CHILDREN) - cpu_child;
+
+	printf("%-9s %10.0f records/s  %6.3f usec CPU/record (read %.3f, write %.3f)\n", name, nrecords / secs,
+	       (cpu_self + cpu_child) * 1e6 / nrecords, cpu_self * 1e6 / nrecords, cpu_child * 1e6 / nrecords);
+
+	mowgli_vio_destroy(vio);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: smallio-bench [-n records] [-s bytes] [-b buffer bytes]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "n:s:b:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			nrecords = atoi(optarg);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			bufsize = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((nrecords <= 0) || (size == 0) || (size > 65535) || (bufsize == 0))
+		usage();
+
+	printf("%d records of %zu bytes, %zu byte buffers\n", nrecords, size, bufsize);
+
+	bench("plain", false);
+	bench("buffered", true);
+
+	return EXIT_SUCCESS;
+}
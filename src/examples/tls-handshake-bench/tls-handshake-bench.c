@@ -0,0 +1,332 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * tls-handshake-bench.c: TLS handshakes per second, with and without resumption.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+#include "platform/autoconf.h"	/* HAVE_OPENSSL */
+
+#ifdef HAVE_OPENSSL
+
+#include <netinet/tcp.h>
+
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+/* Connects to a TLS listener over loopback, one connection after another
+ * for -d seconds, and reports handshakes per second three ways:
+ *
+ *   full     a context of its own for every client, so nothing to resume,
+ *            as every connection was before contexts were shared
+ *   tickets  the default client context, resuming with session tickets
+ *   cache    the same, against a listener keeping sessions itself
+ *
+ * The client waits for a byte from the server before hanging up, so that
+ * TLS 1.3 tickets, which follow the handshake, have arrived.  Both ends
+ * live in this process, so the CPU is that of both sides of a handshake.
+ */
+
+typedef enum
+{
+	MODE_FULL,
+	MODE_TICKETS,
+	MODE_CACHE,
+} bench_mode_t;
+
+static const char *mode_names[] = { "full", "tickets", "cache" };
+
+static double duration = 2;
+static const char *cert_path, *key_path;
+
+static mowgli_vio_t *listeners[2];
+static mowgli_vio_sockaddr_t listen_addrs[2];
+
+static char cert_tmp[] = "/tmp/tls-handshake-bench-cert.XXXXXX";
+static char key_tmp[] = "/tmp/tls-handshake-bench-key.XXXXXX";
+
+static void
+remove_cert(void)
+{
+	unlink(cert_tmp);
+	unlink(key_tmp);
+}
+
+static bool
+write_pem(char *path, X509 *x509, EVP_PKEY *pkey)
+{
+	int fd = mkstemp(path);
+	FILE *f;
+	bool ok;
+
+	if ((fd == -1) || ((f = fdopen(fd, "w")) == NULL))
+		return false;
+
+	ok = x509 != NULL ? PEM_write_X509(f, x509) : PEM_write_PrivateKey(f, pkey, NULL, NULL, 0, NULL, NULL);
+
+	fclose(f);
+
+	return ok;
+}
+
+/* A throwaway self-signed certificate for when none is given */
+static bool
+make_cert(void)
+{
+	EVP_PKEY_CTX *kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+	EVP_PKEY *pkey = NULL;
+	X509 *x509 = X509_new();
+	X509_NAME *name;
+	bool ok = false;
+
+	if ((kctx == NULL) || (x509 == NULL) || (EVP_PKEY_keygen_init(kctx) <= 0) ||
+	    (EVP_PKEY_CTX_set_rsa_keygen_bits(kctx, 2048) <= 0) || (EVP_PKEY_keygen(kctx, &pkey) <= 0))
+		goto out;
+
+	ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+	X509_gmtime_adj(X509_get_notBefore(x509), 0);
+	X509_gmtime_adj(X509_get_notAfter(x509), 86400);
+	X509_set_pubkey(x509, pkey);
+
+	name = X509_get_subject_name(x509);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "localhost", -1, -1, 0);
+	X509_set_issuer_name(x509, name);
+
+	if (!X509_sign(x509, pkey, EVP_sha256()))
+		goto out;
+
+	atexit(remove_cert);
+
+	if (!write_pem(cert_tmp, x509, NULL) || !write_pem(key_tmp, NULL, pkey))
+		goto out;
+
+	cert_path = cert_tmp;
+	key_path = key_tmp;
+	ok = true;
+
+out:
+	EVP_PKEY_CTX_free(kctx);
+	EVP_PKEY_free(pkey);
+	X509_free(x509);
+
+	return ok;
+}
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double
+cpu(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void
+make_listener(int i, bool no_tickets)
+{
+	mowgli_vio_ssl_settings_t settings = { .cert_path = cert_path, .privatekey_path = key_path, .no_tickets = no_tickets };
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof ss;
+	mowgli_vio_t *vio = listeners[i] = mowgli_vio_create(NULL);
+
+	if ((mowgli_vio_openssl_setssl(vio, &settings, NULL) != 0) ||
+	    (mowgli_vio_socket(vio, AF_INET, SOCK_STREAM, 0) != 0) ||
+	    (mowgli_vio_reuseaddr(vio) != 0) ||
+	    (mowgli_vio_bind(vio, mowgli_vio_sockaddr_create(&listen_addrs[i], AF_INET, "127.0.0.1", 0)) != 0) ||
+	    (mowgli_vio_listen(vio, SOMAXCONN) != 0))
+	{
+		fprintf(stderr, "TLS listener: %s\n", vio->error.string);
+		exit(EXIT_FAILURE);
+	}
+
+	getsockname(mowgli_vio_getfd(vio), (struct sockaddr *) &ss, &len);
+	mowgli_vio_sockaddr_from_struct(&listen_addrs[i], &ss, len);
+}
+
+/* One connection, start to finish; returns whether it resumed */
+static bool
+handshake(bench_mode_t mode)
+{
+	mowgli_vio_ssl_settings_t settings = { 0 };
+	mowgli_vio_t *client = mowgli_vio_create(NULL);
+	mowgli_vio_t *server = mowgli_vio_create(NULL);
+	mowgli_vio_t *listener = listeners[mode == MODE_CACHE];
+	bool sent = false, resumed;
+	int fd, ret, one = 1, spins = 0;
+	char c;
+
+	if (mode == MODE_FULL)
+		settings.context = mowgli_vio_openssl_context_create(NULL, false);
+
+	if ((mowgli_vio_openssl_setssl(client, &settings, NULL) != 0) ||
+	    (mowgli_vio_socket(client, AF_INET, SOCK_STREAM, 0) != 0))
+	{
+		fprintf(stderr, "TLS client: %s\n", client->error.string);
+		exit(EXIT_FAILURE);
+	}
+
+	/* the client holds a reference of its own now */
+	if (settings.context != NULL)
+		mowgli_vio_openssl_context_unref(settings.context);
+
+	/* everything is driven from here, so neither end may block */
+	fd = mowgli_vio_getfd(client);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	/* or wait out delayed ACKs between the handshake's flights */
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+	/* loopback connects complete without the accept */
+	if ((mowgli_vio_connect(client, &listen_addrs[mode == MODE_CACHE]) != 0) ||
+	    (mowgli_vio_accept(listener, server) != 0) || (mowgli_vio_getfd(server) == -1))
+	{
+		fprintf(stderr, "TLS connect: %s\n", client->error.string);
+		exit(EXIT_FAILURE);
+	}
+
+	setsockopt(mowgli_vio_getfd(server), IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+	/* the handshake is done by reads on both ends */
+	while ((ret = mowgli_vio_read(client, &c, 1)) != 1)
+	{
+		if ((ret < 0) || (mowgli_vio_read(server, &c, 1) < 0))
+		{
+			fprintf(stderr, "TLS handshake: %s\n", ret < 0 ? client->error.string : server->error.string);
+			exit(EXIT_FAILURE);
+		}
+
+		if (!sent && SSL_is_init_finished((SSL *) mowgli_vio_openssl_getsslhandle(server)))
+			sent = mowgli_vio_write(server, "x", 1) == 1;
+
+		if (++spins > 100000)
+		{
+			fprintf(stderr, "handshake stuck\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	resumed = SSL_session_reused((SSL *) mowgli_vio_openssl_getsslhandle(client));
+
+	mowgli_vio_destroy(client);
+	mowgli_vio_destroy(server);
+
+	return resumed;
+}
+
+static void
+bench(bench_mode_t mode)
+{
+	unsigned long count = 0, resumed = 0;
+	double start, secs, cpu_start;
+
+	/* one to get a session to resume */
+	handshake(mode);
+
+	start = now();
+	cpu_start = cpu();
+
+	do
+	{
+		resumed += handshake(mode);
+		count++;
+	} while (now() - start < duration);
+
+	secs = now() - start;
+	cpu_start = cpu() - cpu_start;
+
+	printf("%-8s %8.0f handshakes/s  %7.1f usec CPU/handshake  %5.1f%% resumed\n", mode_names[mode], count / secs,
+	       cpu_start * 1e6 / count, 100.0 * resumed / count);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: tls-handshake-bench [-d seconds] [-c cert -k key]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "d:c:k:")) != -1)
+	{
+		switch (c)
+		{
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'c':
+			cert_path = optarg;
+			break;
+		case 'k':
+			key_path = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((duration <= 0) || ((cert_path == NULL) != (key_path == NULL)))
+		usage();
+
+	if ((cert_path == NULL) && !make_cert())
+	{
+		fprintf(stderr, "could not make a certificate\n");
+		return EXIT_FAILURE;
+	}
+
+	make_listener(0, false);
+	make_listener(1, true);
+
+	bench(MODE_FULL);
+	bench(MODE_TICKETS);
+	bench(MODE_CACHE);
+
+	mowgli_vio_destroy(listeners[0]);
+	mowgli_vio_destroy(listeners[1]);
+
+	return EXIT_SUCCESS;
+}
+
+#else
+
+int
+main(int argc, char *argv[])
+{
+	fprintf(stderr, "built without OpenSSL\n");
+	return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,517 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * tls-idle-bench.c: What an idle TLS connection costs in memory.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+#include "platform/autoconf.h"	/* HAVE_OPENSSL */
+
+#ifdef HAVE_OPENSSL
+
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+/* Opens -n TLS connections over loopback to a server in a child process,
+ * has each carry one line there and back, and then, with all of them idle,
+ * reports what each costs on either side: the bytes OpenSSL has allocated,
+ * the whole heap, and the linebuf pool.  It does so once as things were
+ * and once with the lean setting.
+ *
+ * The server lives in another process so that neither needs more than -n
+ * descriptors.
+ */
+
+/* At most this many handshakes under way at once */
+#define WINDOW 128
+
+typedef struct
+{
+	uint64_t connections;
+	uint64_t ssl_bytes;
+	uint64_t heap_bytes;
+	uint64_t pool_bytes;
+} usage_t;
+
+static int nclients = 10000;
+static const char *cert_path, *key_path;
+static bool lean;
+
+static mowgli_eventloop_t *base_eventloop;
+
+static int64_t ssl_bytes;
+
+static char cert_tmp[] = "/tmp/tls-idle-bench-cert.XXXXXX";
+static char key_tmp[] = "/tmp/tls-idle-bench-key.XXXXXX";
+
+/* OpenSSL's allocations, counted; the size goes in front of each block */
+#define HEADER 16
+
+static void *
+count_malloc(size_t size, const char *file, int line)
+{
+	char *p = malloc(size + HEADER);
+
+	if (p == NULL)
+		return NULL;
+
+	*(size_t *) p = size;
+	ssl_bytes += size;
+
+	return p + HEADER;
+}
+
+static void
+count_free(void *ptr, const char *file, int line)
+{
+	char *p = ptr;
+
+	if (p == NULL)
+		return;
+
+	p -= HEADER;
+	ssl_bytes -= *(size_t *) p;
+	free(p);
+}
+
+static void *
+count_realloc(void *ptr, size_t size, const char *file, int line)
+{
+	char *p = ptr;
+
+	if (p == NULL)
+		return count_malloc(size, file, line);
+
+	p -= HEADER;
+	ssl_bytes -= *(size_t *) p;
+
+	if ((p = realloc(p, size + HEADER)) == NULL)
+		return NULL;
+
+	*(size_t *) p = size;
+	ssl_bytes += size;
+
+	return p + HEADER;
+}
+
+static uint64_t
+heap_in_use(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+static void
+get_usage(usage_t *usage, uint64_t connections)
+{
+	mowgli_linebuf_pool_stats_t stats;
+
+	mowgli_linebuf_pool_get_stats(&stats);
+
+	usage->connections = connections;
+	usage->ssl_bytes = ssl_bytes;
+	usage->heap_bytes = heap_in_use();
+	usage->pool_bytes = stats.in_use;
+}
+
+static void
+remove_cert(void)
+{
+	unlink(cert_tmp);
+	unlink(key_tmp);
+}
+
+static bool
+write_pem(char *path, X509 *x509, EVP_PKEY *pkey)
+{
+	int fd = mkstemp(path);
+	FILE *f;
+	bool ok;
+
+	if ((fd == -1) || ((f = fdopen(fd, "w")) == NULL))
+		return false;
+
+	ok = x509 != NULL ? PEM_write_X509(f, x509) : PEM_write_PrivateKey(f, pkey, NULL, NULL, 0, NULL, NULL);
+
+	fclose(f);
+
+	return ok;
+}
+
+/* A throwaway self-signed certificate for when none is given; P-256, so
+ * that getting ten thousand connections up does not take all day.
+ */
+static bool
+make_cert(void)
+{
+	EVP_PKEY_CTX *kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+	EVP_PKEY *pkey = NULL;
+	X509 *x509 = X509_new();
+	X509_NAME *name;
+	bool ok = false;
+
+	if ((kctx == NULL) || (x509 == NULL) || (EVP_PKEY_keygen_init(kctx) <= 0) ||
+	    (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) <= 0) || (EVP_PKEY_keygen(kctx, &pkey) <= 0))
+		goto out;
+
+	ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+	X509_gmtime_adj(X509_get_notBefore(x509), 0);
+	X509_gmtime_adj(X509_get_notAfter(x509), 86400);
+	X509_set_pubkey(x509, pkey);
+
+	name = X509_get_subject_name(x509);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "localhost", -1, -1, 0);
+	X509_set_issuer_name(x509, name);
+
+	if (!X509_sign(x509, pkey, EVP_sha256()))
+		goto out;
+
+	atexit(remove_cert);
+
+	if (!write_pem(cert_tmp, x509, NULL) || !write_pem(key_tmp, NULL, pkey))
+		goto out;
+
+	cert_path = cert_tmp;
+	key_path = key_tmp;
+	ok = true;
+
+out:
+	EVP_PKEY_CTX_free(kctx);
+	EVP_PKEY_free(pkey);
+	X509_free(x509);
+
+	return ok;
+}
+
+/* The server */
+
+static mowgli_vio_t *listener;
+static mowgli_vio_evops_t listener_evops;
+static uint64_t accepted;
+static int ctl_fd;
+
+static void
+server_line(mowgli_linebuf_t *linebuf, char *line, size_t len, void *userdata)
+{
+	mowgli_linebuf_write(linebuf, line, len);
+}
+
+static void
+accept_clients(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	/* kept for the next connection when there is none after all */
+	static mowgli_linebuf_t *linebuf;
+
+	while (true)
+	{
+		if (linebuf == NULL)
+			linebuf = mowgli_linebuf_create(server_line, NULL);
+
+		if ((mowgli_vio_accept(listener, linebuf->vio) != 0) || (mowgli_vio_getfd(linebuf->vio) == -1))
+			return;
+
+		mowgli_linebuf_attach_to_eventloop(linebuf, eventloop);
+		linebuf = NULL;
+		accepted++;
+	}
+}
+
+/* A byte asks for the usage; EOF is time to go */
+static void
+ctl_read(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	usage_t usage;
+	char c;
+
+	if (read(ctl_fd, &c, 1) != 1)
+		_exit(EXIT_SUCCESS);
+
+	get_usage(&usage, accepted);
+
+	if (write(ctl_fd, &usage, sizeof usage) != sizeof usage)
+		_exit(EXIT_FAILURE);
+}
+
+static void
+serve(mowgli_vio_sockaddr_t *addr, int fd)
+{
+	mowgli_vio_ssl_settings_t settings = { .cert_path = cert_path, .privatekey_path = key_path, .lean = lean };
+	mowgli_eventloop_pollable_t *ctl;
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof ss;
+
+	base_eventloop = mowgli_eventloop_create();
+	listener = mowgli_vio_create(NULL);
+	ctl_fd = fd;
+
+	if ((mowgli_vio_openssl_setssl(listener, &settings, NULL) != 0) ||
+	    (mowgli_vio_socket(listener, AF_INET, SOCK_STREAM, 0) != 0) ||
+	    (mowgli_vio_reuseaddr(listener) != 0) ||
+	    (mowgli_vio_bind(listener, mowgli_vio_sockaddr_create(addr, AF_INET, "127.0.0.1", 0)) != 0) ||
+	    (mowgli_vio_listen(listener, SOMAXCONN) != 0))
+	{
+		fprintf(stderr, "TLS listener: %s\n", listener->error.string);
+		_exit(EXIT_FAILURE);
+	}
+
+	getsockname(mowgli_vio_getfd(listener), (struct sockaddr *) &ss, &len);
+	mowgli_vio_sockaddr_from_struct(addr, &ss, len);
+
+	listener_evops.read_cb = accept_clients;
+	mowgli_vio_eventloop_attach(listener, base_eventloop, &listener_evops);
+	mowgli_pollable_setselect(base_eventloop, listener->io.e, MOWGLI_EVENTLOOP_IO_READ, accept_clients);
+
+	ctl = mowgli_pollable_create(base_eventloop, ctl_fd, NULL);
+	mowgli_pollable_setselect(base_eventloop, ctl, MOWGLI_EVENTLOOP_IO_READ, ctl_read);
+
+	/* the address, so the other side knows where to go */
+	if (write(ctl_fd, addr, sizeof *addr) != sizeof *addr)
+		_exit(EXIT_FAILURE);
+
+	mowgli_eventloop_run(base_eventloop);
+	_exit(EXIT_SUCCESS);
+}
+
+/* The clients */
+
+static int clients_up;
+
+static void
+client_line(mowgli_linebuf_t *linebuf, char *line, size_t len, void *userdata)
+{
+	clients_up++;
+}
+
+static mowgli_linebuf_t *
+connect_client(mowgli_vio_sockaddr_t *addr)
+{
+	mowgli_vio_ssl_settings_t settings = { .lean = lean };
+	mowgli_linebuf_t *linebuf = mowgli_linebuf_create(client_line, NULL);
+	mowgli_vio_t *vio = linebuf->vio;
+
+	/* the handshake is done by the first reads and writes */
+	if ((mowgli_vio_openssl_setssl(vio, &settings, NULL) != 0) ||
+	    (mowgli_vio_socket(vio, AF_INET, SOCK_STREAM, 0) != 0))
+	{
+		fprintf(stderr, "TLS client: %s\n", vio->error.string);
+		exit(EXIT_FAILURE);
+	}
+
+	mowgli_linebuf_attach_to_eventloop(linebuf, base_eventloop);
+
+	if (mowgli_vio_connect(vio, addr) != 0)
+	{
+		fprintf(stderr, "TLS connect: %s\n", vio->error.string);
+		exit(EXIT_FAILURE);
+	}
+
+	mowgli_linebuf_writef(linebuf, "hello");
+
+	return linebuf;
+}
+
+static void
+report(const char *side, usage_t *before, usage_t *after)
+{
+	double n = after->connections;
+
+	if (n == 0)
+		return;
+
+	printf("  %-6s %6.0f conns  OpenSSL %7.0f B/conn  heap %7.0f B/conn  linebuf pool %5.0f B/conn\n", side, n,
+	       (after->ssl_bytes - (double) before->ssl_bytes) / n,
+	       (after->heap_bytes - (double) before->heap_bytes) / n,
+	       (after->pool_bytes - (double) before->pool_bytes) / n);
+}
+
+static void
+run(bool lean_mode)
+{
+	mowgli_linebuf_t **clients = mowgli_alloc_array(sizeof *clients, nclients);
+	mowgli_vio_sockaddr_t addr;
+	usage_t client_before, client_after, server_before, server_after;
+	int sv[2], started = 0, i;
+	double start;
+	pid_t pid;
+
+	lean = lean_mode;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	if ((pid = fork()) == -1)
+	{
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pid == 0)
+	{
+		close(sv[0]);
+		serve(&addr, sv[1]);
+	}
+
+	close(sv[1]);
+
+	if ((read(sv[0], &addr, sizeof addr) != sizeof addr) ||
+	    (write(sv[0], "m", 1) != 1) || (read(sv[0], &server_before, sizeof server_before) != sizeof server_before))
+	{
+		fprintf(stderr, "server did not start\n");
+		exit(EXIT_FAILURE);
+	}
+
+	base_eventloop = mowgli_eventloop_create();
+	clients_up = 0;
+	get_usage(&client_before, 0);
+	start = mowgli_eventloop_get_time(base_eventloop);
+
+	while (clients_up < nclients)
+	{
+		while ((started < nclients) && (started - clients_up < WINDOW))
+		{
+			clients[started] = connect_client(&addr);
+			started++;
+		}
+
+		mowgli_eventloop_timeout_once(base_eventloop, 100);
+
+		if (mowgli_eventloop_get_time(base_eventloop) - start > 120)
+		{
+			fprintf(stderr, "only %d of %d connections came up\n", clients_up, nclients);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* anything still in flight, such as TLS 1.3 tickets */
+	for (i = 0; i < 5; i++)
+		mowgli_eventloop_timeout_once(base_eventloop, 20);
+
+	get_usage(&client_after, clients_up);
+
+	if ((write(sv[0], "m", 1) != 1) || (read(sv[0], &server_after, sizeof server_after) != sizeof server_after))
+	{
+		fprintf(stderr, "server went away\n");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("%s:\n", lean_mode ? "lean" : "default");
+	report("client", &client_before, &client_after);
+	report("server", &server_before, &server_after);
+
+	for (i = 0; i < started; i++)
+		mowgli_linebuf_destroy(clients[i]);
+
+	mowgli_free(clients);
+	mowgli_eventloop_destroy(base_eventloop);
+
+	close(sv[0]);
+	waitpid(pid, NULL, 0);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: tls-idle-bench [-n connections] [-c cert -k key]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct rlimit rl;
+	int c;
+
+	/* before OpenSSL allocates anything */
+	CRYPTO_set_mem_functions(count_malloc, count_realloc, count_free);
+
+	while ((c = getopt(argc, argv, "n:c:k:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			nclients = atoi(optarg);
+			break;
+		case 'c':
+			cert_path = optarg;
+			break;
+		case 'k':
+			key_path = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((nclients <= 0) || ((cert_path == NULL) != (key_path == NULL)))
+		usage();
+
+	/* a descriptor each, and a few to spare */
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+	{
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+
+		if (rl.rlim_cur < (rlim_t) nclients + 64)
+		{
+			nclients = rl.rlim_cur - 64;
+			fprintf(stderr, "only %d connections, for want of descriptors\n", nclients);
+		}
+	}
+
+	if ((cert_path == NULL) && !make_cert())
+	{
+		fprintf(stderr, "could not make a certificate\n");
+		return EXIT_FAILURE;
+	}
+
+	if (heap_in_use() == 0)
+		printf("(no heap figures on this system)\n");
+
+	run(false);
+	run(true);
+
+	return EXIT_SUCCESS;
+}
+
+#else
+
+int
+main(int argc, char *argv[])
+{
+	fprintf(stderr, "built without OpenSSL\n");
+	return EXIT_FAILURE;
+}
+
+#endif
@@ -1,11 +1,15 @@
 /* vio-udplistener.c - An example of the VIO API
  * To use: nc -u localhost, and then type stuff and hit enter. :p
+ * With -b, measures datagrams per second over loopback instead: one at a
+ * time, batched with mowgli_vio_recvmmsg()/mowgli_vio_sendmmsg(), and
+ * batched with segmentation offload.
  * This example is public domain.
  */
 
 #include <mowgli.h>
 
 #define BUFSIZE 2048
+#define BATCH 16
 
 #define PROTO AF_INET6
 #define LISTEN "::ffff:127.0.0.1"	/* 6to4 mapping */
@@ -13,34 +17,280 @@
 
 #define ECHOBACK "Echo: "
 
-int
-main(void)
+/* Most the kernel will segment or coalesce in one datagram */
+#define GSO_MAX_BYTES 65000
+#define GSO_MAX_SEGS 64
+
+static void
+echo(void)
 {
 	mowgli_vio_t *vio = mowgli_vio_create(NULL);
 	mowgli_vio_sockaddr_t addr;
+	mowgli_vio_dgram_t in[BATCH], out[BATCH * 2];
+	static char bufs[BATCH][BUFSIZE];
+	int i, n, sent, ret;
 
 	mowgli_vio_sockaddr_create(&addr, PROTO, LISTEN, PORT);
 
 	if (mowgli_vio_socket(vio, PROTO, SOCK_DGRAM, 0))
-		return EXIT_FAILURE;
+		exit(EXIT_FAILURE);
 
 	if (mowgli_vio_bind(vio, &addr))
-		return EXIT_FAILURE;
+		exit(EXIT_FAILURE);
 
 	while (true)
 	{
-		char buf[BUFSIZE] = "";
-		mowgli_vio_sockdata_t sockinfo;
+		for (i = 0; i < BATCH; i++)
+		{
+			in[i].buf = bufs[i];
+			in[i].size = sizeof(bufs[i]) - 1;
+		}
+
+		if ((n = mowgli_vio_recvmmsg(vio, in, BATCH)) <= 0)
+			continue;
 
-		mowgli_vio_recvfrom(vio, buf, sizeof(buf), &addr);
+		for (i = 0; i < n; i++)
+		{
+			mowgli_vio_sockdata_t sockinfo;
 
-		mowgli_vio_sockaddr_info(&addr, &sockinfo);
+			bufs[i][in[i].len] = '\0';
 
-		printf("Recieved bytes from addr [%s]:%hu: %s", sockinfo.host, sockinfo.port, buf);
+			mowgli_vio_sockaddr_info(&in[i].addr, &sockinfo);
 
-		mowgli_vio_sendto(vio, ECHOBACK, sizeof(ECHOBACK), &addr);
-		mowgli_vio_sendto(vio, buf, strlen(buf), &addr);
+			printf("Recieved bytes from addr [%s]:%hu: %s", sockinfo.host, sockinfo.port, bufs[i]);
+
+			out[i * 2] = (mowgli_vio_dgram_t) { .buf = ECHOBACK, .len = sizeof(ECHOBACK) - 1, .addr = in[i].addr };
+			out[i * 2 + 1] = (mowgli_vio_dgram_t) { .buf = bufs[i], .len = in[i].len, .addr = in[i].addr };
+		}
+
+		for (sent = 0; sent < n * 2; sent += ret)
+			if ((ret = mowgli_vio_sendmmsg(vio, out + sent, n * 2 - sent)) <= 0)
+				break;
 	}
+}
+
+/* The benchmark */
+
+enum
+{
+	MODE_SINGLE,
+	MODE_BATCH,
+	MODE_GSO,
+};
+
+static const char *const mode_names[] = { "single", "batch", "gso" };
+
+static size_t size = 512;
+static int batch = 64;
+static double duration = 2;
+
+static mowgli_vio_t *tx, *rx;
+static mowgli_vio_sockaddr_t rx_addr;
+static char *payload;
+static mowgli_vio_dgram_t *rx_dgrams;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double
+cpu(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void
+open_sockets(void)
+{
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof ss;
+	struct timeval tv = { 1, 0 };
+	mowgli_vio_sockaddr_t addr;
+
+	tx = mowgli_vio_create(NULL);
+	rx = mowgli_vio_create(NULL);
+
+	mowgli_vio_sockaddr_create(&addr, AF_INET, "127.0.0.1", 0);
+
+	if (mowgli_vio_socket(tx, AF_INET, SOCK_DGRAM, 0) || mowgli_vio_socket(rx, AF_INET, SOCK_DGRAM, 0) ||
+	    mowgli_vio_bind(rx, &addr))
+		exit(EXIT_FAILURE);
+
+	getsockname(mowgli_vio_getfd(rx), (struct sockaddr *) &ss, &len);
+	mowgli_vio_sockaddr_from_struct(&rx_addr, &ss, len);
+
+	/* so a lost datagram does not hang a round */
+	setsockopt(mowgli_vio_getfd(rx), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+}
+
+/* Send n datagrams' worth, then read until they are all back */
+static int
+round_trip(int mode, int n, unsigned long *lost)
+{
+	mowgli_vio_dgram_t dgrams[GSO_MAX_SEGS];
+	int i, ret, sent, got = 0;
+
+	switch (mode)
+	{
+	case MODE_SINGLE:
+		for (i = 0; i < n; i++)
+			mowgli_vio_sendto(tx, payload, size, &rx_addr);
+
+		while (got < n)
+		{
+			rx_dgrams[0].addr.addrlen = sizeof(rx_dgrams[0].addr.addr);
+
+			if (mowgli_vio_recvfrom(rx, rx_dgrams[0].buf, rx_dgrams[0].size, &rx_dgrams[0].addr) <= 0)
+				break;
+
+			got++;
+		}
+
+		break;
+
+	case MODE_BATCH:
+	case MODE_GSO:
+		if (mode == MODE_GSO)
+		{
+			dgrams[0] = (mowgli_vio_dgram_t) { .buf = payload, .len = size * n, .addr = rx_addr, .segsize = size };
+			sent = mowgli_vio_sendmmsg(tx, dgrams, 1);
+		}
+		else
+		{
+			for (i = 0; i < n; i++)
+				dgrams[i] = (mowgli_vio_dgram_t) { .buf = payload + i * size, .len = size, .addr = rx_addr };
+
+			for (sent = 0; sent < n; sent += ret)
+				if ((ret = mowgli_vio_sendmmsg(tx, dgrams + sent, n - sent)) <= 0)
+					break;
+		}
+
+		while (got < n)
+		{
+			if ((ret = mowgli_vio_recvmmsg(rx, rx_dgrams, n - got)) <= 0)
+				break;
+
+			for (i = 0; i < ret; i++)
+				got += (rx_dgrams[i].segsize > 0) ? (rx_dgrams[i].len + rx_dgrams[i].segsize - 1) / rx_dgrams[i].segsize : 1;
+		}
+
+		break;
+	}
+
+	*lost += n - got;
+
+	return got;
+}
+
+static void
+bench(int mode)
+{
+	unsigned long packets = 0, rounds = 0, lost = 0;
+	double start, end, cpu_start;
+	int n = batch;
+
+	if (mode == MODE_GSO)
+		n = MIN(MIN(batch, GSO_MAX_SEGS), (int) (GSO_MAX_BYTES / size));
+
+	mowgli_vio_udp_gro(rx, mode == MODE_GSO);
+
+	start = now();
+	end = start + duration;
+	cpu_start = cpu();
+
+	do
+	{
+		packets += round_trip(mode, n, &lost);
+		rounds++;
+	} while ((rounds % 16 != 0) || (now() < end));
+
+	end = now() - start;
+	cpu_start = cpu() - cpu_start;
+
+	printf("%-7s %3d a round  %10.0f packets/s  %6.2f us CPU/packet  %lu lost\n", mode_names[mode], n,
+	       packets / end, packets ? cpu_start * 1e6 / packets : 0.0, lost);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: vio-udplistener [-b [-s bytes] [-n batch] [-d seconds]]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	bool benchmark = false;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "bs:n:d:")) != -1)
+	{
+		switch (c)
+		{
+		case 'b':
+			benchmark = true;
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			batch = atoi(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (!benchmark)
+	{
+		echo();
+		return EXIT_SUCCESS;	/* Not reached */
+	}
+
+	if ((size == 0) || (size > GSO_MAX_BYTES) || (batch <= 0) || (batch > GSO_MAX_SEGS))
+		usage();
+
+	open_sockets();
+
+	payload = mowgli_alloc(size * batch);
+	memset(payload, 'x', size * batch);
+
+	/* big enough for whatever receive offload joins up */
+	rx_dgrams = mowgli_alloc(batch * sizeof *rx_dgrams);
+
+	for (i = 0; i < batch; i++)
+	{
+		rx_dgrams[i].size = 65536;
+		rx_dgrams[i].buf = mowgli_alloc(rx_dgrams[i].size);
+	}
+
+	printf("%zu byte datagrams over loopback\n", size);
+
+	bench(MODE_SINGLE);
+	bench(MODE_BATCH);
+	bench(MODE_GSO);
+
+	for (i = 0; i < batch; i++)
+		mowgli_free(rx_dgrams[i].buf);
+
+	mowgli_free(rx_dgrams);
+	mowgli_free(payload);
+	mowgli_vio_destroy(tx);
+	mowgli_vio_destroy(rx);
 
-	return EXIT_SUCCESS;	/* Not reached */
+	return EXIT_SUCCESS;
 }
@@ -0,0 +1,120 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * workqueue.c: Testing of worker thread pools
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+#define JOBS 200
+
+typedef struct
+{
+	int n;
+	int result;
+} job_t;
+
+static mowgli_eventloop_t *eventloop;
+static int finished = 0;
+
+/* pretend to be a blocking disk read or crypt() call */
+static void
+work(void *arg)
+{
+	job_t *job = arg;
+	struct addrinfo *res = NULL;
+
+	if (job->n % 50 == 0)
+	{
+		job->result = getaddrinfo("localhost", NULL, NULL, &res);
+
+		if (res != NULL)
+			freeaddrinfo(res);
+
+		return;
+	}
+
+	usleep(10000);
+	job->result = job->n * 2;
+}
+
+static void
+print_stats(void *arg)
+{
+	mowgli_workqueue_stats_t stats;
+
+	mowgli_workqueue_get_stats(arg, &stats);
+
+	printf("queued %zu (peak %zu), running %zu, threads %u (%u idle), submitted %lu, completed %lu, cancelled %lu\n",
+	       stats.queued, stats.queued_peak, stats.running, stats.threads, stats.idle_threads,
+	       stats.submitted, stats.completed, stats.cancelled);
+}
+
+static void
+done(mowgli_workqueue_t *wq, void *arg, bool cancelled)
+{
+	mowgli_free(arg);
+
+	if (++finished == JOBS)
+	{
+		print_stats(wq);
+		mowgli_eventloop_break(eventloop);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	mowgli_workqueue_t *wq;
+	mowgli_workqueue_job_t *handles[JOBS];
+	int i, cancelled = 0;
+
+	eventloop = mowgli_eventloop_create();
+	wq = mowgli_workqueue_create(eventloop, 2, 8);
+	mowgli_workqueue_set_idle_timeout(wq, 200);
+
+	for (i = 0; i < JOBS; i++)
+	{
+		job_t *job = mowgli_alloc(sizeof *job);
+
+		job->n = i;
+		handles[i] = mowgli_workqueue_submit(wq, work, done, job);
+	}
+
+	/* the tail of the queue hasn't started yet */
+	for (i = JOBS - 1; i >= JOBS - 20; i -= 2)
+		if (mowgli_workqueue_cancel(wq, handles[i]))
+			cancelled++;
+
+	printf("cancelled %d jobs\n", cancelled);
+
+	mowgli_timer_add(eventloop, "print_stats", print_stats, wq, 1);
+	mowgli_eventloop_run(eventloop);
+
+	/* let the extra threads time out */
+	usleep(500000);
+	mowgli_eventloop_run_once(eventloop);
+	print_stats(wq);
+
+	mowgli_workqueue_destroy(wq);
+	mowgli_eventloop_destroy(eventloop);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * writef-bench.c: Formatted line throughput of mowgli_linebuf_writef().
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mowgli.h>
+
+/* Queues batches of IRC-style formatted lines on a linebuf over a
+ * socketpair and lets the eventloop send them, once through the old
+ * writef (vsnprintf into a maxbuflen stack buffer, then
+ * mowgli_linebuf_write()) and once through the current one, which formats
+ * in place.  Queueing is timed on its own as well as with the sending.
+ * Both streams are hashed on the way out to check they match.
+ */
+
+static mowgli_eventloop_t *base_eventloop;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* mowgli_linebuf_writef() as it used to be */
+static void
+old_writef(mowgli_linebuf_t *linebuf, const char *format, ...)
+{
+	char buf[linebuf->writebuf.maxbuflen];
+	size_t len;
+	va_list va;
+
+	va_start(va, format);
+	len = vsnprintf(buf, linebuf->writebuf.maxbuflen - 1, format, va);
+	va_end(va);
+
+	mowgli_linebuf_write(linebuf, buf, len);
+}
+
+static uint32_t
+hash(uint32_t h, const char *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (unsigned char) data[i]) * 16777619U;
+
+	return h;
+}
+
+static void
+run(bool old, unsigned long count, unsigned long batch, uint32_t *digest)
+{
+	static char buf[65536];
+	mowgli_linebuf_t *linebuf;
+	unsigned long sent = 0, i;
+	uint64_t bytes = 0, received = 0;
+	uint32_t h = 2166136261U;
+	double start, secs, t, formatting = 0;
+	ssize_t ret;
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+	{
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	fcntl(sv[1], F_SETFL, O_NONBLOCK);
+
+	linebuf = mowgli_linebuf_create(NULL, NULL);
+	linebuf->vio->io.fd = sv[0];
+	mowgli_linebuf_attach_to_eventloop(linebuf, base_eventloop);
+
+	start = now();
+
+	while (sent < count)
+	{
+		t = now();
+
+		for (i = 0; i < batch && sent < count; i++, sent++)
+		{
+			if (old)
+				old_writef(linebuf, ":%s!%s@%s PRIVMSG %s :message number %lu of %lu",
+					   "nick", "user", "host.example.org", "#channel", sent, count);
+			else
+				mowgli_linebuf_writef(linebuf, ":%s!%s@%s PRIVMSG %s :message number %lu of %lu",
+						      "nick", "user", "host.example.org", "#channel", sent, count);
+		}
+
+		formatting += now() - t;
+		bytes = received + linebuf->writebuf.buflen;
+
+		while (received < bytes)
+		{
+			mowgli_eventloop_timeout_once(base_eventloop, 10);
+
+			while ((ret = read(sv[1], buf, sizeof buf)) > 0)
+			{
+				h = hash(h, buf, ret);
+				received += ret;
+			}
+		}
+	}
+
+	secs = now() - start;
+
+	printf("%-4s %6.2f Mlines/s queued, %6.2f Mlines/s sent (%6.1f MiB/s)  copied %6.1f MiB  stack buffer %zu bytes\n",
+	       old ? "old" : "new", count / formatting / 1e6, count / secs / 1e6, received / secs / 1048576.0,
+	       linebuf->write_copied / 1048576.0, old ? linebuf->writebuf.maxbuflen : (size_t) 0);
+
+	*digest = h;
+
+	mowgli_linebuf_destroy(linebuf);
+	close(sv[1]);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: writef-bench [-n lines] [-b batch]\n");
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned long count = 2000000, batch = 500;
+	uint32_t h_old, h_new;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:b:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			batch = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if ((count == 0) || (batch == 0))
+		usage();
+
+	base_eventloop = mowgli_eventloop_create();
+
+	run(true, count, batch, &h_old);
+	run(false, count, batch, &h_new);
+
+	mowgli_eventloop_destroy(base_eventloop);
+
+	if (h_old != h_new)
+	{
+		fprintf(stderr, "output differs!\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
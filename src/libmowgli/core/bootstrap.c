@@ -48,6 +48,7 @@ MOWGLI_BOOTSTRAP_FUNC(mowgli_bootstrap_real)
 	mowgli_cacheline_bootstrap();
 	mowgli_interface_bootstrap();
 	mowgli_index_bootstrap();
+	mowgli_linebuf_pool_bootstrap();
 
 #ifdef _WIN32
 	mowgli_winsock_bootstrap();
@@ -32,6 +32,7 @@ extern void mowgli_cacheline_bootstrap(void);
 extern void mowgli_global_storage_bootstrap(void);
 extern void mowgli_hook_bootstrap(void);
 extern void mowgli_interface_bootstrap(void);
+extern void mowgli_linebuf_pool_bootstrap(void);
 extern void mowgli_log_bootstrap(void);
 extern void mowgli_memslice_bootstrap(void);
 extern void mowgli_node_bootstrap(void);
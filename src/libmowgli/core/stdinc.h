@@ -53,6 +53,7 @@
 #  include <sys/resource.h>
 #  include <sys/socket.h>
 #  include <sys/time.h>
+#  include <sys/uio.h>
 #  include <sys/wait.h>
 #  include <unistd.h>
 #else
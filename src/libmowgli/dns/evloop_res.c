@@ -33,6 +33,7 @@
 #include "mowgli.h"
 
 #define MOWGLI_DNS_MAXPACKET 1024	/* rfc sez 512 but we expand names so ... */
+#define MOWGLI_DNS_READ_BATCH 16	/* replies read per recvmmsg() */
 #define MOWGLI_DNS_RES_MAXALIASES 35	/* maximum aliases allowed */
 #define MOWGLI_DNS_RES_MAXADDRS 35	/* maximum addresses allowed */
 #define MOWGLI_DNS_AR_TTL 600	/* TTL in seconds for dns cache entries */
@@ -938,37 +939,19 @@ proc_answer(mowgli_dns_reslist_t *request, mowgli_dns_resheader_t *header, char
 }
 
 /*
- * res_read_single_reply - read a dns reply from the nameserver and process it.
- * Return value: 1 if a packet was read, 0 otherwise
+ * res_process_reply - process a dns reply read from the nameserver.
  */
-static int
-res_read_single_reply(mowgli_dns_t *dns)
+static void
+res_process_reply(mowgli_dns_t *dns, char *buf, int rc, mowgli_vio_sockaddr_t *lsin)
 {
-	char buf[sizeof(mowgli_dns_resheader_t) + MOWGLI_DNS_MAXPACKET]
-
-	/* Sparc and alpha need 16bit-alignment for accessing header->id (which is uint16_t).
-	   Because of the header = (mowgli_dns_resheader_t*) buf; later on, this is neeeded. --FaUl */
-#if defined(__sparc__) || defined(__alpha__)
-	__attribute__((aligned(16)))
-#endif
-	;
 	mowgli_dns_resheader_t *header;
 	mowgli_dns_reslist_t *request = NULL;
 	mowgli_dns_reply_t *reply = NULL;
-	int rc;
 	int answer_count;
-	mowgli_vio_sockaddr_t lsin = { .addrlen = sizeof(lsin.addr) };
-	mowgli_dns_evloop_t *state = dns->dns_state;
-
-	rc = mowgli_vio_recvfrom(state->vio, buf, sizeof(buf), &lsin);
-
-	/* No packet */
-	if ((rc == 0) || (rc == -1))
-		return 0;
 
 	/* Too small */
 	if (rc <= (int) (sizeof(mowgli_dns_resheader_t)))
-		return 1;
+		return;
 
 	/*
 	 * convert DNS reply reader from Network byte order to CPU byte order.
@@ -982,14 +965,14 @@ res_read_single_reply(mowgli_dns_t *dns)
 	/* response for an id which we have already received an answer for
 	 * just ignore this response. */
 	if ((request = find_id(dns, header->id)) == 0)
-		return 1;
+		return;
 
 	/* check against possibly fake replies */
-	if (!res_ourserver(dns, &lsin.addr))
-		return 1;
+	if (!res_ourserver(dns, &lsin->addr))
+		return;
 
 	if (!check_question(request, header, buf, buf + rc))
-		return 1;
+		return;
 
 	if ((header->rcode != MOWGLI_DNS_NO_ERRORS) || (header->ancount == 0))
 	{
@@ -1008,7 +991,7 @@ res_read_single_reply(mowgli_dns_t *dns)
 			rem_request(dns, request);
 		}
 
-		return 1;
+		return;
 	}
 
 	/* If this fails there was an error decoding the received packet,
@@ -1027,7 +1010,7 @@ res_read_single_reply(mowgli_dns_t *dns)
 				 */
 				(*request->query->callback)(reply, MOWGLI_DNS_RES_INVALID, request->query->ptr);
 				rem_request(dns, request);
-				return 1;
+				return;
 			}
 
 			/* Lookup the 'authoritative' name that we were given for the
@@ -1054,8 +1037,6 @@ res_read_single_reply(mowgli_dns_t *dns)
 		(*request->query->callback)(NULL, MOWGLI_DNS_RES_INVALID, request->query->ptr);
 		rem_request(dns, request);
 	}
-
-	return 1;
 }
 
 static mowgli_dns_reply_t *
@@ -1076,9 +1057,26 @@ static void
 res_readreply(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
 {
 	mowgli_dns_t *dns = userdata;
+	mowgli_dns_evloop_t *state = dns->dns_state;
+
+	/* The header is accessed in place, so keep the buffers aligned for it */
+	union
+	{
+		char buf[sizeof(mowgli_dns_resheader_t) + MOWGLI_DNS_MAXPACKET];
+		mowgli_dns_resheader_t header;
+	} packets[MOWGLI_DNS_READ_BATCH];
+	mowgli_vio_dgram_t dgrams[MOWGLI_DNS_READ_BATCH];
+	int i, n;
+
+	for (i = 0; i < MOWGLI_DNS_READ_BATCH; i++)
+	{
+		dgrams[i].buf = packets[i].buf;
+		dgrams[i].size = sizeof(packets[i].buf);
+	}
 
-	while (res_read_single_reply(dns))
-	{ }
+	while ((n = mowgli_vio_recvmmsg(state->vio, dgrams, MOWGLI_DNS_READ_BATCH)) > 0)
+		for (i = 0; i < n; i++)
+			res_process_reply(dns, dgrams[i].buf, dgrams[i].len, &dgrams[i].addr);
 }
 
 /* DNS ops for this resolver */
@@ -23,39 +23,66 @@
 
 static mowgli_heap_t *eventloop_heap = NULL;
 
+/* the poller backends compiled in, best first */
+static const struct
+{
+	const char *name;
+	mowgli_eventloop_ops_t *ops;
+} mowgli_eventloop_backends[] = {
+#ifdef HAVE_PORT_CREATE
+	{ "ports", &_mowgli_ports_pollops },
+#endif
+#ifdef HAVE_DISPATCH_BLOCK
+	{ "qnx", &_mowgli_qnx_pollops },
+#endif
+#ifdef HAVE_KQUEUE
+	{ "kqueue", &_mowgli_kqueue_pollops },
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+	{ "epoll", &_mowgli_epoll_pollops },
+#endif
+#ifdef HAVE_POLL_H
+	{ "poll", &_mowgli_poll_pollops },
+#endif
+#ifdef HAVE_SELECT
+	{ "select", &_mowgli_select_pollops },
+#endif
+	{ "null", &_mowgli_null_pollops },
+};
+
+#define MOWGLI_EVENTLOOP_NBACKENDS (sizeof mowgli_eventloop_backends / sizeof mowgli_eventloop_backends[0])
+
 mowgli_eventloop_t *
 mowgli_eventloop_create(void)
+{
+	return mowgli_eventloop_create_backend(NULL);
+}
+
+/* create an eventloop using the named poller backend, or the best available
+ * one if backend is NULL.  returns NULL if the backend isn't compiled in.
+ */
+mowgli_eventloop_t *
+mowgli_eventloop_create_backend(const char *backend)
 {
 	mowgli_eventloop_t *eventloop;
+	size_t i = 0;
+
+	if (backend != NULL)
+	{
+		for (i = 0; i < MOWGLI_EVENTLOOP_NBACKENDS; i++)
+			if (!strcmp(mowgli_eventloop_backends[i].name, backend))
+				break;
+
+		if (i == MOWGLI_EVENTLOOP_NBACKENDS)
+			return NULL;
+	}
 
 	if (eventloop_heap == NULL)
 		eventloop_heap = mowgli_heap_create(sizeof(mowgli_eventloop_t), 16, BH_NOW);
 
 	eventloop = mowgli_heap_alloc(eventloop_heap);
 
-	eventloop->eventloop_ops = &_mowgli_null_pollops;
-
-#ifdef HAVE_SELECT
-	eventloop->eventloop_ops = &_mowgli_select_pollops;
-#endif
-#ifdef HAVE_POLL_H
-	eventloop->eventloop_ops = &_mowgli_poll_pollops;
-#endif
-#ifdef HAVE_SYS_EPOLL_H
-	eventloop->eventloop_ops = &_mowgli_epoll_pollops;
-#endif
-#ifdef HAVE_KQUEUE
-	eventloop->eventloop_ops = &_mowgli_kqueue_pollops;
-#endif
-#ifdef HAVE_DISPATCH_BLOCK
-	eventloop->eventloop_ops = &_mowgli_qnx_pollops;
-#endif
-#ifdef HAVE_PORT_CREATE
-	eventloop->eventloop_ops = &_mowgli_ports_pollops;
-#endif
-#if 0
-	eventloop->eventloop_ops = &_mowgli_winsock_pollops;
-#endif
+	eventloop->eventloop_ops = mowgli_eventloop_backends[i].ops;
 
 	if (mowgli_mutex_init(&eventloop->mutex) != 0)
 	{
@@ -72,6 +99,30 @@ mowgli_eventloop_create(void)
 	return eventloop;
 }
 
+/* name of the nth compiled-in backend, or NULL past the end */
+const char *
+mowgli_eventloop_backend_nth(size_t n)
+{
+	if (n >= MOWGLI_EVENTLOOP_NBACKENDS)
+		return NULL;
+
+	return mowgli_eventloop_backends[n].name;
+}
+
+const char *
+mowgli_eventloop_get_backend(mowgli_eventloop_t *eventloop)
+{
+	size_t i;
+
+	return_val_if_fail(eventloop != NULL, NULL);
+
+	for (i = 0; i < MOWGLI_EVENTLOOP_NBACKENDS; i++)
+		if (mowgli_eventloop_backends[i].ops == eventloop->eventloop_ops)
+			return mowgli_eventloop_backends[i].name;
+
+	return NULL;
+}
+
 void
 mowgli_eventloop_destroy(mowgli_eventloop_t *eventloop)
 {
@@ -185,3 +236,26 @@ mowgli_eventloop_set_data(mowgli_eventloop_t *eventloop, void *data)
 
 	eventloop->data = data;
 }
+
+/* Trade CPU for wakeup latency: after an iteration which dispatched events,
+ * spin on non-blocking polls for up to max_usec before going to sleep.  The
+ * spin window widens while spinning finds work and backs off when it does
+ * not, so an idle loop quickly returns to plain blocking.  0 disables it.
+ */
+void
+mowgli_eventloop_set_busypoll(mowgli_eventloop_t *eventloop, unsigned int max_usec)
+{
+	return_if_fail(eventloop != NULL);
+
+#ifdef _SC_NPROCESSORS_ONLN
+	/* on a uniprocessor, spinning only steals time from whoever would wake us */
+	if ((max_usec > 0) && (sysconf(_SC_NPROCESSORS_ONLN) == 1))
+	{
+		mowgli_log("eventloop %p: ignoring busy-polling request on a uniprocessor system", (void *) eventloop);
+		max_usec = 0;
+	}
+#endif
+
+	eventloop->busypoll_max = max_usec;
+	eventloop->busypoll_window = 0;
+}
@@ -158,6 +158,11 @@ struct _mowgli_eventloop
 
 	mowgli_list_t destroyed_pollable_list;
 	bool processing_events;
+
+	/* adaptive busy-polling, see mowgli_eventloop_set_busypoll() */
+	unsigned int busypoll_max;
+	unsigned int busypoll_window;
+	unsigned long dispatched;
 };
 
 typedef void mowgli_event_dispatch_func_t (void *userdata);
@@ -311,6 +316,9 @@ mowgli_eventloop_ignore_errno(int error)
 
 typedef void mowgli_eventloop_helper_start_fn_t (mowgli_eventloop_helper_proc_t * helper, void *userdata);
 
+typedef struct _mowgli_shmring mowgli_shmring_t;
+typedef void mowgli_shmring_cb_t (mowgli_eventloop_t * eventloop, mowgli_shmring_t * ring, void *userdata);
+
 struct _mowgli_helper
 {
 	mowgli_eventloop_io_obj_t type;
@@ -324,10 +332,17 @@ struct _mowgli_helper
 	mowgli_eventloop_io_cb_t *read_function;
 
 	void *userdata;
+
+	/* shared memory rings, see mowgli_helper_create_shm().  from either side
+	 * out_ring is written to and in_ring is read from.
+	 */
+	mowgli_shmring_t *out_ring;
+	mowgli_shmring_t *in_ring;
 };
 
 /* helper.c */
 extern mowgli_eventloop_helper_proc_t *mowgli_helper_create(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_start_fn_t *start_fn, const char *helpername, void *userdata);
+extern mowgli_eventloop_helper_proc_t *mowgli_helper_create_shm(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_start_fn_t *start_fn, const char *helpername, void *userdata, size_t ringsize);
 
 /* creation of helpers inside other executable images */
 extern mowgli_eventloop_helper_proc_t *mowgli_helper_spawn(mowgli_eventloop_t *eventloop, const char *path, char *const argv[]);
@@ -337,6 +352,39 @@ extern mowgli_eventloop_helper_proc_t *mowgli_helper_setup(mowgli_eventloop_t *e
 extern void mowgli_helper_set_read_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_proc_t *helper, mowgli_eventloop_io_cb_t *read_fn);
 extern void mowgli_helper_destroy(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_proc_t *helper);
 
+/* shmring.c */
+extern mowgli_shmring_t *mowgli_shmring_create(size_t size);
+extern void mowgli_shmring_destroy(mowgli_shmring_t *ring);
+extern size_t mowgli_shmring_get_fds(mowgli_shmring_t *ring, int *fds, size_t max);
+extern size_t mowgli_shmring_readable(mowgli_shmring_t *ring);
+extern size_t mowgli_shmring_writable(mowgli_shmring_t *ring);
+extern void *mowgli_shmring_reserve(mowgli_shmring_t *ring, size_t *len);
+extern void mowgli_shmring_commit(mowgli_shmring_t *ring, size_t len);
+extern const void *mowgli_shmring_peek(mowgli_shmring_t *ring, size_t *len);
+extern void mowgli_shmring_consume(mowgli_shmring_t *ring, size_t len);
+extern size_t mowgli_shmring_write(mowgli_shmring_t *ring, const void *data, size_t len);
+extern size_t mowgli_shmring_read(mowgli_shmring_t *ring, void *buf, size_t len);
+extern bool mowgli_shmring_wait(mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir, int timeout);
+extern void mowgli_shmring_setselect(mowgli_eventloop_t *eventloop, mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir, mowgli_shmring_cb_t *function, void *userdata);
+
+/* helper_pool.c: a fixed set of pre-forked helpers fed with request frames.
+ * the pool must not be destroyed from inside a done callback.
+ */
+typedef struct _mowgli_helper_pool mowgli_helper_pool_t;
+
+typedef void mowgli_helper_pool_work_fn_t (mowgli_eventloop_helper_proc_t * helper, const void *data, size_t len, void *userdata);
+typedef void mowgli_helper_pool_done_fn_t (mowgli_helper_pool_t * pool, const void *data, size_t len, void *userdata);
+
+extern mowgli_helper_pool_t *mowgli_helper_pool_create(mowgli_eventloop_t *eventloop, const char *helpername, unsigned int helpers, mowgli_helper_pool_work_fn_t *work_fn, void *userdata);
+extern void mowgli_helper_pool_set_limits(mowgli_helper_pool_t *pool, unsigned int max_inflight, unsigned int max_queued);
+extern bool mowgli_helper_pool_submit(mowgli_helper_pool_t *pool, const void *data, size_t len, mowgli_helper_pool_done_fn_t *done_fn, void *userdata);
+extern size_t mowgli_helper_pool_pending(mowgli_helper_pool_t *pool);
+extern void mowgli_helper_pool_destroy(mowgli_helper_pool_t *pool);
+
+/* called from a work function, inside the helper, to answer the current
+ * request with up to 16 MiB */
+extern void mowgli_helper_pool_reply(mowgli_eventloop_helper_proc_t *helper, const void *data, size_t len);
+
 /* null_pollops.c */
 extern void mowgli_simple_eventloop_run_once(mowgli_eventloop_t *eventloop);
 extern void mowgli_simple_eventloop_timeout_once(mowgli_eventloop_t *eventloop, int timeout);
@@ -344,6 +392,9 @@ extern void mowgli_simple_eventloop_error_handler(mowgli_eventloop_t *eventloop,
 
 /* eventloop.c */
 extern mowgli_eventloop_t *mowgli_eventloop_create(void);
+extern mowgli_eventloop_t *mowgli_eventloop_create_backend(const char *backend);
+extern const char *mowgli_eventloop_backend_nth(size_t n);
+extern const char *mowgli_eventloop_get_backend(mowgli_eventloop_t *eventloop);
 extern void mowgli_eventloop_destroy(mowgli_eventloop_t *eventloop);
 extern void mowgli_eventloop_run(mowgli_eventloop_t *eventloop);
 extern void mowgli_eventloop_run_once(mowgli_eventloop_t *eventloop);
@@ -352,6 +403,7 @@ extern void mowgli_eventloop_break(mowgli_eventloop_t *eventloop);
 extern void mowgli_eventloop_timers_only(mowgli_eventloop_t *eventloop);
 extern void mowgli_eventloop_set_data(mowgli_eventloop_t *eventloop, void *data);
 extern void *mowgli_eventloop_get_data(mowgli_eventloop_t *eventloop);
+extern void mowgli_eventloop_set_busypoll(mowgli_eventloop_t *eventloop, unsigned int max_usec);
 
 /* timer.c */
 extern mowgli_eventloop_timer_t *mowgli_timer_add(mowgli_eventloop_t *eventloop, const char *name, mowgli_event_dispatch_func_t *func, void *arg, time_t when);
@@ -368,6 +420,7 @@ extern void mowgli_pollable_destroy(mowgli_eventloop_t *eventloop, mowgli_eventl
 extern void mowgli_pollable_setselect(mowgli_eventloop_t *eventloop, mowgli_eventloop_pollable_t *pollable, mowgli_eventloop_io_dir_t dir, mowgli_eventloop_io_cb_t *event_function);
 extern void mowgli_pollable_set_nonblocking(mowgli_eventloop_pollable_t *pollable, bool nonblocking);
 extern void mowgli_pollable_set_cloexec(mowgli_eventloop_pollable_t *pollable, bool cloexec);
+extern bool mowgli_pollable_set_busypoll(mowgli_eventloop_pollable_t *pollable, unsigned int usec);
 extern void mowgli_pollable_trigger(mowgli_eventloop_t *eventloop, mowgli_eventloop_pollable_t *pollable, mowgli_eventloop_io_dir_t dir);
 
 #endif /* MOWGLI_SRC_LIBMOWGLI_EVENTLOOP_EVENTLOOP_H_INCLUDE_GUARD */
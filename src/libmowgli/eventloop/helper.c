@@ -20,19 +20,102 @@
 
 #include "mowgli.h"
 
+#if defined(__linux__)
+# include <sys/syscall.h>
+#endif
+
+#ifndef _WIN32
+# include <poll.h>
+#endif
+
 typedef struct
 {
 	mowgli_eventloop_helper_start_fn_t *start_fn;
 	void *userdata;
 	mowgli_descriptor_t fd;
+
+	/* rings as seen from the parent */
+	mowgli_shmring_t *out_ring;
+	mowgli_shmring_t *in_ring;
 } mowgli_helper_create_req_t;
 
+#ifndef _WIN32
+
+#define MOWGLI_HELPER_MAX_KEEP_FDS 11
+
+static int
+mowgli_helper_fd_cmp(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+/* close every descriptor except the ones in keep.  close_range(2) does this
+ * in a few syscalls; otherwise fall back to closing the first 1024 one at a
+ * time.
+ */
+static void
+mowgli_helper_close_fds(int *keep, size_t nkeep)
+{
+	int i;
+	size_t k;
+
+	qsort(keep, nkeep, sizeof *keep, mowgli_helper_fd_cmp);
+
+# ifdef SYS_close_range
+
+	{
+		unsigned int first = 0;
+
+		for (k = 0; k < nkeep; k++)
+		{
+			if (((unsigned int) keep[k] > first) && (syscall(SYS_close_range, first, (unsigned int) keep[k] - 1, 0U) != 0))
+				goto slow;
+
+			first = keep[k] + 1;
+		}
+
+		if (syscall(SYS_close_range, first, ~0U, 0U) == 0)
+			return;
+	}
+
+slow:
+
+# endif
+
+	for (i = 0, k = 0; i < 1024; i++)
+	{
+		if ((k < nkeep) && (keep[k] == i))
+		{
+			k++;
+			continue;
+		}
+
+		close(i);
+	}
+}
+
+static bool
+mowgli_helper_fd_kept(int fd, const int *keep, size_t nkeep)
+{
+	size_t k;
+
+	for (k = 0; k < nkeep; k++)
+		if (keep[k] == fd)
+			return true;
+
+	return false;
+}
+
+#endif
+
 static void
 mowgli_helper_trampoline(mowgli_helper_create_req_t *req)
 {
 	mowgli_eventloop_helper_proc_t *helper;
 
 #ifndef _WIN32
+	int keep[MOWGLI_HELPER_MAX_KEEP_FDS];
+	size_t nkeep = 0;
 	int i, x;
 #endif
 
@@ -45,9 +128,15 @@ mowgli_helper_trampoline(mowgli_helper_create_req_t *req)
 
 #ifndef _WIN32
 
-	for (i = 0; i < 1024; i++)
-		if (i != req->fd)
-			close(i);
+	keep[nkeep++] = req->fd;
+
+	if (req->out_ring != NULL)
+		nkeep += mowgli_shmring_get_fds(req->out_ring, keep + nkeep, MOWGLI_HELPER_MAX_KEEP_FDS - nkeep);
+
+	if (req->in_ring != NULL)
+		nkeep += mowgli_shmring_get_fds(req->in_ring, keep + nkeep, MOWGLI_HELPER_MAX_KEEP_FDS - nkeep);
+
+	mowgli_helper_close_fds(keep, nkeep);
 
 	x = open("/dev/null", O_RDWR);
 
@@ -59,7 +148,7 @@ mowgli_helper_trampoline(mowgli_helper_create_req_t *req)
 
 	for (i = 0; i < 2; i++)
 	{
-		if (x == i || req->fd == i)
+		if (x == i || mowgli_helper_fd_kept(i, keep, nkeep))
 			continue;
 
 		if (dup2(x, i) == i)
@@ -77,14 +166,16 @@ mowgli_helper_trampoline(mowgli_helper_create_req_t *req)
 	helper->eventloop = mowgli_eventloop_create();
 	helper->pfd = mowgli_pollable_create(helper->eventloop, helper->fd, helper);
 	helper->userdata = req->userdata;
+	helper->out_ring = req->in_ring;
+	helper->in_ring = req->out_ring;
 
 	mowgli_pollable_set_nonblocking(helper->pfd, true);
 
 	req->start_fn(helper, helper->userdata);
 }
 
-mowgli_eventloop_helper_proc_t *
-mowgli_helper_create(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_start_fn_t *start_fn, const char *helpername, void *userdata)
+static mowgli_eventloop_helper_proc_t *
+mowgli_helper_create_real(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_start_fn_t *start_fn, const char *helpername, void *userdata, size_t ringsize)
 {
 	mowgli_eventloop_helper_proc_t *helper;
 	mowgli_helper_create_req_t child;
@@ -93,6 +184,7 @@ mowgli_helper_create(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_star
 	return_val_if_fail(eventloop != NULL, NULL);
 	return_val_if_fail(start_fn != NULL, NULL);
 
+	memset(&child, 0, sizeof child);
 	child.start_fn = start_fn;
 	child.userdata = userdata;
 
@@ -100,6 +192,19 @@ mowgli_helper_create(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_star
 	helper->type.type = MOWGLI_EVENTLOOP_TYPE_HELPER;
 	helper->eventloop = eventloop;
 
+	if (ringsize > 0)
+	{
+		/* the rings have to exist before the fork so the child inherits the mappings */
+		helper->out_ring = mowgli_shmring_create(ringsize);
+		helper->in_ring = mowgli_shmring_create(ringsize);
+
+		if ((helper->out_ring == NULL) || (helper->in_ring == NULL))
+			goto fail_rings;
+
+		child.out_ring = helper->out_ring;
+		child.in_ring = helper->in_ring;
+	}
+
 	socketpair(AF_UNIX, SOCK_STREAM, 0, io_fd);
 
 	/* set up helper/child fd mapping */
@@ -120,13 +225,41 @@ mowgli_helper_create(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_star
 		close(io_fd[0]);
 		close(io_fd[1]);
 
-		mowgli_free(helper);
-		return NULL;
+		goto fail_rings;
 	}
 
 	close(child.fd);
 
 	return helper;
+
+fail_rings:
+
+	if (helper->out_ring != NULL)
+		mowgli_shmring_destroy(helper->out_ring);
+
+	if (helper->in_ring != NULL)
+		mowgli_shmring_destroy(helper->in_ring);
+
+	mowgli_free(helper);
+	return NULL;
+}
+
+mowgli_eventloop_helper_proc_t *
+mowgli_helper_create(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_start_fn_t *start_fn, const char *helpername, void *userdata)
+{
+	return mowgli_helper_create_real(eventloop, start_fn, helpername, userdata, 0);
+}
+
+/* like mowgli_helper_create(), but also sets up a pair of shared memory rings
+ * of ringsize bytes each, see helper->out_ring and helper->in_ring.  the
+ * socketpair is still there for control messages.
+ */
+mowgli_eventloop_helper_proc_t *
+mowgli_helper_create_shm(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_start_fn_t *start_fn, const char *helpername, void *userdata, size_t ringsize)
+{
+	return_val_if_fail(ringsize > 0, NULL);
+
+	return mowgli_helper_create_real(eventloop, start_fn, helpername, userdata, ringsize);
 }
 
 mowgli_eventloop_helper_proc_t *
@@ -246,5 +379,181 @@ mowgli_helper_destroy(mowgli_eventloop_t *eventloop, mowgli_eventloop_helper_pro
 	mowgli_pollable_destroy(eventloop, helper->pfd);
 	close(helper->fd);
 
+	if (helper->out_ring != NULL)
+		mowgli_shmring_destroy(helper->out_ring);
+
+	if (helper->in_ring != NULL)
+		mowgli_shmring_destroy(helper->in_ring);
+
 	mowgli_free(helper);
 }
+
+/* Connection handoff.  Each message is a 32-bit length and the data, with
+ * the socket riding on it, sent in one go.  The socketpair is non-blocking:
+ * if it is full, nothing goes and the caller tries again later.  A message
+ * is small, so a read or write cut short partway through is finished with
+ * a short wait, and a peer that takes longer than that has broken the
+ * stream.
+ */
+
+#ifndef _WIN32
+
+#define MOWGLI_HELPER_HANDOFF_WAIT 1000
+
+static void
+mowgli_helper_vio_init(mowgli_vio_t *vio, mowgli_eventloop_helper_proc_t *helper)
+{
+	memset(vio, 0, sizeof *vio);
+	mowgli_vio_init(vio, NULL);
+	vio->io.fd = helper->fd;
+}
+
+static bool
+mowgli_helper_handoff_io(mowgli_vio_t *vio, void *buf, size_t len, bool do_read)
+{
+	struct pollfd pfd = { mowgli_vio_getfd(vio), do_read ? POLLIN : POLLOUT, 0 };
+	char *p = buf;
+	int ret;
+
+	while (len > 0)
+	{
+		ret = do_read ? mowgli_vio_read(vio, p, len) : mowgli_vio_write(vio, p, len);
+
+		if (ret < 0)
+			return false;
+
+		if (ret == 0)
+		{
+			if ((ret = poll(&pfd, 1, MOWGLI_HELPER_HANDOFF_WAIT)) == 0)
+				return false;
+
+			if ((ret < 0) && (errno != EINTR))
+				return false;
+
+			continue;
+		}
+
+		p += ret;
+		len -= ret;
+	}
+
+	return true;
+}
+
+int
+mowgli_helper_send_vio(mowgli_eventloop_helper_proc_t *helper, mowgli_vio_t *vio, const void *data, size_t len)
+{
+	mowgli_vio_t hvio_s, *hvio = &hvio_s;
+	char msg[sizeof(uint32_t) + MOWGLI_HELPER_HANDOFF_MAX];
+	uint32_t msglen = (uint32_t) len;
+	int fd, ret;
+
+	return_val_if_fail(helper != NULL, -1);
+	return_val_if_fail(vio != NULL, -1);
+	return_val_if_fail((fd = mowgli_vio_getfd(vio)) != -1, -1);
+	return_val_if_fail(len <= MOWGLI_HELPER_HANDOFF_MAX, -1);
+
+	if (vio->ops->read != mowgli_vio_default_read)
+	{
+		mowgli_log("VIO object [%p] cannot be handed to a helper: only plain sockets can be", (void *) vio);
+		return -1;
+	}
+
+	memcpy(msg, &msglen, sizeof msglen);
+
+	if (len > 0)
+		memcpy(msg + sizeof msglen, data, len);
+
+	mowgli_helper_vio_init(hvio, helper);
+
+	/* a full socketpair takes nothing, descriptor included */
+	if ((ret = mowgli_vio_sendfds(hvio, msg, sizeof msglen + len, &fd, 1)) <= 0)
+		return (ret == 0) ? 1 : -1;
+
+	if (!mowgli_helper_handoff_io(hvio, msg + ret, sizeof msglen + len - ret, false))
+		return -1;
+
+	return 0;
+}
+
+int
+mowgli_helper_recv_vio(mowgli_eventloop_helper_proc_t *helper, mowgli_vio_t *newvio, void *buf, size_t *len)
+{
+	mowgli_vio_t hvio_s, *hvio = &hvio_s;
+	uint32_t msglen;
+	char discard[256];
+	size_t want;
+	int fd = -1, nfds = 1, ret;
+
+	return_val_if_fail(helper != NULL, -1);
+	return_val_if_fail(newvio != NULL, -1);
+	return_val_if_fail(len != NULL, -1);
+
+	mowgli_helper_vio_init(hvio, helper);
+
+	if ((ret = mowgli_vio_recvfds(hvio, &msglen, sizeof msglen, &fd, &nfds)) <= 0)
+		return (ret == 0) ? 0 : -1;
+
+	if (nfds == 0)
+	{
+		mowgli_log("helper [%p] got a handoff with no connection", (void *) helper);
+		return -1;
+	}
+
+	if (!mowgli_helper_handoff_io(hvio, (char *) &msglen + ret, sizeof msglen - ret, true))
+		goto fail;
+
+	if (msglen > MOWGLI_HELPER_HANDOFF_MAX)
+	{
+		mowgli_log("helper [%p] got a handoff of %u bytes, more than can be sent", (void *) helper, (unsigned int) msglen);
+		goto fail;
+	}
+
+	want = MIN(*len, msglen);
+
+	if (!mowgli_helper_handoff_io(hvio, buf, want, true))
+		goto fail;
+
+	*len = want;
+
+	for (msglen -= want; msglen > 0; msglen -= want)
+	{
+		want = MIN(sizeof discard, msglen);
+
+		if (!mowgli_helper_handoff_io(hvio, discard, want, true))
+			goto fail;
+	}
+
+	newvio->io.fd = fd;
+	newvio->addr.addrlen = sizeof(newvio->addr.addr);
+
+	if (getpeername(fd, (struct sockaddr *) &newvio->addr.addr, &newvio->addr.addrlen) != 0)
+		newvio->addr.addrlen = 0;
+
+	mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_ISCLIENT, true);
+	mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_ISSERVER, false);
+
+	return 1;
+
+fail:
+	close(fd);
+	return -1;
+}
+
+#else
+
+int
+mowgli_helper_send_vio(mowgli_eventloop_helper_proc_t *helper, mowgli_vio_t *vio, const void *data, size_t len)
+{
+	mowgli_log("Connection handoff to helpers is not supported on this platform");
+	return -1;
+}
+
+int
+mowgli_helper_recv_vio(mowgli_eventloop_helper_proc_t *helper, mowgli_vio_t *newvio, void *buf, size_t *len)
+{
+	mowgli_log("Connection handoff to helpers is not supported on this platform");
+	return -1;
+}
+
+#endif
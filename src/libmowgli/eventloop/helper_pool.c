@@ -0,0 +1,698 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * helper_pool.c: Pools of pre-forked helper processes.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* A helper pool keeps a fixed number of helpers forked with
+ * mowgli_helper_create() and talks to them with length-prefixed frames over
+ * the usual socketpair.  Each request carries an id which the helper echoes
+ * back in its reply; helpers answer in order, so every helper simply keeps a
+ * FIFO of the jobs it has been handed.
+ */
+
+#ifndef _WIN32
+
+#ifdef MSG_NOSIGNAL
+# define MOWGLI_HELPER_POOL_SENDFLAGS MSG_NOSIGNAL
+#else
+# define MOWGLI_HELPER_POOL_SENDFLAGS 0
+#endif
+
+/* requests and replies are refused larger than this, and a reply that
+ * claims to be is treated as a protocol error */
+#define MOWGLI_HELPER_POOL_MAX_FRAME (16 * 1024 * 1024)
+
+typedef struct
+{
+	uint32_t id;
+	uint32_t len;
+} mowgli_helper_pool_frame_t;
+
+typedef struct
+{
+	mowgli_node_t node;
+
+	uint32_t id;
+	char *data;
+	size_t len;
+
+	mowgli_helper_pool_done_fn_t *done_fn;
+	void *userdata;
+} mowgli_helper_pool_job_t;
+
+typedef struct
+{
+	mowgli_helper_pool_t *pool;
+	mowgli_eventloop_helper_proc_t *helper;
+	unsigned int slot;
+
+	mowgli_list_t inflight;
+
+	char *wbuf;
+	size_t wlen, wcap;
+
+	char *rbuf;
+	size_t rlen, rcap;
+
+	time_t spawned;
+	bool answered;
+
+	/* bumped each time the helper is lost, see mowgli_helper_pool_read_cb() */
+	unsigned int generation;
+} mowgli_helper_pool_worker_t;
+
+struct _mowgli_helper_pool
+{
+	mowgli_eventloop_t *eventloop;
+	char *helpername;
+
+	mowgli_helper_pool_work_fn_t *work_fn;
+	void *userdata;
+
+	mowgli_helper_pool_worker_t *workers;
+	unsigned int nworkers;
+	unsigned int next_worker;
+
+	mowgli_list_t queue;
+
+	unsigned int max_inflight;
+	unsigned int max_queued;
+
+	uint32_t next_id;
+};
+
+static mowgli_heap_t *job_heap = NULL;
+
+/* helper (child) side state: the id of the request being worked on */
+static uint32_t child_job_id;
+static bool child_replied;
+
+static void mowgli_helper_pool_spawn(mowgli_helper_pool_worker_t *worker);
+static void mowgli_helper_pool_dispatch(mowgli_helper_pool_t *pool);
+
+static void
+mowgli_helper_pool_grow(char **buf, size_t *cap, size_t used, size_t newcap)
+{
+	char *nbuf = mowgli_alloc(newcap);
+
+	if (used > 0)
+		memcpy(nbuf, *buf, used);
+
+	if (*buf != NULL)
+		mowgli_free(*buf);
+
+	*buf = nbuf;
+	*cap = newcap;
+}
+
+static bool
+mowgli_helper_pool_full_io(int fd, void *buf, size_t len, bool do_read)
+{
+	char *p = buf;
+
+	while (len > 0)
+	{
+		ssize_t ret = do_read ? read(fd, p, len) : send(fd, p, len, MOWGLI_HELPER_POOL_SENDFLAGS);
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret <= 0)
+			return false;
+
+		p += ret;
+		len -= ret;
+	}
+
+	return true;
+}
+
+void
+mowgli_helper_pool_reply(mowgli_eventloop_helper_proc_t *helper, const void *data, size_t len)
+{
+	mowgli_helper_pool_frame_t frame;
+
+	return_if_fail(helper != NULL);
+	return_if_fail(!child_replied);
+
+	/* the parent would take a bigger frame as a broken helper; refused
+	 * here, the request is answered empty once the work function returns */
+	return_if_fail(len <= MOWGLI_HELPER_POOL_MAX_FRAME);
+
+	frame.id = child_job_id;
+	frame.len = (uint32_t) len;
+	child_replied = true;
+
+	if (!mowgli_helper_pool_full_io(helper->fd, &frame, sizeof frame, false) ||
+	    !mowgli_helper_pool_full_io(helper->fd, (void *) data, len, false))
+		_exit(EXIT_FAILURE);
+}
+
+/* runs in the helper: a plain blocking request/reply loop */
+static void
+mowgli_helper_pool_child_start(mowgli_eventloop_helper_proc_t *helper, void *userdata)
+{
+	mowgli_helper_pool_t *pool = userdata;
+	mowgli_helper_pool_frame_t frame;
+	char *buf = NULL;
+	size_t bufsize = 0;
+
+	mowgli_pollable_set_nonblocking(helper->pfd, false);
+
+	while (mowgli_helper_pool_full_io(helper->fd, &frame, sizeof frame, true))
+	{
+		/* the parent never sends more; anything bigger is a broken stream */
+		if (frame.len > MOWGLI_HELPER_POOL_MAX_FRAME)
+			break;
+
+		if ((size_t) frame.len + 1 > bufsize)
+		{
+			if (buf != NULL)
+				mowgli_free(buf);
+
+			bufsize = (size_t) frame.len + 1;
+			buf = mowgli_alloc(bufsize);
+		}
+
+		if (!mowgli_helper_pool_full_io(helper->fd, buf, frame.len, true))
+			break;
+
+		buf[frame.len] = '\0';
+
+		child_job_id = frame.id;
+		child_replied = false;
+
+		pool->work_fn(helper, buf, frame.len, pool->userdata);
+
+		if (!child_replied)
+			mowgli_helper_pool_reply(helper, NULL, 0);
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+static void
+mowgli_helper_pool_job_free(mowgli_helper_pool_job_t *job)
+{
+	if (job->data != NULL)
+		mowgli_free(job->data);
+
+	mowgli_heap_free(job_heap, job);
+}
+
+static void
+mowgli_helper_pool_job_fail(mowgli_helper_pool_t *pool, mowgli_helper_pool_job_t *job)
+{
+	if (job->done_fn != NULL)
+		job->done_fn(pool, NULL, 0, job->userdata);
+
+	mowgli_helper_pool_job_free(job);
+}
+
+static void
+mowgli_helper_pool_respawn_timer(void *arg)
+{
+	mowgli_helper_pool_spawn(arg);
+	mowgli_helper_pool_dispatch(((mowgli_helper_pool_worker_t *) arg)->pool);
+}
+
+/* tear down a helper which died or misbehaved, fail the jobs it held and
+ * start a replacement.  a helper that dies within a second of being forked
+ * without answering anything is restarted from a timer so that a broken
+ * helper cannot turn into a fork loop.
+ */
+static void
+mowgli_helper_pool_worker_lost(mowgli_helper_pool_worker_t *worker)
+{
+	mowgli_helper_pool_t *pool = worker->pool;
+	mowgli_eventloop_helper_proc_t *helper = worker->helper;
+	mowgli_process_t *child;
+	mowgli_node_t *n, *tn;
+	mowgli_list_t jobs = worker->inflight;
+
+	return_if_fail(helper != NULL);
+
+	child = helper->child;
+
+	mowgli_log("helper pool %s: helper %u (pid %d) went away", pool->helpername, worker->slot, (int) child->pid);
+
+	worker->helper = NULL;
+	worker->generation++;
+	memset(&worker->inflight, 0, sizeof worker->inflight);
+	worker->wlen = worker->rlen = 0;
+
+	mowgli_helper_destroy(pool->eventloop, helper);
+	waitpid(child->pid, NULL, 0);
+	mowgli_free(child);
+
+	if (!worker->answered && (mowgli_eventloop_get_time(pool->eventloop) - worker->spawned < 1))
+		mowgli_timer_add_once(pool->eventloop, "mowgli_helper_pool_respawn", mowgli_helper_pool_respawn_timer, worker, 1);
+	else
+		mowgli_helper_pool_spawn(worker);
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, jobs.head)
+	{
+		mowgli_node_delete(n, &jobs);
+		mowgli_helper_pool_job_fail(pool, n->data);
+	}
+
+	mowgli_helper_pool_dispatch(pool);
+}
+
+static void mowgli_helper_pool_write_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata);
+
+/* push as much of the pending output as the socket takes, returns false if
+ * the helper is gone.
+ */
+static bool
+mowgli_helper_pool_flush(mowgli_helper_pool_worker_t *worker)
+{
+	mowgli_eventloop_helper_proc_t *helper = worker->helper;
+	ssize_t ret;
+
+	if (worker->wlen > 0)
+	{
+		ret = send(helper->fd, worker->wbuf, worker->wlen, MOWGLI_HELPER_POOL_SENDFLAGS);
+
+		if (ret < 0 && !mowgli_eventloop_ignore_errno(errno))
+			return false;
+
+		if (ret > 0)
+		{
+			worker->wlen -= ret;
+			memmove(worker->wbuf, worker->wbuf + ret, worker->wlen);
+		}
+	}
+
+	mowgli_pollable_setselect(worker->pool->eventloop, helper->pfd, MOWGLI_EVENTLOOP_IO_WRITE,
+				  worker->wlen > 0 ? mowgli_helper_pool_write_cb : NULL);
+
+	return true;
+}
+
+static void
+mowgli_helper_pool_write_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_helper_proc_t *helper = userdata;
+	mowgli_helper_pool_worker_t *worker = helper->userdata;
+
+	if (!mowgli_helper_pool_flush(worker))
+		mowgli_helper_pool_worker_lost(worker);
+}
+
+static void
+mowgli_helper_pool_read_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_eventloop_helper_proc_t *helper = mowgli_eventloop_io_helper(io);
+	mowgli_helper_pool_worker_t *worker = helper->userdata;
+	mowgli_helper_pool_t *pool = worker->pool;
+	mowgli_helper_pool_frame_t frame;
+	unsigned int generation = worker->generation;
+	size_t off = 0;
+	ssize_t ret;
+
+	if (worker->rcap - worker->rlen < 4096)
+		mowgli_helper_pool_grow(&worker->rbuf, &worker->rcap, worker->rlen, MAX(worker->rcap * 2, 8192));
+
+	ret = read(helper->fd, worker->rbuf + worker->rlen, worker->rcap - worker->rlen);
+
+	if (ret < 0 && mowgli_eventloop_ignore_errno(errno))
+		return;
+
+	if (ret <= 0)
+	{
+		mowgli_helper_pool_worker_lost(worker);
+		return;
+	}
+
+	worker->rlen += ret;
+
+	while (worker->rlen - off >= sizeof frame)
+	{
+		mowgli_helper_pool_job_t *job;
+
+		memcpy(&frame, worker->rbuf + off, sizeof frame);
+
+		if ((frame.len > MOWGLI_HELPER_POOL_MAX_FRAME) || (worker->inflight.head == NULL) ||
+		    (((mowgli_helper_pool_job_t *) worker->inflight.head->data)->id != frame.id))
+		{
+			mowgli_log("helper pool %s: protocol error from helper %u", pool->helpername, worker->slot);
+			mowgli_helper_pool_worker_lost(worker);
+			return;
+		}
+
+		if (worker->rlen - off - sizeof frame < frame.len)
+		{
+			/* make sure the rest of a large reply fits */
+			if (worker->rcap < sizeof frame + frame.len)
+				mowgli_helper_pool_grow(&worker->rbuf, &worker->rcap, worker->rlen, sizeof frame + frame.len);
+
+			break;
+		}
+
+		job = worker->inflight.head->data;
+		mowgli_node_delete(&job->node, &worker->inflight);
+		worker->answered = true;
+
+		if (job->done_fn != NULL)
+			job->done_fn(pool, worker->rbuf + off + sizeof frame, frame.len, job->userdata);
+
+		mowgli_helper_pool_job_free(job);
+
+		off += sizeof frame + frame.len;
+
+		/* the callback may have submitted work which killed this helper.  a
+		 * replacement may well have been allocated at the same address, so
+		 * the pointer is no use for telling */
+		if (worker->generation != generation)
+			return;
+	}
+
+	worker->rlen -= off;
+	memmove(worker->rbuf, worker->rbuf + off, worker->rlen);
+
+	mowgli_helper_pool_dispatch(pool);
+}
+
+static void
+mowgli_helper_pool_spawn(mowgli_helper_pool_worker_t *worker)
+{
+	mowgli_helper_pool_t *pool = worker->pool;
+	mowgli_eventloop_helper_proc_t *helper;
+
+	helper = mowgli_helper_create(pool->eventloop, mowgli_helper_pool_child_start, pool->helpername, pool);
+
+	if (helper == NULL)
+	{
+		mowgli_log("helper pool %s: couldn't spawn helper %u, retrying later", pool->helpername, worker->slot);
+		mowgli_timer_add_once(pool->eventloop, "mowgli_helper_pool_respawn", mowgli_helper_pool_respawn_timer, worker, 1);
+		return;
+	}
+
+	helper->userdata = worker;
+	worker->helper = helper;
+	worker->spawned = mowgli_eventloop_get_time(pool->eventloop);
+	worker->answered = false;
+
+	mowgli_helper_set_read_cb(pool->eventloop, helper, mowgli_helper_pool_read_cb);
+}
+
+/* hand a job to a helper.  if nothing is waiting to be written we try to send
+ * straight from the job's buffer and only keep what the socket didn't take.
+ */
+static bool
+mowgli_helper_pool_send(mowgli_helper_pool_worker_t *worker, mowgli_helper_pool_job_t *job, const void *data)
+{
+	mowgli_helper_pool_frame_t frame;
+	size_t total = sizeof frame + job->len;
+	size_t sent = 0;
+
+	frame.id = job->id;
+	frame.len = (uint32_t) job->len;
+
+	mowgli_node_add(job, &job->node, &worker->inflight);
+
+	if (worker->wlen == 0)
+	{
+		struct iovec iov[2];
+		struct msghdr msg;
+		ssize_t ret;
+
+		iov[0].iov_base = &frame;
+		iov[0].iov_len = sizeof frame;
+		iov[1].iov_base = (void *) data;
+		iov[1].iov_len = job->len;
+
+		memset(&msg, 0, sizeof msg);
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 2;
+
+		ret = sendmsg(worker->helper->fd, &msg, MOWGLI_HELPER_POOL_SENDFLAGS);
+
+		if (ret < 0 && !mowgli_eventloop_ignore_errno(errno))
+			return false;
+
+		if (ret > 0)
+			sent = ret;
+
+		if (sent == total)
+			return true;
+	}
+
+	if (worker->wcap - worker->wlen < total - sent)
+		mowgli_helper_pool_grow(&worker->wbuf, &worker->wcap, worker->wlen, MAX(worker->wcap * 2, worker->wlen + total - sent));
+
+	if (sent < sizeof frame)
+	{
+		memcpy(worker->wbuf + worker->wlen, (char *) &frame + sent, sizeof frame - sent);
+		worker->wlen += sizeof frame - sent;
+		sent = sizeof frame;
+	}
+
+	memcpy(worker->wbuf + worker->wlen, (const char *) data + (sent - sizeof frame), total - sent);
+	worker->wlen += total - sent;
+
+	return mowgli_helper_pool_flush(worker);
+}
+
+static mowgli_helper_pool_worker_t *
+mowgli_helper_pool_least_loaded(mowgli_helper_pool_t *pool)
+{
+	mowgli_helper_pool_worker_t *best = NULL;
+	unsigned int i;
+
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		mowgli_helper_pool_worker_t *worker = &pool->workers[(pool->next_worker + i) % pool->nworkers];
+
+		if ((worker->helper == NULL) || (MOWGLI_LIST_LENGTH(&worker->inflight) >= pool->max_inflight))
+			continue;
+
+		if ((best == NULL) || (MOWGLI_LIST_LENGTH(&worker->inflight) < MOWGLI_LIST_LENGTH(&best->inflight)))
+			best = worker;
+	}
+
+	pool->next_worker = (pool->next_worker + 1) % pool->nworkers;
+
+	return best;
+}
+
+static void
+mowgli_helper_pool_dispatch(mowgli_helper_pool_t *pool)
+{
+	mowgli_helper_pool_worker_t *worker;
+
+	while (pool->queue.head != NULL && (worker = mowgli_helper_pool_least_loaded(pool)) != NULL)
+	{
+		mowgli_helper_pool_job_t *job = pool->queue.head->data;
+
+		mowgli_node_delete(&job->node, &pool->queue);
+
+		if (!mowgli_helper_pool_send(worker, job, job->data))
+		{
+			/* put it back, another helper (or the replacement) gets it */
+			mowgli_node_delete(&job->node, &worker->inflight);
+			mowgli_node_add_head(job, &job->node, &pool->queue);
+			mowgli_helper_pool_worker_lost(worker);
+			continue;
+		}
+
+		mowgli_free(job->data);
+		job->data = NULL;
+	}
+}
+
+mowgli_helper_pool_t *
+mowgli_helper_pool_create(mowgli_eventloop_t *eventloop, const char *helpername, unsigned int helpers, mowgli_helper_pool_work_fn_t *work_fn, void *userdata)
+{
+	mowgli_helper_pool_t *pool;
+	unsigned int i;
+
+	return_val_if_fail(eventloop != NULL, NULL);
+	return_val_if_fail(helpername != NULL, NULL);
+	return_val_if_fail(helpers > 0, NULL);
+	return_val_if_fail(work_fn != NULL, NULL);
+
+	if (job_heap == NULL)
+		job_heap = mowgli_heap_create(sizeof(mowgli_helper_pool_job_t), 64, BH_NOW);
+
+	pool = mowgli_alloc(sizeof *pool);
+	pool->eventloop = eventloop;
+	pool->helpername = mowgli_strdup(helpername);
+	pool->work_fn = work_fn;
+	pool->userdata = userdata;
+	pool->max_inflight = 4;
+	pool->max_queued = 256;
+
+	pool->nworkers = helpers;
+	pool->workers = mowgli_alloc_array(sizeof(mowgli_helper_pool_worker_t), helpers);
+
+	for (i = 0; i < helpers; i++)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].slot = i;
+
+		mowgli_helper_pool_spawn(&pool->workers[i]);
+	}
+
+	return pool;
+}
+
+/* max_inflight bounds how many jobs each helper is handed before it answered
+ * earlier ones, max_queued how many jobs may wait for a free helper before
+ * mowgli_helper_pool_submit() starts refusing work.
+ */
+void
+mowgli_helper_pool_set_limits(mowgli_helper_pool_t *pool, unsigned int max_inflight, unsigned int max_queued)
+{
+	return_if_fail(pool != NULL);
+	return_if_fail(max_inflight > 0);
+
+	pool->max_inflight = max_inflight;
+	pool->max_queued = max_queued;
+
+	mowgli_helper_pool_dispatch(pool);
+}
+
+/* queue a job of up to 16 MiB.  done_fn runs on the pool's eventloop with
+ * the helper's reply, or with a NULL reply if the helper handling the job
+ * died.  returns false (and does not call done_fn) if the pool is saturated.
+ */
+bool
+mowgli_helper_pool_submit(mowgli_helper_pool_t *pool, const void *data, size_t len, mowgli_helper_pool_done_fn_t *done_fn, void *userdata)
+{
+	mowgli_helper_pool_worker_t *worker;
+	mowgli_helper_pool_job_t *job;
+
+	return_val_if_fail(pool != NULL, false);
+	return_val_if_fail(data != NULL || len == 0, false);
+	return_val_if_fail(len <= MOWGLI_HELPER_POOL_MAX_FRAME, false);
+
+	worker = pool->queue.head == NULL ? mowgli_helper_pool_least_loaded(pool) : NULL;
+
+	if ((worker == NULL) && (MOWGLI_LIST_LENGTH(&pool->queue) >= pool->max_queued))
+		return false;
+
+	job = mowgli_heap_alloc(job_heap);
+	job->id = pool->next_id++;
+	job->data = NULL;
+	job->len = len;
+	job->done_fn = done_fn;
+	job->userdata = userdata;
+
+	if (worker != NULL)
+	{
+		if (mowgli_helper_pool_send(worker, job, data))
+			return true;
+
+		/* the helper is gone; its replacement will pick the job up */
+		mowgli_node_delete(&job->node, &worker->inflight);
+		mowgli_helper_pool_worker_lost(worker);
+	}
+
+	job->data = mowgli_alloc(MAX(len, 1));
+	memcpy(job->data, data, len);
+
+	mowgli_node_add(job, &job->node, &pool->queue);
+	mowgli_helper_pool_dispatch(pool);
+
+	return true;
+}
+
+/* number of jobs which have been submitted but not answered yet */
+size_t
+mowgli_helper_pool_pending(mowgli_helper_pool_t *pool)
+{
+	size_t pending;
+	unsigned int i;
+
+	return_val_if_fail(pool != NULL, 0);
+
+	pending = MOWGLI_LIST_LENGTH(&pool->queue);
+
+	for (i = 0; i < pool->nworkers; i++)
+		pending += MOWGLI_LIST_LENGTH(&pool->workers[i].inflight);
+
+	return pending;
+}
+
+/* kill all helpers; jobs which are still pending are failed */
+void
+mowgli_helper_pool_destroy(mowgli_helper_pool_t *pool)
+{
+	mowgli_node_t *n, *tn;
+	mowgli_list_t jobs;
+	unsigned int i;
+
+	return_if_fail(pool != NULL);
+
+	memset(&jobs, 0, sizeof jobs);
+
+	for (i = 0; i < pool->nworkers; i++)
+	{
+		mowgli_helper_pool_worker_t *worker = &pool->workers[i];
+		mowgli_eventloop_timer_t *timer;
+
+		while ((timer = mowgli_timer_find(pool->eventloop, mowgli_helper_pool_respawn_timer, worker)) != NULL)
+			mowgli_timer_destroy(pool->eventloop, timer);
+
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, worker->inflight.head)
+		{
+			mowgli_node_delete(n, &worker->inflight);
+			mowgli_node_add(n->data, n, &jobs);
+		}
+
+		if (worker->helper != NULL)
+		{
+			mowgli_process_t *child = worker->helper->child;
+
+			mowgli_helper_destroy(pool->eventloop, worker->helper);
+			waitpid(child->pid, NULL, 0);
+			mowgli_free(child);
+		}
+
+		if (worker->wbuf != NULL)
+			mowgli_free(worker->wbuf);
+
+		if (worker->rbuf != NULL)
+			mowgli_free(worker->rbuf);
+	}
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, pool->queue.head)
+	{
+		mowgli_node_delete(n, &pool->queue);
+		mowgli_node_add(n->data, n, &jobs);
+	}
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, jobs.head)
+	{
+		mowgli_node_delete(n, &jobs);
+		mowgli_helper_pool_job_fail(pool, n->data);
+	}
+
+	mowgli_free(pool->workers);
+	mowgli_free(pool->helpername);
+	mowgli_free(pool);
+}
+
+#endif
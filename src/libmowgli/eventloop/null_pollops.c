@@ -21,10 +21,61 @@
 #include "mowgli.h"
 #include "eventloop/eventloop_internal.h"
 
+static long long
+mowgli_simple_eventloop_usec(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return (long long) tp.tv_sec * 1000000 + tp.tv_nsec / 1000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/* spin on zero-timeout polls for the current busypoll window (bounded by the
+ * time we would otherwise have slept).  returns true if events were
+ * dispatched, in which case the window is widened; otherwise it is halved so
+ * that an idle loop backs off to blocking.
+ */
+static bool
+mowgli_simple_eventloop_busypoll(mowgli_eventloop_t *eventloop, int timeout)
+{
+	unsigned long dispatched = eventloop->dispatched;
+	long long window = eventloop->busypoll_window;
+	long long deadline;
+
+	if (window > (long long) timeout * 1000)
+		window = (long long) timeout * 1000;
+
+	deadline = mowgli_simple_eventloop_usec() + window;
+
+	do
+	{
+		eventloop->eventloop_ops->select(eventloop, 0);
+
+		if (eventloop->dispatched != dispatched)
+		{
+			eventloop->busypoll_window = MIN(eventloop->busypoll_window * 2, eventloop->busypoll_max);
+			return true;
+		}
+	} while (!eventloop->death_requested && mowgli_simple_eventloop_usec() < deadline);
+
+	eventloop->busypoll_window /= 2;
+
+	return false;
+}
+
 void
 mowgli_simple_eventloop_timeout_once(mowgli_eventloop_t *eventloop, int timeout)
 {
 	time_t delay, currtime;
+	unsigned long dispatched;
+	long long spun;
 	int t;
 
 	return_if_fail(eventloop != NULL);
@@ -55,7 +106,25 @@ mowgli_simple_eventloop_timeout_once(mowgli_eventloop_t *eventloop, int timeout)
 	mowgli_log("delay: %ld, currtime: %ld, select period: %d", delay, currtime, t);
 #endif
 
+	if ((eventloop->busypoll_window > 0) && (t > 0))
+	{
+		spun = mowgli_simple_eventloop_usec();
+
+		if (mowgli_simple_eventloop_busypoll(eventloop, t))
+			return;
+
+		/* the time spent spinning counts against the timeout */
+		spun = (mowgli_simple_eventloop_usec() - spun) / 1000;
+		t = (spun < t) ? t - (int) spun : 0;
+	}
+
+	dispatched = eventloop->dispatched;
+
 	eventloop->eventloop_ops->select(eventloop, t);
+
+	/* we were woken up by I/O, so expect more: spin next time around */
+	if ((eventloop->busypoll_max > 0) && (eventloop->busypoll_window == 0) && (eventloop->dispatched != dispatched))
+		eventloop->busypoll_window = MAX(eventloop->busypoll_max / 4, 1);
 }
 
 void
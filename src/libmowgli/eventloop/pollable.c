@@ -134,6 +134,25 @@ mowgli_pollable_set_cloexec(mowgli_eventloop_pollable_t *pollable, bool cloexec)
 #endif
 }
 
+/* ask the kernel to busy-poll the device queue on blocking reads (SO_BUSY_POLL);
+ * returns false if the platform or the socket does not support it.
+ */
+bool
+mowgli_pollable_set_busypoll(mowgli_eventloop_pollable_t *pollable, unsigned int usec)
+{
+#if defined(SO_BUSY_POLL)
+	int val = (int) usec;
+
+	return_val_if_fail(pollable != NULL, false);
+
+	return setsockopt(pollable->fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof val) == 0;
+#else
+	return_val_if_fail(pollable != NULL, false);
+
+	return false;
+#endif
+}
+
 void
 mowgli_pollable_trigger(mowgli_eventloop_t *eventloop, mowgli_eventloop_pollable_t *pollable, mowgli_eventloop_io_dir_t dir)
 {
@@ -158,5 +177,7 @@ mowgli_pollable_trigger(mowgli_eventloop_t *eventloop, mowgli_eventloop_pollable
 	if (event_function == NULL)
 		return;
 
+	eventloop->dispatched++;
+
 	event_function(eventloop, pollable, dir, pollable->userdata);
 }
@@ -0,0 +1,659 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * shmring.c: Single-producer/single-consumer rings in shared memory.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* A shmring is a byte ring living in a MAP_SHARED mapping which is created
+ * before a helper is forked, so both processes see the same memory.  Data
+ * never passes through the kernel; the only syscalls are doorbells, and a
+ * doorbell is only rung when the other side has said it is about to sleep:
+ *
+ *   producer:  publish head;  if (xchg(consumer_waiting, 0)) ring
+ *   consumer:  consumer_waiting = 1;  if (head != tail) don't sleep
+ *
+ * Both sides use sequentially consistent operations there, so at least one
+ * of them sees the other's store and a wakeup cannot get lost.  The same
+ * scheme with producer_waiting is used to wait for free space.
+ *
+ * Where memfd_create(2) exists the data pages are mapped twice, back to
+ * back, so every readable or writable region is contiguous.
+ */
+
+#if !defined(_WIN32) && defined(HAVE_MMAP) && defined(__GNUC__)
+
+#include <poll.h>
+#include <sys/mman.h>
+
+#if defined(__linux__)
+# include <sys/eventfd.h>
+# include <sys/syscall.h>
+#endif
+
+#ifndef MAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define MOWGLI_SHMRING_CACHELINE 64
+
+typedef struct
+{
+	uint64_t head;
+	uint32_t producer_waiting;
+	char pad0[MOWGLI_SHMRING_CACHELINE - sizeof(uint64_t) - sizeof(uint32_t)];
+
+	uint64_t tail;
+	uint32_t consumer_waiting;
+	char pad1[MOWGLI_SHMRING_CACHELINE - sizeof(uint64_t) - sizeof(uint32_t)];
+} mowgli_shmring_shared_t;
+
+struct _mowgli_shmring
+{
+	mowgli_shmring_shared_t *shared;
+	char *data;
+	size_t size;
+
+	void *map;
+	size_t maplen;
+	bool mirrored;
+
+	int memfd;
+
+	/* doorbells: [0] is waited on, [1] is rung.  with eventfd both are the
+	 * same descriptor.
+	 */
+	int data_fd[2];
+	int space_fd[2];
+
+	mowgli_eventloop_t *eventloop;
+	mowgli_eventloop_pollable_t *data_pfd;
+	mowgli_eventloop_pollable_t *space_pfd;
+
+	mowgli_shmring_cb_t *read_function;
+	void *read_userdata;
+	mowgli_shmring_cb_t *write_function;
+	void *write_userdata;
+};
+
+#define LOAD(p, order) __atomic_load_n((p), (order))
+#define STORE(p, v, order) __atomic_store_n((p), (v), (order))
+
+static bool
+mowgli_shmring_doorbell_create(int fd[2])
+{
+#if defined(__linux__) && defined(EFD_NONBLOCK)
+
+	if ((fd[0] = fd[1] = eventfd(0, EFD_NONBLOCK)) >= 0)
+		return true;
+
+#endif
+
+	if (pipe(fd) < 0)
+		return false;
+
+	fcntl(fd[0], F_SETFL, fcntl(fd[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fd[1], F_SETFL, fcntl(fd[1], F_GETFL) | O_NONBLOCK);
+
+	return true;
+}
+
+static void
+mowgli_shmring_doorbell_close(int fd[2])
+{
+	if (fd[0] >= 0)
+		close(fd[0]);
+
+	if ((fd[1] >= 0) && (fd[1] != fd[0]))
+		close(fd[1]);
+
+	fd[0] = fd[1] = -1;
+}
+
+static void
+mowgli_shmring_doorbell_ring(int fd[2])
+{
+	uint64_t one = 1;
+	ssize_t ret;
+
+	/* a full pipe already means "wake up" */
+	if (fd[0] == fd[1])
+		ret = write(fd[1], &one, sizeof one);
+	else
+		ret = write(fd[1], "", 1);
+
+	(void) ret;
+}
+
+static void
+mowgli_shmring_doorbell_drain(int fd[2])
+{
+	char buf[64];
+	ssize_t ret;
+
+	/* an eventfd is reset by a single read */
+	if (fd[0] == fd[1])
+	{
+		ret = read(fd[0], buf, sizeof(uint64_t));
+		(void) ret;
+		return;
+	}
+
+	while (read(fd[0], buf, sizeof buf) > 0)
+		;
+}
+
+static bool
+mowgli_shmring_map(mowgli_shmring_t *ring, size_t pagesize)
+{
+	char *base;
+
+	ring->memfd = -1;
+
+#ifdef SYS_memfd_create
+
+	if ((ring->memfd = syscall(SYS_memfd_create, "mowgli_shmring", 0U)) >= 0)
+	{
+		ring->maplen = pagesize + 2 * ring->size;
+
+		if (ftruncate(ring->memfd, pagesize + ring->size) < 0)
+			goto fallback;
+
+		/* reserve the whole range, then put the file's data pages into it twice */
+		base = mmap(NULL, ring->maplen, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (base == MAP_FAILED)
+			goto fallback;
+
+		if ((mmap(base, pagesize + ring->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, ring->memfd, 0) == MAP_FAILED) ||
+		    (mmap(base + pagesize + ring->size, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, ring->memfd, pagesize) == MAP_FAILED))
+		{
+			munmap(base, ring->maplen);
+			goto fallback;
+		}
+
+		ring->map = base;
+		ring->mirrored = true;
+
+		return true;
+	}
+
+fallback:
+
+	if (ring->memfd >= 0)
+	{
+		close(ring->memfd);
+		ring->memfd = -1;
+	}
+
+#endif
+
+	ring->maplen = pagesize + ring->size;
+	base = mmap(NULL, ring->maplen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (base == MAP_FAILED)
+		return false;
+
+	ring->map = base;
+	ring->mirrored = false;
+
+	return true;
+}
+
+/* create a ring holding up to size bytes.  size is rounded up to a power of
+ * two multiple of the page size.  the ring must be created before forking
+ * the process which is going to share it.
+ */
+mowgli_shmring_t *
+mowgli_shmring_create(size_t size)
+{
+	mowgli_shmring_t *ring;
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+	size_t rsize = pagesize;
+
+	return_val_if_fail(size > 0, NULL);
+
+	while (rsize < size)
+		rsize <<= 1;
+
+	ring = mowgli_alloc(sizeof *ring);
+	ring->size = rsize;
+	ring->data_fd[0] = ring->data_fd[1] = -1;
+	ring->space_fd[0] = ring->space_fd[1] = -1;
+
+	if (!mowgli_shmring_map(ring, pagesize))
+	{
+		mowgli_log("mowgli_shmring_create(): mmap failed: %s", strerror(errno));
+		mowgli_free(ring);
+		return NULL;
+	}
+
+	ring->shared = ring->map;
+	ring->data = (char *) ring->map + pagesize;
+
+	if (!mowgli_shmring_doorbell_create(ring->data_fd) || !mowgli_shmring_doorbell_create(ring->space_fd))
+	{
+		mowgli_log("mowgli_shmring_create(): couldn't create doorbell: %s", strerror(errno));
+		mowgli_shmring_destroy(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+void
+mowgli_shmring_destroy(mowgli_shmring_t *ring)
+{
+	return_if_fail(ring != NULL);
+
+	if (ring->data_pfd != NULL)
+		mowgli_pollable_destroy(ring->eventloop, ring->data_pfd);
+
+	if (ring->space_pfd != NULL)
+		mowgli_pollable_destroy(ring->eventloop, ring->space_pfd);
+
+	mowgli_shmring_doorbell_close(ring->data_fd);
+	mowgli_shmring_doorbell_close(ring->space_fd);
+
+	if (ring->memfd >= 0)
+		close(ring->memfd);
+
+	munmap(ring->map, ring->maplen);
+	mowgli_free(ring);
+}
+
+/* descriptors which have to survive in a forked child sharing the ring */
+size_t
+mowgli_shmring_get_fds(mowgli_shmring_t *ring, int *fds, size_t max)
+{
+	int all[5];
+	size_t i, n = 0;
+
+	return_val_if_fail(ring != NULL, 0);
+
+	all[0] = ring->memfd;
+	all[1] = ring->data_fd[0];
+	all[2] = ring->data_fd[1];
+	all[3] = ring->space_fd[0];
+	all[4] = ring->space_fd[1];
+
+	for (i = 0; i < 5 && n < max; i++)
+		if ((all[i] >= 0) && ((i == 0) || (all[i] != all[i - 1])))
+			fds[n++] = all[i];
+
+	return n;
+}
+
+size_t
+mowgli_shmring_readable(mowgli_shmring_t *ring)
+{
+	return_val_if_fail(ring != NULL, 0);
+
+	return LOAD(&ring->shared->head, __ATOMIC_ACQUIRE) - LOAD(&ring->shared->tail, __ATOMIC_RELAXED);
+}
+
+size_t
+mowgli_shmring_writable(mowgli_shmring_t *ring)
+{
+	return_val_if_fail(ring != NULL, 0);
+
+	return ring->size - (LOAD(&ring->shared->head, __ATOMIC_RELAXED) - LOAD(&ring->shared->tail, __ATOMIC_ACQUIRE));
+}
+
+/* producer side: returns where up to *len bytes may be written.  on a
+ * mirrored ring that is all of the free space, otherwise only up to the end
+ * of the buffer.
+ */
+void *
+mowgli_shmring_reserve(mowgli_shmring_t *ring, size_t *len)
+{
+	uint64_t head;
+	size_t off, avail;
+
+	return_val_if_fail(ring != NULL, NULL);
+	return_val_if_fail(len != NULL, NULL);
+
+	head = LOAD(&ring->shared->head, __ATOMIC_RELAXED);
+	avail = ring->size - (head - LOAD(&ring->shared->tail, __ATOMIC_ACQUIRE));
+	off = head & (ring->size - 1);
+
+	if (!ring->mirrored)
+		avail = MIN(avail, ring->size - off);
+
+	*len = avail;
+
+	return ring->data + off;
+}
+
+/* producer side: publish len bytes written into the reserved region */
+void
+mowgli_shmring_commit(mowgli_shmring_t *ring, size_t len)
+{
+	uint64_t head;
+
+	return_if_fail(ring != NULL);
+
+	if (len == 0)
+		return;
+
+	head = LOAD(&ring->shared->head, __ATOMIC_RELAXED);
+	STORE(&ring->shared->head, head + len, __ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n(&ring->shared->consumer_waiting, 0, __ATOMIC_SEQ_CST))
+		mowgli_shmring_doorbell_ring(ring->data_fd);
+}
+
+/* consumer side: returns the readable region, see mowgli_shmring_reserve() */
+const void *
+mowgli_shmring_peek(mowgli_shmring_t *ring, size_t *len)
+{
+	uint64_t tail;
+	size_t off, avail;
+
+	return_val_if_fail(ring != NULL, NULL);
+	return_val_if_fail(len != NULL, NULL);
+
+	tail = LOAD(&ring->shared->tail, __ATOMIC_RELAXED);
+	avail = LOAD(&ring->shared->head, __ATOMIC_ACQUIRE) - tail;
+	off = tail & (ring->size - 1);
+
+	if (!ring->mirrored)
+		avail = MIN(avail, ring->size - off);
+
+	*len = avail;
+
+	return ring->data + off;
+}
+
+/* consumer side: release len bytes obtained from mowgli_shmring_peek() */
+void
+mowgli_shmring_consume(mowgli_shmring_t *ring, size_t len)
+{
+	uint64_t tail;
+
+	return_if_fail(ring != NULL);
+
+	if (len == 0)
+		return;
+
+	tail = LOAD(&ring->shared->tail, __ATOMIC_RELAXED);
+	STORE(&ring->shared->tail, tail + len, __ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n(&ring->shared->producer_waiting, 0, __ATOMIC_SEQ_CST))
+		mowgli_shmring_doorbell_ring(ring->space_fd);
+}
+
+/* copying variants of the above, both may transfer less than len bytes */
+size_t
+mowgli_shmring_write(mowgli_shmring_t *ring, const void *data, size_t len)
+{
+	size_t done = 0;
+	uint64_t head;
+
+	return_val_if_fail(ring != NULL, 0);
+	return_val_if_fail(data != NULL || len == 0, 0);
+
+	head = LOAD(&ring->shared->head, __ATOMIC_RELAXED);
+
+	while (done < len)
+	{
+		size_t off = (head + done) & (ring->size - 1);
+		size_t avail = ring->size - (head + done - LOAD(&ring->shared->tail, __ATOMIC_ACQUIRE));
+
+		if (avail == 0)
+			break;
+
+		if (!ring->mirrored)
+			avail = MIN(avail, ring->size - off);
+
+		avail = MIN(avail, len - done);
+		memcpy(ring->data + off, (const char *) data + done, avail);
+		done += avail;
+	}
+
+	mowgli_shmring_commit(ring, done);
+
+	return done;
+}
+
+size_t
+mowgli_shmring_read(mowgli_shmring_t *ring, void *buf, size_t len)
+{
+	size_t done = 0;
+	uint64_t tail;
+
+	return_val_if_fail(ring != NULL, 0);
+	return_val_if_fail(buf != NULL || len == 0, 0);
+
+	tail = LOAD(&ring->shared->tail, __ATOMIC_RELAXED);
+
+	while (done < len)
+	{
+		size_t off = (tail + done) & (ring->size - 1);
+		size_t avail = LOAD(&ring->shared->head, __ATOMIC_ACQUIRE) - (tail + done);
+
+		if (avail == 0)
+			break;
+
+		if (!ring->mirrored)
+			avail = MIN(avail, ring->size - off);
+
+		avail = MIN(avail, len - done);
+		memcpy((char *) buf + done, ring->data + off, avail);
+		done += avail;
+	}
+
+	mowgli_shmring_consume(ring, done);
+
+	return done;
+}
+
+/* announce that this side is about to sleep.  returns true if there is
+ * already something to do, in which case the announcement is withdrawn.
+ */
+static bool
+mowgli_shmring_arm(mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir)
+{
+	uint32_t *flag = dir == MOWGLI_EVENTLOOP_IO_READ ? &ring->shared->consumer_waiting : &ring->shared->producer_waiting;
+	bool ready;
+
+	STORE(flag, 1, __ATOMIC_SEQ_CST);
+
+	if (dir == MOWGLI_EVENTLOOP_IO_READ)
+		ready = LOAD(&ring->shared->head, __ATOMIC_SEQ_CST) != LOAD(&ring->shared->tail, __ATOMIC_SEQ_CST);
+	else
+		ready = LOAD(&ring->shared->head, __ATOMIC_SEQ_CST) - LOAD(&ring->shared->tail, __ATOMIC_SEQ_CST) < ring->size;
+
+	if (ready)
+		STORE(flag, 0, __ATOMIC_RELAXED);
+
+	return ready;
+}
+
+/* block until the ring is readable (or writable) or timeout milliseconds
+ * have passed.  for helpers which do not run an eventloop.
+ */
+bool
+mowgli_shmring_wait(mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir, int timeout)
+{
+	struct pollfd pfd;
+	int *fd;
+
+	return_val_if_fail(ring != NULL, false);
+
+	fd = dir == MOWGLI_EVENTLOOP_IO_READ ? ring->data_fd : ring->space_fd;
+
+	if (mowgli_shmring_arm(ring, dir))
+		return true;
+
+	pfd.fd = fd[0];
+	pfd.events = POLLIN;
+
+	while (poll(&pfd, 1, timeout) < 0 && errno == EINTR)
+		;
+
+	mowgli_shmring_doorbell_drain(fd);
+
+	return dir == MOWGLI_EVENTLOOP_IO_READ ? mowgli_shmring_readable(ring) > 0 : mowgli_shmring_writable(ring) > 0;
+}
+
+static void
+mowgli_shmring_trampoline(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_shmring_t *ring = userdata;
+	mowgli_eventloop_io_dir_t rdir = mowgli_eventloop_io_pollable(io) == ring->data_pfd ? MOWGLI_EVENTLOOP_IO_READ : MOWGLI_EVENTLOOP_IO_WRITE;
+	int *fd = rdir == MOWGLI_EVENTLOOP_IO_READ ? ring->data_fd : ring->space_fd;
+	mowgli_shmring_cb_t **function = rdir == MOWGLI_EVENTLOOP_IO_READ ? &ring->read_function : &ring->write_function;
+	void *cbdata = rdir == MOWGLI_EVENTLOOP_IO_READ ? ring->read_userdata : ring->write_userdata;
+
+	mowgli_shmring_doorbell_drain(fd);
+
+	if (*function != NULL)
+		(*function)(eventloop, ring, cbdata);
+
+	/* if there is still something to do, come back on the next iteration
+	 * rather than looping here so other pollables get their turn.
+	 */
+	if ((*function != NULL) && mowgli_shmring_arm(ring, rdir))
+		mowgli_shmring_doorbell_ring(fd);
+}
+
+/* call function from eventloop whenever the ring becomes readable (dir READ,
+ * consumer side) or writable (dir WRITE, producer side).  a ring must not be
+ * destroyed from its own callback.
+ */
+void
+mowgli_shmring_setselect(mowgli_eventloop_t *eventloop, mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir, mowgli_shmring_cb_t *function, void *userdata)
+{
+	mowgli_eventloop_pollable_t **pfd;
+	int *fd;
+
+	return_if_fail(eventloop != NULL);
+	return_if_fail(ring != NULL);
+	return_if_fail(ring->eventloop == NULL || ring->eventloop == eventloop);
+
+	ring->eventloop = eventloop;
+
+	if (dir == MOWGLI_EVENTLOOP_IO_READ)
+	{
+		pfd = &ring->data_pfd;
+		fd = ring->data_fd;
+		ring->read_function = function;
+		ring->read_userdata = userdata;
+	}
+	else
+	{
+		pfd = &ring->space_pfd;
+		fd = ring->space_fd;
+		ring->write_function = function;
+		ring->write_userdata = userdata;
+	}
+
+	if (*pfd == NULL)
+		*pfd = mowgli_pollable_create(eventloop, fd[0], ring);
+
+	if (function == NULL)
+	{
+		STORE(dir == MOWGLI_EVENTLOOP_IO_READ ? &ring->shared->consumer_waiting : &ring->shared->producer_waiting, 0, __ATOMIC_SEQ_CST);
+		mowgli_pollable_setselect(eventloop, *pfd, MOWGLI_EVENTLOOP_IO_READ, NULL);
+		return;
+	}
+
+	mowgli_pollable_setselect(eventloop, *pfd, MOWGLI_EVENTLOOP_IO_READ, mowgli_shmring_trampoline);
+
+	if (mowgli_shmring_arm(ring, dir))
+		mowgli_shmring_doorbell_ring(fd);
+}
+
+#else
+
+mowgli_shmring_t *
+mowgli_shmring_create(size_t size)
+{
+	mowgli_log("mowgli_shmring_create(): shared memory rings are not supported on this platform");
+	return NULL;
+}
+
+void
+mowgli_shmring_destroy(mowgli_shmring_t *ring)
+{ }
+
+size_t
+mowgli_shmring_get_fds(mowgli_shmring_t *ring, int *fds, size_t max)
+{
+	return 0;
+}
+
+size_t
+mowgli_shmring_readable(mowgli_shmring_t *ring)
+{
+	return 0;
+}
+
+size_t
+mowgli_shmring_writable(mowgli_shmring_t *ring)
+{
+	return 0;
+}
+
+void *
+mowgli_shmring_reserve(mowgli_shmring_t *ring, size_t *len)
+{
+	return NULL;
+}
+
+void
+mowgli_shmring_commit(mowgli_shmring_t *ring, size_t len)
+{ }
+
+const void *
+mowgli_shmring_peek(mowgli_shmring_t *ring, size_t *len)
+{
+	return NULL;
+}
+
+void
+mowgli_shmring_consume(mowgli_shmring_t *ring, size_t len)
+{ }
+
+size_t
+mowgli_shmring_write(mowgli_shmring_t *ring, const void *data, size_t len)
+{
+	return 0;
+}
+
+size_t
+mowgli_shmring_read(mowgli_shmring_t *ring, void *buf, size_t len)
+{
+	return 0;
+}
+
+bool
+mowgli_shmring_wait(mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir, int timeout)
+{
+	return false;
+}
+
+void
+mowgli_shmring_setselect(mowgli_eventloop_t *eventloop, mowgli_shmring_t *ring, mowgli_eventloop_io_dir_t dir, mowgli_shmring_cb_t *function, void *userdata)
+{ }
+
+#endif
@@ -24,14 +24,48 @@
 #include "mowgli.h"
 
 static mowgli_heap_t *linebuf_heap = NULL;
+static mowgli_heap_t *linebuf_seg_heap = NULL;
+
+/* The longest length prefix: a varint of up to 35 bits */
+#define MOWGLI_LINEBUF_FRAME_HDR_MAX 5
+
+static mowgli_object_class_t linebuf_msg_klass;
+static bool linebuf_msg_klass_ready = false;
+
+/* A run of queued output, either in a pool buffer, in a shared message or
+ * in a file (fd is -1 otherwise).  Lines are appended to the last segment
+ * while they fit, which a shared one or a file never does; off is how much
+ * of it has been written so far.  A file segment has no data and is len
+ * bytes of fd from file_off.
+ */
+typedef struct
+{
+	mowgli_node_t node;
+	char *data;
+	size_t size;
+	size_t len;
+	size_t off;
+	mowgli_linebuf_msg_t *msg;
+	int fd;
+	off_t file_off;
+} mowgli_linebuf_seg_t;
 
 static void mowgli_linebuf_read_data(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata);
 static void mowgli_linebuf_write_data(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata);
-static void mowgli_linebuf_process(mowgli_linebuf_t *linebuf);
+static size_t mowgli_linebuf_process(mowgli_linebuf_t *linebuf);
+static size_t mowgli_linebuf_process_frames(mowgli_linebuf_t *linebuf);
 static void mowgli_linebuf_do_shutdown(mowgli_linebuf_t *linebuf);
 
+static void mowgli_linebuf_seg_destroy(mowgli_linebuf_t *linebuf, mowgli_linebuf_seg_t *seg);
+
 static int mowgli_linebuf_error(mowgli_vio_t *vio);
 
+static inline bool
+mowgli_linebuf_is_delim(const mowgli_linebuf_t *linebuf, unsigned char c)
+{
+	return c != '\0' && (linebuf->delim_map[c >> 5] & (1U << (c & 31)));
+}
+
 #ifdef NOTYET
 static mowgli_vio_evops_t linebuf_evops =
 {
@@ -48,6 +82,9 @@ mowgli_linebuf_create(mowgli_linebuf_readline_cb_t *cb, void *userdata)
 	if (linebuf_heap == NULL)
 		linebuf_heap = mowgli_heap_create(sizeof(mowgli_linebuf_t), 16, BH_NOW);
 
+	if (linebuf_seg_heap == NULL)
+		linebuf_seg_heap = mowgli_heap_create(sizeof(mowgli_linebuf_seg_t), 64, BH_NOW);
+
 	linebuf = mowgli_heap_alloc(linebuf_heap);
 
 	/* Sane default */
@@ -56,12 +93,26 @@ mowgli_linebuf_create(mowgli_linebuf_readline_cb_t *cb, void *userdata)
 
 	linebuf->flags = 0;
 
-	linebuf->readbuf.buffer = NULL;
-	linebuf->writebuf.buffer = NULL;
+	linebuf->framing = MOWGLI_LINEBUF_FRAMING_DELIM;
+	linebuf->max_frame = 0;
+
+	/* Buffers are allocated as data turns up, up to these limits */
+	memset(&linebuf->readbuf, 0, sizeof(linebuf->readbuf));
+	memset(&linebuf->writebuf, 0, sizeof(linebuf->writebuf));
+	memset(&linebuf->writeq, 0, sizeof(linebuf->writeq));
+	linebuf->read_copied = 0;
+	linebuf->write_copied = 0;
+	linebuf->read_events = 0;
+	linebuf->read_calls = 0;
 	mowgli_linebuf_setbuflen(&(linebuf->readbuf), 65536);
 	mowgli_linebuf_setbuflen(&(linebuf->writebuf), 65536);
 
+	linebuf->read_budget = MOWGLI_LINEBUF_READ_BUDGET;
+	linebuf->read_line_budget = 0;
+
 	linebuf->eventloop = NULL;
+	linebuf->shrink_timer = NULL;
+	linebuf->busy = false;
 
 	linebuf->return_normal_strings = true;	/* This is generally what you want, but beware of malicious \0's in input data! */
 
@@ -101,6 +152,13 @@ mowgli_linebuf_detach_from_eventloop(mowgli_linebuf_t *linebuf)
 	mowgli_pollable_setselect(linebuf->eventloop, linebuf->vio->io.e, MOWGLI_EVENTLOOP_IO_READ, NULL);
 	mowgli_pollable_setselect(linebuf->eventloop, linebuf->vio->io.e, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
 	mowgli_vio_eventloop_detach(linebuf->vio);
+
+	if (linebuf->shrink_timer != NULL)
+	{
+		mowgli_timer_destroy(linebuf->eventloop, linebuf->shrink_timer);
+		linebuf->shrink_timer = NULL;
+	}
+
 	linebuf->eventloop = NULL;
 }
 
@@ -112,42 +170,165 @@ mowgli_linebuf_destroy(mowgli_linebuf_t *linebuf)
 
 	mowgli_vio_destroy(linebuf->vio);
 
-	mowgli_free(linebuf->readbuf.buffer);
-	mowgli_free(linebuf->writebuf.buffer);
+	if (linebuf->readbuf.buffer != NULL)
+		mowgli_linebuf_pool_free(linebuf->readbuf.buffer, linebuf->readbuf.bufsize);
+
+	while (linebuf->writeq.head != NULL)
+		mowgli_linebuf_seg_destroy(linebuf, linebuf->writeq.head->data);
+
 	mowgli_heap_free(linebuf_heap, linebuf);
 }
 
-void
-mowgli_linebuf_setbuflen(mowgli_linebuf_buf_t *buffer, size_t buflen)
+/* Borrow a buffer of bufsize bytes from the pool if we haven't got one */
+static void
+mowgli_linebuf_borrow(mowgli_linebuf_buf_t *buffer)
 {
-	return_if_fail(buffer != NULL);
+	if (buffer->buffer != NULL)
+		return;
+
+	if (buffer->bufsize == 0)
+		buffer->bufsize = MIN(MOWGLI_LINEBUF_MIN_BUFLEN, buffer->maxbuflen);
+
+	buffer->buffer = mowgli_linebuf_pool_alloc(buffer->bufsize);
+	buffer->head = 0;
+}
+
+/* Hand an empty buffer back to the pool; bufsize is kept for next time */
+static void
+mowgli_linebuf_release(mowgli_linebuf_buf_t *buffer)
+{
+	if ((buffer->buffer == NULL) || (buffer->buflen > 0))
+		return;
+
+	mowgli_linebuf_pool_free(buffer->buffer, buffer->bufsize);
+	buffer->buffer = NULL;
+	buffer->head = 0;
+}
+
+/* Change the size of a buffer, moving anything in it across to the start
+ * of the new one.
+ */
+static void
+mowgli_linebuf_resize(mowgli_linebuf_buf_t *buffer, size_t size)
+{
+	char *newbuf;
+
+	return_if_fail(size >= buffer->buflen);
 
 	if (buffer->buffer == NULL)
 	{
-		buffer->buffer = mowgli_alloc(buflen);
+		buffer->bufsize = size;
+		return;
 	}
-	else
+
+	newbuf = mowgli_linebuf_pool_alloc(size);
+
+	if (buffer->buflen > 0)
 	{
-		char tmpbuf[buffer->maxbuflen];
+		/* Unwrap whatever is buffered to the start of the new one */
+		size_t first = MIN(buffer->buflen, buffer->bufsize - buffer->head);
 
-		if (buffer->buflen > 0)
-			memcpy(tmpbuf, buffer->buffer, buffer->maxbuflen);	/* Copy into tmp buffer */
+		memcpy(newbuf, buffer->buffer + buffer->head, first);
+		memcpy(newbuf + first, buffer->buffer, buffer->buflen - first);
+	}
 
-		/* Free old buffer and reallocate */
-		mowgli_free(buffer->buffer);
-		buffer->buffer = mowgli_alloc(buflen);
+	mowgli_linebuf_pool_free(buffer->buffer, buffer->bufsize);
 
-		if (buffer->buflen > 0)
-			/* Copy into new buffer using old buffer size */
-			memcpy(buffer->buffer, tmpbuf, buffer->maxbuflen);
+	buffer->buffer = newbuf;
+	buffer->bufsize = size;
+	buffer->head = 0;
+}
+
+/* The smallest power of two from MOWGLI_LINEBUF_MIN_BUFLEN up which holds
+ * need bytes, capped at maxbuflen.
+ */
+static size_t
+mowgli_linebuf_fit(mowgli_linebuf_buf_t *buffer, size_t need)
+{
+	size_t size = MOWGLI_LINEBUF_MIN_BUFLEN;
+
+	while (size < need && size < buffer->maxbuflen)
+		size *= 2;
+
+	return MIN(size, buffer->maxbuflen);
+}
+
+static void
+mowgli_linebuf_shrink(void *arg)
+{
+	mowgli_linebuf_t *linebuf = arg;
+	mowgli_linebuf_buf_t *buffer = &linebuf->readbuf;
+
+	/* the eventloop frees the timer once we return */
+	linebuf->shrink_timer = NULL;
+
+	if (!linebuf->busy)
+	{
+		if (buffer->buflen == 0)
+		{
+			mowgli_linebuf_release(buffer);
+			buffer->bufsize = 0;
+		}
+		else if (mowgli_linebuf_fit(buffer, buffer->buflen) < buffer->bufsize)
+		{
+			mowgli_linebuf_resize(buffer, mowgli_linebuf_fit(buffer, buffer->buflen));
+		}
+	}
+
+	linebuf->busy = false;
+
+	if ((buffer->bufsize > MOWGLI_LINEBUF_MIN_BUFLEN) && (linebuf->eventloop != NULL))
+		linebuf->shrink_timer = mowgli_timer_add_once(linebuf->eventloop, "mowgli_linebuf_shrink", mowgli_linebuf_shrink, linebuf, MOWGLI_LINEBUF_SHRINK_INTERVAL);
+}
+
+/* Size a buffer for need bytes in total, within maxbuflen.  This does not
+ * borrow the buffer itself.
+ */
+static bool
+mowgli_linebuf_grow(mowgli_linebuf_t *linebuf, mowgli_linebuf_buf_t *buffer, size_t need)
+{
+	if (need > buffer->maxbuflen)
+		return false;
+
+	if (need <= buffer->bufsize)
+		return true;
+
+	if (buffer->bufsize == 0)
+	{
+		buffer->bufsize = mowgli_linebuf_fit(buffer, need);
+		return true;
 	}
 
+	mowgli_linebuf_resize(buffer, mowgli_linebuf_fit(buffer, need));
+
+	/* Grown buffers get shrunk back once the traffic dies down */
+	linebuf->busy = true;
+
+	if ((buffer->bufsize > MOWGLI_LINEBUF_MIN_BUFLEN) && (linebuf->shrink_timer == NULL) && (linebuf->eventloop != NULL))
+		linebuf->shrink_timer = mowgli_timer_add_once(linebuf->eventloop, "mowgli_linebuf_shrink", mowgli_linebuf_shrink, linebuf, MOWGLI_LINEBUF_SHRINK_INTERVAL);
+
+	return true;
+}
+
+/* Set the most a buffer may grow to */
+void
+mowgli_linebuf_setbuflen(mowgli_linebuf_buf_t *buffer, size_t buflen)
+{
+	return_if_fail(buffer != NULL);
+	return_if_fail(buflen >= buffer->buflen);
+	return_if_fail(buflen > 0);
+
 	buffer->maxbuflen = buflen;
+
+	if (buffer->bufsize > buflen)
+		mowgli_linebuf_resize(buffer, buflen);
 }
 
 void
 mowgli_linebuf_delim(mowgli_linebuf_t *linebuf, const char *delim, const char *endl)
 {
+	const unsigned char *p;
+
 	return_if_fail(linebuf != NULL);
 	return_if_fail(delim != NULL && *delim != '\0');
 	return_if_fail(endl != NULL && *endl != '\0');
@@ -155,32 +336,149 @@ mowgli_linebuf_delim(mowgli_linebuf_t *linebuf, const char *delim, const char *e
 	linebuf->delim = delim;
 	linebuf->endl = endl;
 	linebuf->endl_len = strlen(endl);
+
+	/* Precompute the set for mowgli_linebuf_scan(); NUL always stops it */
+	memset(linebuf->delim_map, 0, sizeof(linebuf->delim_map));
+	linebuf->delim_map[0] = 1;
+	linebuf->delim_count = 0;
+
+	for (p = (const unsigned char *) delim; *p != '\0'; p++)
+	{
+		if (mowgli_linebuf_is_delim(linebuf, *p))
+			continue;
+
+		linebuf->delim_map[*p >> 5] |= 1U << (*p & 31);
+
+		if (linebuf->delim_count < MOWGLI_LINEBUF_DELIM_MAX)
+			linebuf->delim_chars[linebuf->delim_count] = *p;
+
+		linebuf->delim_count++;
+	}
+
+	/* Too many for the vector scanners, leave it to the bitmap */
+	if (linebuf->delim_count > MOWGLI_LINEBUF_DELIM_MAX)
+		linebuf->delim_count = 0;
 }
 
+void
+mowgli_linebuf_framing(mowgli_linebuf_t *linebuf, mowgli_linebuf_framing_t framing, size_t max_frame)
+{
+	return_if_fail(linebuf != NULL);
+	return_if_fail(framing == MOWGLI_LINEBUF_FRAMING_DELIM || max_frame > 0);
+	return_if_fail(framing != MOWGLI_LINEBUF_FRAMING_BE16 || max_frame <= UINT16_MAX);
+	return_if_fail((uint64_t) max_frame <= UINT32_MAX);
+
+	linebuf->framing = framing;
+	linebuf->max_frame = max_frame;
+
+	/* The read buffer has to hold a whole frame to hand it over */
+	if ((framing != MOWGLI_LINEBUF_FRAMING_DELIM) && (linebuf->readbuf.maxbuflen < max_frame + MOWGLI_LINEBUF_FRAME_HDR_MAX))
+		mowgli_linebuf_setbuflen(&linebuf->readbuf, max_frame + MOWGLI_LINEBUF_FRAME_HDR_MAX);
+}
+
+/* Read until the socket runs dry or the read budget is spent, handing
+ * lines over after each buffer-full.  A short read from a plain socket
+ * means there is nothing more for now; other VIOs, like TLS, may return
+ * less than asked while holding more, so those are read until EAGAIN.
+ */
 static void
 mowgli_linebuf_read_data(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
 {
 	mowgli_linebuf_t *linebuf = (mowgli_linebuf_t *) userdata;
 	mowgli_linebuf_buf_t *buffer = &(linebuf->readbuf);
-	void *bufpos;
-	size_t offset;
-	int ret;
-
-	if (buffer->maxbuflen - buffer->buflen == 0)
-	{
-		linebuf->flags |= MOWGLI_LINEBUF_ERR_READBUF_FULL;
-		mowgli_linebuf_error(linebuf->vio);
-		return;
-	}
+	const int errflags = MOWGLI_LINEBUF_ERR_READBUF_FULL | MOWGLI_LINEBUF_ERR_BAD_FRAME;
+	bool failed = false, filled, more = true;
+	size_t tail, space, bytes = 0, lines = 0;
+	uint64_t copied;
+	struct iovec iov[2];
+	int ret, iovcnt, errs;
 
-	bufpos = buffer->buffer + buffer->buflen;
-	offset = buffer->maxbuflen - buffer->buflen + 1;
+	linebuf->read_events++;
 
-	if ((ret = mowgli_vio_read(linebuf->vio, bufpos, offset)) <= 0)
+	while (more)
 	{
-		if (linebuf->vio->error.type == MOWGLI_VIO_ERR_NONE)
+		if (!mowgli_linebuf_grow(linebuf, buffer, buffer->buflen + 1))
+		{
+			linebuf->flags |= MOWGLI_LINEBUF_ERR_READBUF_FULL;
+			mowgli_linebuf_error(linebuf->vio);
 			return;
+		}
+
+		mowgli_linebuf_borrow(buffer);
+
+		/* The free part of the ring is at most two runs: up to the end of
+		 * the buffer, then from the start up to head.  One vectored read
+		 * fills both.
+		 */
+		tail = buffer->head + buffer->buflen;
+		space = buffer->bufsize - buffer->buflen;
+
+		if (tail >= buffer->bufsize)
+		{
+			iov[0].iov_base = buffer->buffer + tail - buffer->bufsize;
+			iov[0].iov_len = space;
+			iovcnt = 1;
+		}
+		else
+		{
+			iov[0].iov_base = buffer->buffer + tail;
+			iov[0].iov_len = buffer->bufsize - tail;
+			iov[1].iov_base = buffer->buffer;
+			iov[1].iov_len = buffer->head;
+			iovcnt = (buffer->head > 0) ? 2 : 1;
+		}
+
+		linebuf->read_calls++;
+
+		if ((ret = mowgli_vio_readv(linebuf->vio, iov, iovcnt)) <= 0)
+		{
+			if (linebuf->vio->error.type != MOWGLI_VIO_ERR_NONE)
+				failed = true;
 
+			more = false;
+		}
+		else
+		{
+			buffer->buflen += ret;
+			bytes += ret;
+			more = ((size_t) ret == space) || (linebuf->vio->ops->read != mowgli_vio_default_read);
+		}
+
+		filled = buffer->buflen == buffer->bufsize;
+		copied = linebuf->read_copied;
+		errs = linebuf->flags & errflags;
+
+		/* Deliver what we got before an error in a second read */
+		if (buffer->buflen > 0)
+			lines += mowgli_linebuf_process(linebuf);
+
+		/* Nothing left over, so the buffer can go back to the pool */
+		mowgli_linebuf_release(buffer);
+
+		if (failed || ((linebuf->flags & errflags) != errs))
+			break;
+
+		/* Make the next read bigger if there is probably more waiting, or if
+		 * a busy stream is wrapping lines round a small ring.
+		 */
+		if (filled || (linebuf->busy && (linebuf->read_copied != copied)))
+			mowgli_linebuf_grow(linebuf, buffer, MIN(buffer->bufsize * 2, buffer->maxbuflen));
+
+		if (linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN)
+			break;
+
+		/* Leave the rest for the next time round the eventloop, but only
+		 * what is still in the socket: input a TLS or buffering layer has
+		 * already taken off it would not wake us up again.
+		 */
+		if ((((linebuf->read_budget != 0) && (bytes >= linebuf->read_budget)) ||
+		     ((linebuf->read_line_budget != 0) && (lines >= linebuf->read_line_budget))) &&
+		    (mowgli_vio_pending(linebuf->vio) == 0))
+			break;
+	}
+
+	if (failed)
+	{
 		/* Let's never come back here */
 		mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_READ, NULL);
 		mowgli_linebuf_do_shutdown(linebuf);
@@ -194,33 +492,175 @@ mowgli_linebuf_read_data(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *i
 	/* Do we want a write for SSL? */
 	if (mowgli_vio_hasflag(linebuf->vio, MOWGLI_VIO_FLAGS_NEEDWRITE))
 		mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_WRITE, mowgli_linebuf_write_data);
+}
 
-	buffer->buflen += ret;
-	mowgli_linebuf_process(linebuf);
+void
+mowgli_linebuf_set_read_budget(mowgli_linebuf_t *linebuf, size_t bytes, size_t lines)
+{
+	return_if_fail(linebuf != NULL);
+
+	linebuf->read_budget = bytes;
+	linebuf->read_line_budget = lines;
+}
+
+/* Start a new segment big enough for need bytes at the end of the write
+ * queue.  Segments get bigger as the queue does, so a large burst goes out
+ * in a few large pieces rather than many small ones, but never bigger than
+ * what is left under the limit.
+ */
+static mowgli_linebuf_seg_t *
+mowgli_linebuf_seg_create(mowgli_linebuf_t *linebuf, size_t need)
+{
+	mowgli_linebuf_seg_t *seg = mowgli_heap_alloc(linebuf_seg_heap);
+	size_t quota = linebuf->writebuf.maxbuflen - linebuf->writebuf.buflen;
+
+	seg->size = mowgli_linebuf_fit(&linebuf->writebuf, MAX(need, MIN(MIN(linebuf->writebuf.buflen, MOWGLI_LINEBUF_SEG_MAX), quota)));
+	seg->data = mowgli_linebuf_pool_alloc(seg->size);
+	seg->len = 0;
+	seg->off = 0;
+	seg->msg = NULL;
+	seg->fd = -1;
+
+	mowgli_node_add(seg, &seg->node, &linebuf->writeq);
+
+	return seg;
+}
+
+static void
+mowgli_linebuf_seg_destroy(mowgli_linebuf_t *linebuf, mowgli_linebuf_seg_t *seg)
+{
+	mowgli_node_delete(&seg->node, &linebuf->writeq);
+
+	if (seg->fd != -1)
+		close(seg->fd);
+	else if (seg->msg != NULL)
+		mowgli_object_unref(seg->msg);
+	else
+		mowgli_linebuf_pool_free(seg->data, seg->size);
+
+	mowgli_heap_free(linebuf_seg_heap, seg);
+}
+
+/* Write out as much of the queue as the other end will take, as many
+ * segments at a time as the system allows, up to the next file.  Returns
+ * the number of bytes written, or what the VIO returned on error.
+ */
+static int
+mowgli_linebuf_flush(mowgli_linebuf_t *linebuf)
+{
+	static int iov_max = 0;
+	struct iovec iov[MOWGLI_LINEBUF_IOV_MAX];
+	mowgli_node_t *n;
+	int iovcnt = 0;
+
+	/* Nothing queued still gets a write, for the sake of SSL handshakes */
+	if (linebuf->writeq.head == NULL)
+		return mowgli_vio_write(linebuf->vio, "", 0);
+
+	if (iov_max == 0)
+	{
+#ifdef _SC_IOV_MAX
+		long sys_max = sysconf(_SC_IOV_MAX);
+
+		iov_max = ((sys_max > 0) && (sys_max < MOWGLI_LINEBUF_IOV_MAX)) ? (int) sys_max : MOWGLI_LINEBUF_IOV_MAX;
+#else
+		iov_max = MOWGLI_LINEBUF_IOV_MAX;
+#endif
+	}
+
+	MOWGLI_ITER_FOREACH(n, linebuf->writeq.head)
+	{
+		mowgli_linebuf_seg_t *seg = n->data;
+
+		if (seg->fd != -1)
+		{
+			off_t pos = seg->file_off + seg->off;
+
+			if (iovcnt > 0)
+				break;
+
+			return mowgli_vio_sendfile(linebuf->vio, seg->fd, &pos, seg->len - seg->off);
+		}
+
+		if (iovcnt == iov_max)
+			break;
+
+		iov[iovcnt].iov_base = seg->data + seg->off;
+		iov[iovcnt].iov_len = seg->len - seg->off;
+		iovcnt++;
+	}
+
+	return mowgli_vio_writev(linebuf->vio, iov, iovcnt);
+}
+
+/* Drop len written bytes off the front of the write queue */
+static void
+mowgli_linebuf_consume(mowgli_linebuf_t *linebuf, size_t len)
+{
+	while (len > 0)
+	{
+		mowgli_linebuf_seg_t *seg = linebuf->writeq.head->data;
+		size_t left = seg->len - seg->off;
+
+		/* files are not held in memory, so do not count against the limit */
+		if (seg->fd == -1)
+			linebuf->writebuf.buflen -= MIN(len, left);
+
+		if (len < left)
+		{
+			seg->off += len;
+			break;
+		}
+
+		len -= left;
+		mowgli_linebuf_seg_destroy(linebuf, seg);
+	}
 }
 
 static void
 mowgli_linebuf_write_data(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
 {
 	mowgli_linebuf_t *linebuf = (mowgli_linebuf_t *) userdata;
-	mowgli_linebuf_buf_t *buffer = &(linebuf->writebuf);
-	int ret;
-
-	if ((ret = mowgli_vio_write(linebuf->vio, buffer->buffer, buffer->buflen)) <= 0)
-		if (linebuf->vio->error.code != MOWGLI_VIO_ERR_NONE)
-			/* If we have a genuine error, we shouldn't come back to this func
-			 * Otherwise we'll try again. */
-			if (ret != 0)
-			{
-				mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
-				mowgli_log("mowgli_vio_write returned error [%lu]: %s", linebuf->vio->error.code, linebuf->vio->error.string);
-				return;
-			}
-
-	buffer->buflen -= ret;
+	const mowgli_vio_sockopts_t *opts = linebuf->vio->sockopts;
+	bool corked = false;
+	int ret, held;
+
+	/* With more than one segment queued, a corked socket lets everything
+	 * that can go now go in full-sized segments, instead of a short one
+	 * wherever a file and the lines around it meet.
+	 */
+	if ((opts != NULL) && opts->cork && (linebuf->writeq.head != NULL) && (linebuf->writeq.head != linebuf->writeq.tail))
+		corked = mowgli_vio_cork(linebuf->vio, true) == 0;
+
+	do
+	{
+		if ((ret = mowgli_linebuf_flush(linebuf)) < 0)
+		{
+			if (corked)
+				mowgli_vio_cork(linebuf->vio, false);
+
+			/* If we have a genuine error, we shouldn't come back to this func */
+			mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
+			mowgli_log("mowgli_vio_write returned error [%lu]: %s", linebuf->vio->error.code, linebuf->vio->error.string);
+			return;
+		}
+
+		mowgli_linebuf_consume(linebuf, ret);
+	} while (corked && (ret > 0) && (linebuf->writeq.head != NULL));
+
+	if (corked)
+		mowgli_vio_cork(linebuf->vio, false);
+
+	/* A buffering layer under us may be holding the tail back */
+	if ((held = mowgli_vio_flush(linebuf->vio)) < 0)
+	{
+		mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
+		mowgli_log("mowgli_vio_flush returned error [%lu]: %s", linebuf->vio->error.code, linebuf->vio->error.string);
+		return;
+	}
 
 	/* Anything else to write? */
-	if (buffer->buflen == 0)
+	if ((linebuf->writeq.head == NULL) && (held == 0))
 	{
 		if (!mowgli_vio_hasflag(linebuf->vio, MOWGLI_VIO_FLAGS_NEEDWRITE))
 			mowgli_pollable_setselect(eventloop, io, MOWGLI_EVENTLOOP_IO_WRITE, NULL);
@@ -234,24 +674,107 @@ mowgli_linebuf_write_data(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *
 	}
 }
 
+/* Format straight into the end of the write queue.  If the line does not
+ * fit in what is left of the last segment, format it again into a new one
+ * now that its length is known.
+ */
 void
 mowgli_linebuf_writef(mowgli_linebuf_t *linebuf, const char *format, ...)
 {
-	char buf[linebuf->writebuf.maxbuflen];
-	size_t len;
+	mowgli_linebuf_seg_t *seg = NULL;
+	size_t room = 0, need;
 	va_list va;
+	int len;
+
+	return_if_fail(linebuf != NULL);
+	return_if_fail(format != NULL);
+
+	if (linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN)
+		return;
 
+	if (linebuf->writeq.tail != NULL)
+		seg = linebuf->writeq.tail->data;
+
+	if ((seg != NULL) && (seg->msg == NULL) && (seg->fd == -1))
+		room = seg->size - seg->len;
+
+	/* Pool buffers have a spare byte past size for vsnprintf's NUL */
 	va_start(va, format);
-	len = vsnprintf(buf, linebuf->writebuf.maxbuflen - 1, format, va);
+	len = vsnprintf(room > 0 ? seg->data + seg->len : NULL, room > 0 ? room + 1 : 0, format, va);
 	va_end(va);
 
-	mowgli_linebuf_write(linebuf, buf, len);
+	return_if_fail(len > 0);
+
+	need = len + linebuf->endl_len;
+
+	/* The limit holds however much room the last segment has spare */
+	if (need > linebuf->writebuf.maxbuflen - linebuf->writebuf.buflen)
+	{
+		linebuf->flags |= MOWGLI_LINEBUF_ERR_WRITEBUF_FULL;
+		mowgli_linebuf_error(linebuf->vio);
+		return;
+	}
+
+	if (need > room)
+	{
+		seg = mowgli_linebuf_seg_create(linebuf, need);
+
+		va_start(va, format);
+		vsnprintf(seg->data, len + 1, format, va);
+		va_end(va);
+	}
+
+	memcpy(seg->data + seg->len + len, linebuf->endl, linebuf->endl_len);
+
+	seg->len += need;
+	linebuf->writebuf.buflen += need;
+
+	/* Schedule our write */
+	mowgli_pollable_setselect(linebuf->eventloop, linebuf->vio->io.e, MOWGLI_EVENTLOOP_IO_WRITE, mowgli_linebuf_write_data);
+}
+
+/* Find room for need more bytes at the end of the write queue, or raise
+ * an error if that would take it over the limit.
+ */
+static char *
+mowgli_linebuf_reserve(mowgli_linebuf_t *linebuf, size_t need)
+{
+	mowgli_linebuf_seg_t *seg = NULL;
+
+	if (need > linebuf->writebuf.maxbuflen - linebuf->writebuf.buflen)
+	{
+		linebuf->flags |= MOWGLI_LINEBUF_ERR_WRITEBUF_FULL;
+		mowgli_linebuf_error(linebuf->vio);
+		return NULL;
+	}
+
+	if (linebuf->writeq.tail != NULL)
+		seg = linebuf->writeq.tail->data;
+
+	if ((seg == NULL) || (seg->msg != NULL) || (seg->fd != -1) || (seg->size - seg->len < need))
+		seg = mowgli_linebuf_seg_create(linebuf, need);
+
+	return seg->data + seg->len;
+}
+
+/* Queue the need bytes copied in where mowgli_linebuf_reserve() said */
+static void
+mowgli_linebuf_commit(mowgli_linebuf_t *linebuf, size_t need)
+{
+	mowgli_linebuf_seg_t *seg = linebuf->writeq.tail->data;
+
+	seg->len += need;
+	linebuf->writebuf.buflen += need;
+	linebuf->write_copied += need;
+
+	/* Schedule our write */
+	mowgli_pollable_setselect(linebuf->eventloop, linebuf->vio->io.e, MOWGLI_EVENTLOOP_IO_WRITE, mowgli_linebuf_write_data);
 }
 
 void
 mowgli_linebuf_write(mowgli_linebuf_t *linebuf, const char *data, int len)
 {
-	char *ptr = linebuf->writebuf.buffer + linebuf->writebuf.buflen;
+	char *ptr;
 
 	return_if_fail(len > 0);
 	return_if_fail(data != NULL);
@@ -259,19 +782,151 @@ mowgli_linebuf_write(mowgli_linebuf_t *linebuf, const char *data, int len)
 	if (linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN)
 		return;
 
-	if (linebuf->writebuf.buflen + len + linebuf->endl_len > linebuf->writebuf.maxbuflen)
+	if ((ptr = mowgli_linebuf_reserve(linebuf, len + linebuf->endl_len)) == NULL)
+		return;
+
+	memcpy((void *) ptr, data, len);
+	memcpy((void *) (ptr + len), linebuf->endl, linebuf->endl_len);
+
+	mowgli_linebuf_commit(linebuf, len + linebuf->endl_len);
+}
+
+void
+mowgli_linebuf_write_frame(mowgli_linebuf_t *linebuf, const void *data, size_t len)
+{
+	unsigned char hdr[MOWGLI_LINEBUF_FRAME_HDR_MAX];
+	size_t hdr_len = 0, n;
+	char *ptr;
+
+	return_if_fail(linebuf != NULL);
+	return_if_fail(linebuf->framing != MOWGLI_LINEBUF_FRAMING_DELIM);
+	return_if_fail(data != NULL || len == 0);
+	return_if_fail(len <= linebuf->max_frame);
+
+	if (linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN)
+		return;
+
+	switch (linebuf->framing)
+	{
+	case MOWGLI_LINEBUF_FRAMING_BE16:
+		hdr[hdr_len++] = (len >> 8) & 0xff;
+		hdr[hdr_len++] = len & 0xff;
+		break;
+	case MOWGLI_LINEBUF_FRAMING_BE32:
+		hdr[hdr_len++] = (len >> 24) & 0xff;
+		hdr[hdr_len++] = (len >> 16) & 0xff;
+		hdr[hdr_len++] = (len >> 8) & 0xff;
+		hdr[hdr_len++] = len & 0xff;
+		break;
+	default:
+		for (n = len; n >= 0x80; n >>= 7)
+			hdr[hdr_len++] = (n & 0x7f) | 0x80;
+
+		hdr[hdr_len++] = n;
+		break;
+	}
+
+	if ((ptr = mowgli_linebuf_reserve(linebuf, hdr_len + len)) == NULL)
+		return;
+
+	memcpy(ptr, hdr, hdr_len);
+
+	if (len > 0)
+		memcpy(ptr + hdr_len, data, len);
+
+	mowgli_linebuf_commit(linebuf, hdr_len + len);
+}
+
+mowgli_linebuf_msg_t *
+mowgli_linebuf_msg_create(const char *data, size_t len, const char *endl)
+{
+	mowgli_linebuf_msg_t *msg;
+	size_t endl_len;
+
+	return_val_if_fail(data != NULL, NULL);
+	return_val_if_fail(len > 0, NULL);
+	return_val_if_fail(endl != NULL, NULL);
+
+	if (!linebuf_msg_klass_ready)
+	{
+		mowgli_object_class_init(&linebuf_msg_klass, "mowgli_linebuf_msg_t", mowgli_free, FALSE);
+		linebuf_msg_klass_ready = true;
+	}
+
+	endl_len = strlen(endl);
+
+	msg = mowgli_alloc(sizeof(*msg) + len + endl_len);
+	mowgli_object_init(mowgli_object(msg), NULL, &linebuf_msg_klass, NULL);
+
+	memcpy(msg->data, data, len);
+	memcpy(msg->data + len, endl, endl_len);
+	msg->len = len + endl_len;
+
+	return msg;
+}
+
+/* Queue a reference to msg rather than a copy of it */
+void
+mowgli_linebuf_write_shared(mowgli_linebuf_t *linebuf, mowgli_linebuf_msg_t *msg)
+{
+	mowgli_linebuf_seg_t *seg;
+
+	return_if_fail(linebuf != NULL);
+	return_if_fail(msg != NULL);
+
+	if (linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN)
+		return;
+
+	if (msg->len > linebuf->writebuf.maxbuflen - linebuf->writebuf.buflen)
 	{
 		linebuf->flags |= MOWGLI_LINEBUF_ERR_WRITEBUF_FULL;
 		mowgli_linebuf_error(linebuf->vio);
 		return;
 	}
 
-	memcpy((void *) ptr, data, len);
-	memcpy((void *) (ptr + len), linebuf->endl, linebuf->endl_len);
+	seg = mowgli_heap_alloc(linebuf_seg_heap);
+	seg->msg = mowgli_object_ref(msg);
+	seg->data = msg->data;
+	seg->size = msg->len;
+	seg->len = msg->len;
+	seg->off = 0;
+	seg->fd = -1;
 
-	linebuf->writebuf.buflen += len + linebuf->endl_len;
+	mowgli_node_add(seg, &seg->node, &linebuf->writeq);
+
+	linebuf->writebuf.buflen += msg->len;
+
+	mowgli_pollable_setselect(linebuf->eventloop, linebuf->vio->io.e, MOWGLI_EVENTLOOP_IO_WRITE, mowgli_linebuf_write_data);
+}
+
+/* Queue len bytes of fd from offset, for the VIO to send without them
+ * passing through here.  The descriptor is ours from now on.
+ */
+void
+mowgli_linebuf_write_file(mowgli_linebuf_t *linebuf, int fd, off_t offset, size_t len)
+{
+	mowgli_linebuf_seg_t *seg;
+
+	return_if_fail(linebuf != NULL);
+	return_if_fail(fd != -1);
+
+	if ((linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN) || (len == 0))
+	{
+		close(fd);
+		return;
+	}
+
+	seg = mowgli_heap_alloc(linebuf_seg_heap);
+	seg->msg = NULL;
+	seg->data = NULL;
+	seg->size = len;
+	seg->len = len;
+	seg->off = 0;
+	seg->fd = fd;
+	seg->file_off = offset;
+
+	mowgli_node_add(seg, &seg->node, &linebuf->writeq);
 
-	/* Schedule our write */
 	mowgli_pollable_setselect(linebuf->eventloop, linebuf->vio->io.e, MOWGLI_EVENTLOOP_IO_WRITE, mowgli_linebuf_write_data);
 }
 
@@ -282,34 +937,76 @@ mowgli_linebuf_shut_down(mowgli_linebuf_t *linebuf)
 
 	linebuf->flags |= MOWGLI_LINEBUF_SHUTTING_DOWN;
 
-	if (linebuf->writebuf.buflen == 0)
+	if (linebuf->writeq.head == NULL)
 		mowgli_linebuf_do_shutdown(linebuf);
 }
 
+/* Hand a complete line to the callback.  start and len are relative to
+ * the ring head; a line wrapping round the end of the ring is copied out
+ * so the callback always sees it contiguous.
+ */
 static void
+mowgli_linebuf_deliver(mowgli_linebuf_t *linebuf, size_t start, size_t len)
+{
+	mowgli_linebuf_buf_t *buffer = &(linebuf->readbuf);
+	size_t pos = (buffer->head + start) % buffer->bufsize;
+	char *line;
+
+	if (pos + len <= buffer->bufsize)
+	{
+		line = buffer->buffer + pos;
+
+		/* Frames are binary, and the byte after one is the next's prefix */
+		if (linebuf->return_normal_strings && (linebuf->framing == MOWGLI_LINEBUF_FRAMING_DELIM))
+			line[len] = '\0';
+
+		linebuf->readline_cb(linebuf, line, len, linebuf->userdata);
+		return;
+	}
+
+	line = mowgli_alloc(len + 1);
+	memcpy(line, buffer->buffer + pos, buffer->bufsize - pos);
+	memcpy(line + buffer->bufsize - pos, buffer->buffer, len - (buffer->bufsize - pos));
+	linebuf->read_copied += len;
+
+	linebuf->readline_cb(linebuf, line, len, linebuf->userdata);
+
+	mowgli_free(line);
+}
+
+/* Returns the number of lines found */
+static size_t
 mowgli_linebuf_process(mowgli_linebuf_t *linebuf)
 {
 	mowgli_linebuf_buf_t *buffer = &(linebuf->readbuf);
 
-	char *line_start;
-	char *cptr;
+	size_t line_start = 0;
 	size_t len = 0;
-	int linecount = 0;
+	size_t linecount = 0;
 
-	line_start = cptr = buffer->buffer;
+	if (linebuf->framing != MOWGLI_LINEBUF_FRAMING_DELIM)
+		return mowgli_linebuf_process_frames(linebuf);
 
 	/* Initalise */
 	linebuf->flags &= ~MOWGLI_LINEBUF_LINE_HASNULLCHAR;
 
 	while (len < buffer->buflen)
 	{
-		if (!strchr(linebuf->delim, *cptr))
+		size_t pos = (buffer->head + len) % buffer->bufsize;
+		size_t seglen = MIN(buffer->buflen - len, buffer->bufsize - pos);
+		size_t span = mowgli_linebuf_scan(linebuf, buffer->buffer + pos, seglen);
+
+		len += span;
+
+		/* Ran off the end of the data, or of the ring before it wraps */
+		if (span == seglen)
+			continue;
+
+		if (buffer->buffer[pos + span] == '\0')
 		{
-			if (*cptr == '\0')
-				/* Warn about unexpected null chars in the string */
-				linebuf->flags |= MOWGLI_LINEBUF_LINE_HASNULLCHAR;
+			/* Warn about unexpected null chars in the string */
+			linebuf->flags |= MOWGLI_LINEBUF_LINE_HASNULLCHAR;
 
-			cptr++;
 			len++;
 			continue;
 		}
@@ -317,20 +1014,16 @@ mowgli_linebuf_process(mowgli_linebuf_t *linebuf)
 		linecount++;
 
 		/* We now have a line */
-		if (linebuf->return_normal_strings)
-			*cptr = '\0';
-
 		if ((linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN) == 0)
-			linebuf->readline_cb(linebuf, line_start, cptr - line_start, linebuf->userdata);
+			mowgli_linebuf_deliver(linebuf, line_start, len - line_start);
 
-		/* Next line starts here; begin scanning and set the start of it */
-		while (strchr(linebuf->delim, *cptr))
-		{
+		/* Next line starts past this run of delimiters */
+		do
 			len++;
-			cptr++;
-		}
+		while (len < buffer->buflen &&
+		       mowgli_linebuf_is_delim(linebuf, buffer->buffer[(buffer->head + len) % buffer->bufsize]));
 
-		line_start = cptr;
+		line_start = len;
 
 		/* Reset this for next line */
 		linebuf->flags &= ~MOWGLI_LINEBUF_LINE_HASNULLCHAR;
@@ -342,18 +1035,127 @@ mowgli_linebuf_process(mowgli_linebuf_t *linebuf)
 		 * We're really screwed, let's trigger an error. */
 		linebuf->flags |= MOWGLI_LINEBUF_ERR_READBUF_FULL;
 		mowgli_linebuf_error(linebuf->vio);
-		return;
+		return 0;
 	}
 
-	if (line_start != cptr)
+	/* Drop the lines we handed out; a partial line stays where it is */
+	buffer->buflen -= line_start;
+	buffer->head = (buffer->buflen == 0) ? 0 : (buffer->head + line_start) % buffer->bufsize;
+
+	return linecount;
+}
+
+static inline unsigned char
+mowgli_linebuf_ring_byte(mowgli_linebuf_buf_t *buffer, size_t off)
+{
+	return buffer->buffer[(buffer->head + off) % buffer->bufsize];
+}
+
+/* Decode the length prefix off bytes into the read ring.  Returns its size,
+ * 0 if it is not all there yet, or -1 if it is malformed.
+ */
+static int
+mowgli_linebuf_frame_header(mowgli_linebuf_t *linebuf, size_t off, uint64_t *len)
+{
+	mowgli_linebuf_buf_t *buffer = &(linebuf->readbuf);
+	size_t avail = buffer->buflen - off;
+	int i, width = 4;
+
+	*len = 0;
+
+	switch (linebuf->framing)
 	{
-		buffer->buflen = cptr - line_start;
-		memmove(buffer->buffer, line_start, cptr - line_start);
+	case MOWGLI_LINEBUF_FRAMING_BE16:
+		width = 2;
+
+		/* FALLTHROUGH */
+	case MOWGLI_LINEBUF_FRAMING_BE32:
+		if (avail < (size_t) width)
+			return 0;
+
+		for (i = 0; i < width; i++)
+			*len = (*len << 8) | mowgli_linebuf_ring_byte(buffer, off + i);
+
+		return width;
+	default:
+		for (i = 0; i < MOWGLI_LINEBUF_FRAME_HDR_MAX; i++)
+		{
+			unsigned char c;
+
+			if ((size_t) i == avail)
+				return 0;
+
+			c = mowgli_linebuf_ring_byte(buffer, off + i);
+			*len |= (uint64_t) (c & 0x7f) << (7 * i);
+
+			if ((c & 0x80) == 0)
+				return i + 1;
+		}
+
+		return -1;
 	}
-	else
+}
+
+static size_t
+mowgli_linebuf_process_frames(mowgli_linebuf_t *linebuf)
+{
+	mowgli_linebuf_buf_t *buffer = &(linebuf->readbuf);
+	size_t off = 0, want = 0, count = 0;
+	uint64_t len;
+	int hdr;
+
+	while (off < buffer->buflen)
+	{
+		if ((hdr = mowgli_linebuf_frame_header(linebuf, off, &len)) == 0)
+			break;
+
+		if ((hdr < 0) || (len > linebuf->max_frame))
+		{
+			/* There is no finding the next frame after this */
+			linebuf->flags |= MOWGLI_LINEBUF_ERR_BAD_FRAME;
+			mowgli_linebuf_error(linebuf->vio);
+			return count;
+		}
+
+		if (buffer->buflen - off - hdr < len)
+		{
+			want = hdr + len;
+			break;
+		}
+
+		if ((linebuf->flags & MOWGLI_LINEBUF_SHUTTING_DOWN) == 0)
+			mowgli_linebuf_deliver(linebuf, off + hdr, len);
+
+		off += hdr + len;
+		count++;
+	}
+
+	buffer->buflen -= off;
+	buffer->head = (buffer->buflen == 0) ? 0 : (buffer->head + off) % buffer->bufsize;
+
+	/* Make room for all of a frame we have the start of */
+	if ((want > buffer->bufsize) && !mowgli_linebuf_grow(linebuf, buffer, want))
 	{
-		buffer->buflen = 0;
+		linebuf->flags |= MOWGLI_LINEBUF_ERR_READBUF_FULL;
+		mowgli_linebuf_error(linebuf->vio);
+		return count;
+	}
+
+	/* If the rest of it would wrap round the ring, moving the start of it
+	 * back to the beginning now is cheaper than copying all of it out.
+	 */
+	if ((want > 0) && (buffer->head + want > buffer->bufsize))
+	{
+		if (buffer->head + buffer->buflen <= buffer->bufsize)
+			memmove(buffer->buffer, buffer->buffer + buffer->head, buffer->buflen);
+		else
+			mowgli_linebuf_resize(buffer, buffer->bufsize);
+
+		buffer->head = 0;
+		linebuf->read_copied += buffer->buflen;
 	}
+
+	return count;
 }
 
 static void
@@ -369,7 +1171,13 @@ mowgli_linebuf_error(mowgli_vio_t *vio)
 	mowgli_linebuf_t *linebuf = vio->userdata;
 	mowgli_vio_error_t *error = &(linebuf->vio->error);
 
-	if (linebuf->flags & MOWGLI_LINEBUF_ERR_READBUF_FULL)
+	if (linebuf->flags & MOWGLI_LINEBUF_ERR_BAD_FRAME)
+	{
+		error->op = MOWGLI_VIO_ERR_OP_READ;
+		error->type = MOWGLI_VIO_ERR_CUSTOM;
+		mowgli_strlcpy(error->string, "Bad frame length", sizeof(error->string));
+	}
+	else if (linebuf->flags & MOWGLI_LINEBUF_ERR_READBUF_FULL)
 	{
 		error->op = MOWGLI_VIO_ERR_OP_READ;
 		error->type = MOWGLI_VIO_ERR_CUSTOM;
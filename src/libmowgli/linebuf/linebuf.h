@@ -22,11 +22,24 @@
 #define MOWGLI_SRC_LIBMOWGLI_LINEBUF_LINEBUF_H_INCLUDE_GUARD 1
 
 #include "eventloop/eventloop.h"
+#include "object/object.h"
 #include "platform/attributes.h"
 #include "vio/vio.h"
 
 typedef struct _mowgli_linebuf_buf mowgli_linebuf_buf_t;
 
+/* How the input is split up.  Besides delimited lines, a linebuf can carry
+ * binary frames, each preceded by its length: big-endian 16 or 32 bits, or
+ * a little-endian base 128 varint of up to 5 bytes (as in protobuf).
+ */
+typedef enum
+{
+	MOWGLI_LINEBUF_FRAMING_DELIM = 0,
+	MOWGLI_LINEBUF_FRAMING_BE16,
+	MOWGLI_LINEBUF_FRAMING_BE32,
+	MOWGLI_LINEBUF_FRAMING_VARINT,
+} mowgli_linebuf_framing_t;
+
 typedef void mowgli_linebuf_readline_cb_t (mowgli_linebuf_t *, char *, size_t, void *);
 typedef void mowgli_linebuf_shutdown_cb_t (mowgli_linebuf_t *, void *);
 
@@ -38,6 +51,14 @@ extern void mowgli_linebuf_detach_from_eventloop(mowgli_linebuf_t *linebuf);
 extern void mowgli_linebuf_destroy(mowgli_linebuf_t *linebuf);
 
 extern void mowgli_linebuf_setbuflen(mowgli_linebuf_buf_t *buffer, size_t buflen);
+
+/* Most a linebuf reads for one readiness event, in bytes and in lines (or
+ * frames), before leaving the rest to the next round so other connections
+ * get a look in.  0 is no limit.  Input the VIO holds beyond the socket
+ * (mowgli_vio_pending()) is read regardless, as nothing would wake the
+ * linebuf for it.
+ */
+extern void mowgli_linebuf_set_read_budget(mowgli_linebuf_t *linebuf, size_t bytes, size_t lines);
 extern void mowgli_linebuf_delim(mowgli_linebuf_t *linebuf, const char *delim, const char *endl);
 extern void mowgli_linebuf_write(mowgli_linebuf_t *linebuf, const char *data, int len);
 
@@ -46,21 +67,107 @@ extern void mowgli_linebuf_writef(mowgli_linebuf_t *linebuf, const char *format,
 
 extern void mowgli_linebuf_shut_down(mowgli_linebuf_t *linebuf);
 
+/* Frames go to the readline callback like lines do, but are never NUL
+ * terminated.  max_frame is the longest payload accepted; the read buffer
+ * limit is raised to fit one if need be.
+ */
+extern void mowgli_linebuf_framing(mowgli_linebuf_t *linebuf, mowgli_linebuf_framing_t framing, size_t max_frame);
+extern void mowgli_linebuf_write_frame(mowgli_linebuf_t *linebuf, const void *data, size_t len);
+
+/* An immutable line which any number of write queues can hold a reference
+ * to, for sending the same thing to many linebufs without copying it into
+ * each.  It carries its own line ending.  Queueing it takes a reference;
+ * drop the one from mowgli_linebuf_msg_create() with mowgli_object_unref()
+ * once it has been handed out.  The refcount is not atomic, so keep a
+ * message to one thread.
+ */
+typedef struct
+{
+	mowgli_object_t parent;
+	size_t len;
+	char data[];
+} mowgli_linebuf_msg_t;
+
+extern mowgli_linebuf_msg_t *mowgli_linebuf_msg_create(const char *data, size_t len, const char *endl);
+extern void mowgli_linebuf_write_shared(mowgli_linebuf_t *linebuf, mowgli_linebuf_msg_t *msg);
+
+/* Queue len bytes of the file fd from offset, to go out with
+ * mowgli_vio_sendfile(): straight from the page cache on a plain socket.
+ * The linebuf takes the descriptor over and closes it once sent or when
+ * destroyed.  Files are not held in memory, so they do not count against
+ * the write buffer limit.  fd should be a regular file; the bytes must be
+ * there by the time they are sent.
+ */
+extern void mowgli_linebuf_write_file(mowgli_linebuf_t *linebuf, int fd, off_t offset, size_t len);
+
+/* pool.c: buffers shared between all linebufs */
+typedef struct
+{
+	size_t in_use;	/* bytes lent out */
+	size_t cached;	/* bytes on the free lists */
+} mowgli_linebuf_pool_stats_t;
+
+extern char *mowgli_linebuf_pool_alloc(size_t size);
+extern void mowgli_linebuf_pool_free(char *buffer, size_t size);
+extern void mowgli_linebuf_pool_get_stats(mowgli_linebuf_pool_stats_t *stats);
+
+/* scan.c: length of the leading run of data holding no delimiter or NUL */
+extern size_t mowgli_linebuf_scan(const mowgli_linebuf_t *linebuf, const char *data, size_t len);
+extern const char *mowgli_linebuf_scan_impl(void);
+
+/* Buffers are borrowed from the shared pool while there is data in them
+ * and handed back as soon as they are empty.  bufsize starts at
+ * MOWGLI_LINEBUF_MIN_BUFLEN and doubles as needed up to maxbuflen (set
+ * with mowgli_linebuf_setbuflen); it is kept while the buffer is away so
+ * the next one is borrowed at the same size.  The read buffer is a ring:
+ * buflen bytes starting at head, wrapping at bufsize.
+ *
+ * Output is queued as a chain of segments in writeq instead, so the write
+ * buffer only uses buflen, the bytes queued in memory (queued files are
+ * not counted), and maxbuflen, the most that may be.
+ */
 struct _mowgli_linebuf_buf
 {
 	char *buffer;
 	size_t buflen;
 	size_t maxbuflen;
+	size_t head;
+	size_t bufsize;
 };
 
+#define MOWGLI_LINEBUF_MIN_BUFLEN 1024
+
+/* Write queue segments grow with the queue up to this size */
+#define MOWGLI_LINEBUF_SEG_MAX 16384
+
+/* Most segments handed to mowgli_vio_writev() at once, or the system's
+ * IOV_MAX if that is lower.
+ */
+#define MOWGLI_LINEBUF_IOV_MAX 1024
+
+/* Bytes of free buffers the pool keeps per size */
+#define MOWGLI_LINEBUF_POOL_CACHE (1024 * 1024)
+
+/* Default byte budget for mowgli_linebuf_set_read_budget() */
+#define MOWGLI_LINEBUF_READ_BUDGET (256 * 1024)
+
+/* Seconds a linebuf has to go without filling its buffers before grown
+ * ones are shrunk back.
+ */
+#define MOWGLI_LINEBUF_SHRINK_INTERVAL 10
+
 /* Errors */
 #define MOWGLI_LINEBUF_ERR_NONE 0x0000
 #define MOWGLI_LINEBUF_ERR_READBUF_FULL 0x0001
 #define MOWGLI_LINEBUF_ERR_WRITEBUF_FULL 0x0002
+#define MOWGLI_LINEBUF_ERR_BAD_FRAME 0x0008
 
 /* Informative */
 #define MOWGLI_LINEBUF_LINE_HASNULLCHAR 0x0004
 
+/* Delimiters beyond this many are only matched by the scalar scanner */
+#define MOWGLI_LINEBUF_DELIM_MAX 8
+
 /* State */
 #define MOWGLI_LINEBUF_SHUTTING_DOWN 0x0100
 
@@ -75,15 +182,41 @@ struct _mowgli_linebuf
 	const char *endl;
 	size_t endl_len;
 
+	/* The delimiter set as computed by mowgli_linebuf_delim(): a bitmap
+	 * covering the delimiters and NUL, and the delimiters themselves for
+	 * the vector scanners (delim_count is 0 if there are too many).
+	 */
+	uint32_t delim_map[8];
+	unsigned char delim_chars[MOWGLI_LINEBUF_DELIM_MAX];
+	size_t delim_count;
+
 	int flags;
 
+	mowgli_linebuf_framing_t framing;
+	size_t max_frame;
+
 	mowgli_linebuf_buf_t readbuf;
 	mowgli_linebuf_buf_t writebuf;
+	size_t read_budget;
+	size_t read_line_budget;
+	mowgli_list_t writeq;
 
 	mowgli_eventloop_t *eventloop;
+	mowgli_eventloop_timer_t *shrink_timer;
+	bool busy;	/* a buffer filled up since the last shrink check */
 
 	bool return_normal_strings;
 
+	/* Bytes of input copied to hand lines that wrap the read ring over,
+	 * and of output copied into the write queue.
+	 */
+	uint64_t read_copied;
+	uint64_t write_copied;
+
+	/* Readiness events handled, and VIO reads done for them */
+	uint64_t read_events;
+	uint64_t read_calls;
+
 	void *userdata;
 };
 
@@ -0,0 +1,140 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * pool.c: Shared buffer pool for line buffers
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+#include "core/bootstrap_internal.h"
+
+/* Linebufs only hold buffers while they have data pending, so the same
+ * few buffers get passed around between connections.  Sizes are powers of
+ * two from MOWGLI_LINEBUF_MIN_BUFLEN up; each class keeps a free list of
+ * up to MOWGLI_LINEBUF_POOL_CACHE bytes.  Anything else goes straight to
+ * the allocator.  Every buffer has the spare terminator byte linebuf
+ * wants, so a class of n bytes hands out n + 1.
+ */
+#define MOWGLI_LINEBUF_POOL_CLASSES 7	/* 1 KiB .. 64 KiB */
+
+typedef struct _mowgli_linebuf_pool_free
+{
+	struct _mowgli_linebuf_pool_free *next;
+} mowgli_linebuf_pool_free_t;
+
+static struct
+{
+	mowgli_linebuf_pool_free_t *free;
+	size_t nfree;
+} pool_class[MOWGLI_LINEBUF_POOL_CLASSES];
+
+static mowgli_mutex_t pool_mutex;
+static size_t pool_in_use = 0;
+static size_t pool_cached = 0;
+
+static int
+mowgli_linebuf_pool_class(size_t size)
+{
+	size_t s = MOWGLI_LINEBUF_MIN_BUFLEN;
+	int i;
+
+	for (i = 0; i < MOWGLI_LINEBUF_POOL_CLASSES; i++, s *= 2)
+		if (s == size)
+			return i;
+
+	return -1;
+}
+
+/* at load time, before anything could be racing to use the pool */
+void
+mowgli_linebuf_pool_bootstrap(void)
+{
+	mowgli_mutex_init(&pool_mutex);
+}
+
+char *
+mowgli_linebuf_pool_alloc(size_t size)
+{
+	mowgli_linebuf_pool_free_t *buf = NULL;
+	int c;
+
+	return_val_if_fail(size > 0, NULL);
+
+	c = mowgli_linebuf_pool_class(size);
+
+	mowgli_mutex_lock(&pool_mutex);
+
+	if ((c >= 0) && ((buf = pool_class[c].free) != NULL))
+	{
+		pool_class[c].free = buf->next;
+		pool_class[c].nfree--;
+		pool_cached -= size;
+	}
+
+	pool_in_use += size;
+
+	mowgli_mutex_unlock(&pool_mutex);
+
+	if (buf == NULL)
+		buf = mowgli_alloc(size + 1);
+
+	return (char *) buf;
+}
+
+void
+mowgli_linebuf_pool_free(char *buffer, size_t size)
+{
+	mowgli_linebuf_pool_free_t *buf = (mowgli_linebuf_pool_free_t *) buffer;
+	int c;
+
+	return_if_fail(buffer != NULL);
+
+	c = mowgli_linebuf_pool_class(size);
+
+	mowgli_mutex_lock(&pool_mutex);
+
+	pool_in_use -= size;
+
+	if ((c >= 0) && ((pool_class[c].nfree + 1) * size <= MOWGLI_LINEBUF_POOL_CACHE))
+	{
+		buf->next = pool_class[c].free;
+		pool_class[c].free = buf;
+		pool_class[c].nfree++;
+		pool_cached += size;
+		buf = NULL;
+	}
+
+	mowgli_mutex_unlock(&pool_mutex);
+
+	if (buf != NULL)
+		mowgli_free(buf);
+}
+
+void
+mowgli_linebuf_pool_get_stats(mowgli_linebuf_pool_stats_t *stats)
+{
+	return_if_fail(stats != NULL);
+
+	mowgli_mutex_lock(&pool_mutex);
+
+	stats->in_use = pool_in_use;
+	stats->cached = pool_cached;
+
+	mowgli_mutex_unlock(&pool_mutex);
+}
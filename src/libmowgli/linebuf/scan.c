@@ -0,0 +1,161 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * scan.c: Delimiter scanning for the line buffer
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* The vector scanners compare a block of input against every delimiter and
+ * NUL at once and stop at the first block with a hit.  x86 only for now:
+ * SSE2 is part of the x86-64 baseline, AVX2 is picked at runtime.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define MOWGLI_LINEBUF_SCAN_X86 1
+# include <immintrin.h>
+#endif
+
+typedef size_t mowgli_linebuf_scan_fn_t (const mowgli_linebuf_t *linebuf, const char *data, size_t len);
+
+static size_t
+mowgli_linebuf_scan_scalar(const mowgli_linebuf_t *linebuf, const char *data, size_t len)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		if (linebuf->delim_map[p[i] >> 5] & (1U << (p[i] & 31)))
+			break;
+
+	return i;
+}
+
+#ifdef MOWGLI_LINEBUF_SCAN_X86
+
+static size_t __attribute__((target("sse2")))
+mowgli_linebuf_scan_sse2(const mowgli_linebuf_t *linebuf, const char *data, size_t len)
+{
+	__m128i needle[MOWGLI_LINEBUF_DELIM_MAX];
+	const __m128i zero = _mm_setzero_si128();
+	size_t i, j, n = linebuf->delim_count;
+
+	if (n == 0)
+		return mowgli_linebuf_scan_scalar(linebuf, data, len);
+
+	for (j = 0; j < n; j++)
+		needle[j] = _mm_set1_epi8((char) linebuf->delim_chars[j]);
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		__m128i hit = _mm_cmpeq_epi8(v, zero);
+		int mask;
+
+		for (j = 0; j < n; j++)
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, needle[j]));
+
+		if ((mask = _mm_movemask_epi8(hit)) != 0)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + mowgli_linebuf_scan_scalar(linebuf, data + i, len - i);
+}
+
+static size_t __attribute__((target("avx2")))
+mowgli_linebuf_scan_avx2(const mowgli_linebuf_t *linebuf, const char *data, size_t len)
+{
+	__m256i needle[MOWGLI_LINEBUF_DELIM_MAX];
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i, j, n = linebuf->delim_count;
+
+	if (n == 0)
+		return mowgli_linebuf_scan_scalar(linebuf, data, len);
+
+	for (j = 0; j < n; j++)
+		needle[j] = _mm256_set1_epi8((char) linebuf->delim_chars[j]);
+
+	for (i = 0; i + 32 <= len; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *) (data + i));
+		__m256i hit = _mm256_cmpeq_epi8(v, zero);
+		unsigned int mask;
+
+		for (j = 0; j < n; j++)
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, needle[j]));
+
+		if ((mask = (unsigned int) _mm256_movemask_epi8(hit)) != 0)
+			return i + __builtin_ctz(mask);
+	}
+
+	/* finish the tail 16 bytes at a time */
+	return i + mowgli_linebuf_scan_sse2(linebuf, data + i, len - i);
+}
+
+#endif
+
+static mowgli_linebuf_scan_fn_t *scan_fn = NULL;
+static const char *scan_impl = NULL;
+
+static void
+mowgli_linebuf_scan_init(void)
+{
+	mowgli_linebuf_scan_fn_t *fn = mowgli_linebuf_scan_scalar;
+	const char *impl = "scalar";
+
+#ifdef MOWGLI_LINEBUF_SCAN_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+	{
+		fn = mowgli_linebuf_scan_avx2;
+		impl = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		fn = mowgli_linebuf_scan_sse2;
+		impl = "sse2";
+	}
+#endif
+
+	/* racing initialisations all pick the same answer */
+	scan_impl = impl;
+	scan_fn = fn;
+}
+
+size_t
+mowgli_linebuf_scan(const mowgli_linebuf_t *linebuf, const char *data, size_t len)
+{
+	return_val_if_fail(linebuf != NULL, 0);
+	return_val_if_fail(data != NULL || len == 0, 0);
+
+	if (scan_fn == NULL)
+		mowgli_linebuf_scan_init();
+
+	return scan_fn(linebuf, data, len);
+}
+
+const char *
+mowgli_linebuf_scan_impl(void)
+{
+	if (scan_fn == NULL)
+		mowgli_linebuf_scan_init();
+
+	return scan_impl;
+}
@@ -77,8 +77,11 @@ extern "C" {
 #include "platform/cacheline.h"
 #include "platform/constructor.h"
 #include "platform/machine.h"
+#include "thread/cond.h"
 #include "thread/mutex.h"
+#include "thread/scheduler.h"
 #include "thread/thread.h"
+#include "thread/workqueue.h"
 #include "vio/vio.h"
 
 #ifdef __cplusplus
@@ -42,6 +42,13 @@ extern int fork(void);
 extern int inet_pton(int af, const char *src, void *dst);
 extern const char *inet_ntop(int af, const void *addr, char *host, size_t hostlen);
 
+/* For the vectored VIO ops, which loop over it since there is no writev() */
+struct iovec
+{
+	void *iov_base;
+	size_t iov_len;
+};
+
 /* MSYS autoconf is fucko. */
 #  ifndef HAVE_WINSOCK2_H
 #    define HAVE_WINSOCK2_H
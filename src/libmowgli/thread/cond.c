@@ -0,0 +1,194 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * cond.c: Cross-platform condition variables.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* condition variables operate on the platform mutex directly, so they need
+ * the default threading policy.
+ */
+
+mowgli_cond_t *
+mowgli_cond_create(void)
+{
+	mowgli_cond_t *cond = mowgli_alloc(sizeof *cond);
+
+	if (mowgli_cond_init(cond) == 0)
+		return cond;
+
+	mowgli_free(cond);
+	return NULL;
+}
+
+void
+mowgli_cond_destroy(mowgli_cond_t *cond)
+{
+	return_if_fail(cond != NULL);
+
+	mowgli_cond_uninit(cond);
+	mowgli_free(cond);
+}
+
+#if defined(_WIN32)
+
+int
+mowgli_cond_init(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	cond->waiters = 0;
+	cond->sem = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+
+	if (cond->sem == NULL)
+		return GetLastError();
+
+	return 0;
+}
+
+int
+mowgli_cond_timedwait(mowgli_cond_t *cond, mowgli_mutex_t *mutex, unsigned int msec)
+{
+	DWORD ret;
+
+	return_val_if_fail(cond != NULL, -1);
+	return_val_if_fail(mutex != NULL, -1);
+
+	InterlockedIncrement(&cond->waiters);
+	mowgli_mutex_unlock(mutex);
+
+	ret = WaitForSingleObject(cond->sem, msec);
+
+	/* a release which raced with the timeout is absorbed by the next
+	 * waiter, which then merely wakes up early.
+	 */
+	InterlockedDecrement(&cond->waiters);
+	mowgli_mutex_lock(mutex);
+
+	return ret == WAIT_OBJECT_0 ? 0 : ETIMEDOUT;
+}
+
+int
+mowgli_cond_wait(mowgli_cond_t *cond, mowgli_mutex_t *mutex)
+{
+	return mowgli_cond_timedwait(cond, mutex, INFINITE);
+}
+
+int
+mowgli_cond_signal(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	if (cond->waiters > 0)
+		ReleaseSemaphore(cond->sem, 1, NULL);
+
+	return 0;
+}
+
+int
+mowgli_cond_broadcast(mowgli_cond_t *cond)
+{
+	LONG waiters;
+
+	return_val_if_fail(cond != NULL, -1);
+
+	if ((waiters = cond->waiters) > 0)
+		ReleaseSemaphore(cond->sem, waiters, NULL);
+
+	return 0;
+}
+
+int
+mowgli_cond_uninit(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	CloseHandle(cond->sem);
+	return 0;
+}
+
+#elif !defined(MOWGLI_FEATURE_HAVE_NATIVE_MUTEXES)
+
+int
+mowgli_cond_init(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	return pthread_cond_init(&cond->cond, NULL);
+}
+
+int
+mowgli_cond_wait(mowgli_cond_t *cond, mowgli_mutex_t *mutex)
+{
+	return_val_if_fail(cond != NULL, -1);
+	return_val_if_fail(mutex != NULL, -1);
+
+	return pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+int
+mowgli_cond_timedwait(mowgli_cond_t *cond, mowgli_mutex_t *mutex, unsigned int msec)
+{
+	struct timeval now;
+	struct timespec ts;
+
+	return_val_if_fail(cond != NULL, -1);
+	return_val_if_fail(mutex != NULL, -1);
+
+	gettimeofday(&now, NULL);
+
+	ts.tv_sec = now.tv_sec + msec / 1000;
+	ts.tv_nsec = now.tv_usec * 1000 + (long) (msec % 1000) * 1000000;
+
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	return pthread_cond_timedwait(&cond->cond, &mutex->mutex, &ts);
+}
+
+int
+mowgli_cond_signal(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	return pthread_cond_signal(&cond->cond);
+}
+
+int
+mowgli_cond_broadcast(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	return pthread_cond_broadcast(&cond->cond);
+}
+
+int
+mowgli_cond_uninit(mowgli_cond_t *cond)
+{
+	return_val_if_fail(cond != NULL, -1);
+
+	return pthread_cond_destroy(&cond->cond);
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * cond.h: Cross-platform condition variables.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOWGLI_SRC_LIBMOWGLI_THREAD_COND_H_INCLUDE_GUARD
+#define MOWGLI_SRC_LIBMOWGLI_THREAD_COND_H_INCLUDE_GUARD 1
+
+#include "platform/attributes.h"
+#include "thread/mutex.h"
+
+typedef struct mowgli_cond_ mowgli_cond_t;
+
+struct mowgli_cond_
+{
+#if defined MOWGLI_OS_WIN
+	/* waiters park on the semaphore, which is released once per waiter
+	 * to be woken.
+	 */
+	HANDLE sem;
+	volatile LONG waiters;
+#elif !defined MOWGLI_FEATURE_HAVE_NATIVE_MUTEXES
+	pthread_cond_t cond;
+#else
+	int unused;
+#endif
+};
+
+mowgli_cond_t *mowgli_cond_create(void)
+    MOWGLI_FATTR_MALLOC;
+
+int mowgli_cond_init(mowgli_cond_t *cond);
+int mowgli_cond_wait(mowgli_cond_t *cond, mowgli_mutex_t *mutex);
+int mowgli_cond_timedwait(mowgli_cond_t *cond, mowgli_mutex_t *mutex, unsigned int msec);
+int mowgli_cond_signal(mowgli_cond_t *cond);
+int mowgli_cond_broadcast(mowgli_cond_t *cond);
+int mowgli_cond_uninit(mowgli_cond_t *cond);
+void mowgli_cond_destroy(mowgli_cond_t *cond);
+
+#endif /* MOWGLI_SRC_LIBMOWGLI_THREAD_COND_H_INCLUDE_GUARD */
@@ -27,12 +27,8 @@
 #include "platform/attributes.h"
 #include "thread/thread.h"
 
-#ifdef MOWGLI_OS_UNIX_TYPE
-#  include <thread.h>
-#  include <synch.h>
-#  define MOWGLI_FEATURE_HAVE_NATIVE_MUTEXES
-#  define MOWGLI_NATIVE_MUTEX_DECL(name) mutex_t(name)
-#elif defined MOWGLI_OS_WIN
+/* as with threads, everything but Windows goes through pthreads */
+#if defined MOWGLI_OS_WIN
 #  define MOWGLI_FEATURE_HAVE_NATIVE_MUTEXES
 #  define MOWGLI_NATIVE_MUTEX_DECL(name) HANDLE(name)
 #else
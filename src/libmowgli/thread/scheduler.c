@@ -0,0 +1,694 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * scheduler.c: Work-stealing task scheduler.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* Every worker owns a Chase-Lev deque: it pushes and pops tasks at the
+ * bottom without locking, idle workers steal from the top of a randomly
+ * chosen victim.  The deque follows "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli, PPoPP 2013).
+ *
+ * Threads which are not workers of the scheduler (usually whoever created
+ * it) share one extra deque, serialised by external_lock.  Waiting on a task
+ * group never blocks: the waiter runs queued tasks until the group is done,
+ * which is what keeps nested groups from deadlocking.
+ */
+
+#if defined(__GNUC__)
+
+#ifndef _WIN32
+# include <sched.h>
+#endif
+
+#define LOAD(p, order) __atomic_load_n((p), (order))
+#define STORE(p, v, order) __atomic_store_n((p), (v), (order))
+#define CAS(p, expected, v) __atomic_compare_exchange_n((p), (expected), (v), false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)
+
+/* idle rounds a worker spins through before going to sleep */
+#define MOWGLI_SCHEDULER_SPINS 64
+
+/* finished tasks each worker keeps around for reuse */
+#define MOWGLI_SCHEDULER_MAX_CACHED 256
+
+typedef struct _mowgli_task mowgli_task_t;
+
+struct _mowgli_task
+{
+	mowgli_task_fn_t *fn;
+	void *arg;
+	mowgli_task_group_t *group;
+	mowgli_task_t *next;
+};
+
+typedef struct _mowgli_deque_array mowgli_deque_array_t;
+
+struct _mowgli_deque_array
+{
+	int64_t size;
+	mowgli_deque_array_t *prev;
+	mowgli_task_t *buf[];
+};
+
+typedef struct
+{
+	int64_t top;
+	char pad0[64 - sizeof(int64_t)];
+
+	int64_t bottom;
+	char pad1[64 - sizeof(int64_t)];
+
+	mowgli_deque_array_t *array;
+} mowgli_deque_t;
+
+typedef struct
+{
+	mowgli_scheduler_t *scheduler;
+	unsigned int index;
+	mowgli_thread_t thread;
+
+	mowgli_deque_t deque;
+
+	uint32_t rng;
+	mowgli_task_t *cache;
+	unsigned int ncached;
+} mowgli_scheduler_worker_t;
+
+struct _mowgli_scheduler
+{
+	unsigned int nthreads;
+
+	/* nthreads workers, then the deque shared by external threads */
+	mowgli_scheduler_worker_t *workers;
+	mowgli_mutex_t external_lock;
+
+	mowgli_mutex_t sleep_lock;
+	mowgli_cond_t sleep_cond;
+	int sleepers;
+
+	bool shutdown;
+};
+
+static __thread mowgli_scheduler_worker_t *current_worker = NULL;
+static __thread uint32_t external_rng = 0;
+
+static void
+mowgli_deque_init(mowgli_deque_t *deque)
+{
+	deque->top = deque->bottom = 0;
+	deque->array = mowgli_alloc(sizeof(mowgli_deque_array_t) + 64 * sizeof(mowgli_task_t *));
+	deque->array->size = 64;
+}
+
+static void
+mowgli_deque_fini(mowgli_deque_t *deque)
+{
+	mowgli_deque_array_t *a, *prev;
+
+	for (a = deque->array; a != NULL; a = prev)
+	{
+		prev = a->prev;
+		mowgli_free(a);
+	}
+}
+
+/* thieves may still be reading the old array, so it is kept until the
+ * scheduler goes away.
+ */
+static mowgli_deque_array_t *
+mowgli_deque_grow(mowgli_deque_t *deque, mowgli_deque_array_t *a, int64_t top, int64_t bottom)
+{
+	mowgli_deque_array_t *na = mowgli_alloc(sizeof(mowgli_deque_array_t) + 2 * a->size * sizeof(mowgli_task_t *));
+	int64_t i;
+
+	na->size = 2 * a->size;
+	na->prev = a;
+
+	for (i = top; i < bottom; i++)
+		na->buf[i & (na->size - 1)] = a->buf[i & (a->size - 1)];
+
+	STORE(&deque->array, na, __ATOMIC_RELEASE);
+
+	return na;
+}
+
+static void
+mowgli_deque_push(mowgli_deque_t *deque, mowgli_task_t *task)
+{
+	int64_t b = LOAD(&deque->bottom, __ATOMIC_RELAXED);
+	int64_t t = LOAD(&deque->top, __ATOMIC_ACQUIRE);
+	mowgli_deque_array_t *a = LOAD(&deque->array, __ATOMIC_RELAXED);
+
+	if (b - t > a->size - 1)
+		a = mowgli_deque_grow(deque, a, t, b);
+
+	STORE(&a->buf[b & (a->size - 1)], task, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	STORE(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+}
+
+static mowgli_task_t *
+mowgli_deque_take(mowgli_deque_t *deque)
+{
+	int64_t b = LOAD(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	mowgli_deque_array_t *a = LOAD(&deque->array, __ATOMIC_RELAXED);
+	mowgli_task_t *task = NULL;
+	int64_t t;
+
+	STORE(&deque->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	t = LOAD(&deque->top, __ATOMIC_RELAXED);
+
+	if (t <= b)
+	{
+		task = LOAD(&a->buf[b & (a->size - 1)], __ATOMIC_RELAXED);
+
+		if (t != b)
+			return task;
+
+		/* last element, race against thieves for it */
+		if (!CAS(&deque->top, &t, t + 1))
+			task = NULL;
+	}
+
+	STORE(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+
+	return task;
+}
+
+static mowgli_task_t *
+mowgli_deque_steal(mowgli_deque_t *deque)
+{
+	int64_t t = LOAD(&deque->top, __ATOMIC_ACQUIRE);
+	int64_t b;
+	mowgli_deque_array_t *a;
+	mowgli_task_t *task;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = LOAD(&deque->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return NULL;
+
+	a = LOAD(&deque->array, __ATOMIC_ACQUIRE);
+	task = LOAD(&a->buf[t & (a->size - 1)], __ATOMIC_RELAXED);
+
+	if (!CAS(&deque->top, &t, t + 1))
+		return NULL;
+
+	return task;
+}
+
+static bool
+mowgli_deque_empty(mowgli_deque_t *deque)
+{
+	return LOAD(&deque->bottom, __ATOMIC_SEQ_CST) <= LOAD(&deque->top, __ATOMIC_SEQ_CST);
+}
+
+static uint32_t
+mowgli_scheduler_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	if (x == 0)
+		x = (uint32_t) (uintptr_t) state | 1;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return *state = x;
+}
+
+static void
+mowgli_scheduler_yield(void)
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+/* the calling thread's worker, or NULL if it is not one of ours */
+static mowgli_scheduler_worker_t *
+mowgli_scheduler_self(mowgli_scheduler_t *scheduler)
+{
+	mowgli_scheduler_worker_t *worker = current_worker;
+
+	if ((worker != NULL) && (worker->scheduler == scheduler))
+		return worker;
+
+	return NULL;
+}
+
+static mowgli_task_t *
+mowgli_scheduler_find_task(mowgli_scheduler_t *scheduler, mowgli_scheduler_worker_t *self)
+{
+	mowgli_scheduler_worker_t *external = &scheduler->workers[scheduler->nthreads];
+	mowgli_task_t *task;
+	unsigned int i, victim, nslots = scheduler->nthreads + 1;
+
+	if (self != NULL)
+	{
+		if ((task = mowgli_deque_take(&self->deque)) != NULL)
+			return task;
+	}
+	else if (!mowgli_deque_empty(&external->deque))
+	{
+		mowgli_mutex_lock(&scheduler->external_lock);
+		task = mowgli_deque_take(&external->deque);
+		mowgli_mutex_unlock(&scheduler->external_lock);
+
+		if (task != NULL)
+			return task;
+	}
+
+	victim = mowgli_scheduler_random(self != NULL ? &self->rng : &external_rng) % nslots;
+
+	for (i = 0; i < nslots; i++, victim = (victim + 1) % nslots)
+	{
+		mowgli_scheduler_worker_t *worker = &scheduler->workers[victim];
+
+		if ((worker == self) || ((self == NULL) && (worker == external)))
+			continue;
+
+		if ((task = mowgli_deque_steal(&worker->deque)) != NULL)
+			return task;
+	}
+
+	return NULL;
+}
+
+static mowgli_task_t *
+mowgli_scheduler_task_alloc(mowgli_scheduler_worker_t *self)
+{
+	mowgli_task_t *task;
+
+	if ((self == NULL) || (self->cache == NULL))
+		return mowgli_alloc(sizeof *task);
+
+	task = self->cache;
+	self->cache = task->next;
+	self->ncached--;
+
+	return task;
+}
+
+static void
+mowgli_scheduler_task_free(mowgli_scheduler_worker_t *self, mowgli_task_t *task)
+{
+	if ((self == NULL) || (self->ncached >= MOWGLI_SCHEDULER_MAX_CACHED))
+	{
+		mowgli_free(task);
+		return;
+	}
+
+	task->next = self->cache;
+	self->cache = task;
+	self->ncached++;
+}
+
+static void
+mowgli_scheduler_run(mowgli_scheduler_worker_t *self, mowgli_task_t *task)
+{
+	mowgli_task_group_t *group = task->group;
+
+	task->fn(task->arg);
+	mowgli_scheduler_task_free(self, task);
+
+	__atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE);
+}
+
+static bool
+mowgli_scheduler_has_work(mowgli_scheduler_t *scheduler)
+{
+	unsigned int i;
+
+	for (i = 0; i <= scheduler->nthreads; i++)
+		if (!mowgli_deque_empty(&scheduler->workers[i].deque))
+			return true;
+
+	return false;
+}
+
+static void *
+mowgli_scheduler_worker(mowgli_thread_t *thread, void *userdata)
+{
+	mowgli_scheduler_worker_t *self = userdata;
+	mowgli_scheduler_t *scheduler = self->scheduler;
+	unsigned int idle = 0;
+
+	current_worker = self;
+
+	while (!LOAD(&scheduler->shutdown, __ATOMIC_ACQUIRE))
+	{
+		mowgli_task_t *task = mowgli_scheduler_find_task(scheduler, self);
+
+		if (task != NULL)
+		{
+			mowgli_scheduler_run(self, task);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < MOWGLI_SCHEDULER_SPINS)
+		{
+			mowgli_scheduler_yield();
+			continue;
+		}
+
+		/* announce ourselves before the final check, spawners look at
+		 * sleepers after pushing.  the timeout is only a backstop.
+		 */
+		mowgli_mutex_lock(&scheduler->sleep_lock);
+		__atomic_add_fetch(&scheduler->sleepers, 1, __ATOMIC_SEQ_CST);
+
+		if (!LOAD(&scheduler->shutdown, __ATOMIC_ACQUIRE) && !mowgli_scheduler_has_work(scheduler))
+			mowgli_cond_timedwait(&scheduler->sleep_cond, &scheduler->sleep_lock, 100);
+
+		__atomic_sub_fetch(&scheduler->sleepers, 1, __ATOMIC_SEQ_CST);
+		mowgli_mutex_unlock(&scheduler->sleep_lock);
+
+		idle = 0;
+	}
+
+	current_worker = NULL;
+
+	return NULL;
+}
+
+/* tell the workers to stop and wait for the first started of them */
+static void
+mowgli_scheduler_stop(mowgli_scheduler_t *scheduler, unsigned int started)
+{
+	unsigned int i;
+
+	STORE(&scheduler->shutdown, true, __ATOMIC_RELEASE);
+
+	mowgli_mutex_lock(&scheduler->sleep_lock);
+	mowgli_cond_broadcast(&scheduler->sleep_cond);
+	mowgli_mutex_unlock(&scheduler->sleep_lock);
+
+	for (i = 0; i < started; i++)
+	{
+		mowgli_thread_join(&scheduler->workers[i].thread);
+		mowgli_thread_destroy(&scheduler->workers[i].thread);
+	}
+}
+
+static void
+mowgli_scheduler_free(mowgli_scheduler_t *scheduler)
+{
+	unsigned int i;
+
+	for (i = 0; i <= scheduler->nthreads; i++)
+	{
+		mowgli_scheduler_worker_t *worker = &scheduler->workers[i];
+
+		while (worker->cache != NULL)
+		{
+			mowgli_task_t *task = worker->cache;
+
+			worker->cache = task->next;
+			mowgli_free(task);
+		}
+
+		mowgli_deque_fini(&worker->deque);
+	}
+
+	mowgli_cond_uninit(&scheduler->sleep_cond);
+	mowgli_mutex_uninit(&scheduler->sleep_lock);
+	mowgli_mutex_uninit(&scheduler->external_lock);
+
+	mowgli_free(scheduler->workers);
+	mowgli_free(scheduler);
+}
+
+/* start a scheduler with the given number of worker threads, or one per
+ * online CPU if threads is 0.  returns NULL if the threads can't all be
+ * started.
+ */
+mowgli_scheduler_t *
+mowgli_scheduler_create(unsigned int threads)
+{
+	mowgli_scheduler_t *scheduler;
+	unsigned int i;
+
+	if (threads == 0)
+	{
+#ifdef _SC_NPROCESSORS_ONLN
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = n > 0 ? (unsigned int) n : 1;
+#else
+		threads = 1;
+#endif
+	}
+
+	scheduler = mowgli_alloc(sizeof *scheduler);
+	scheduler->nthreads = threads;
+	scheduler->workers = mowgli_alloc_array(sizeof(mowgli_scheduler_worker_t), threads + 1);
+
+	mowgli_mutex_init(&scheduler->external_lock);
+	mowgli_mutex_init(&scheduler->sleep_lock);
+	mowgli_cond_init(&scheduler->sleep_cond);
+
+	for (i = 0; i <= threads; i++)
+	{
+		scheduler->workers[i].scheduler = scheduler;
+		scheduler->workers[i].index = i;
+		scheduler->workers[i].rng = 2463534242U + i * 2654435761U;
+		mowgli_deque_init(&scheduler->workers[i].deque);
+	}
+
+	for (i = 0; i < threads; i++)
+	{
+		if (mowgli_thread_create(&scheduler->workers[i].thread, mowgli_scheduler_worker, &scheduler->workers[i]) != 0)
+		{
+			mowgli_log("mowgli_scheduler_create(): couldn't start worker %u", i);
+
+			/* the running workers look at every slot, so nothing can be
+			 * taken away from under them; stop them all instead */
+			mowgli_scheduler_stop(scheduler, i);
+			mowgli_scheduler_free(scheduler);
+			return NULL;
+		}
+	}
+
+	return scheduler;
+}
+
+unsigned int
+mowgli_scheduler_threads(mowgli_scheduler_t *scheduler)
+{
+	return_val_if_fail(scheduler != NULL, 0);
+
+	return scheduler->nthreads;
+}
+
+/* stop all workers.  there must not be any task groups left to wait for. */
+void
+mowgli_scheduler_destroy(mowgli_scheduler_t *scheduler)
+{
+	return_if_fail(scheduler != NULL);
+
+	mowgli_scheduler_stop(scheduler, scheduler->nthreads);
+	mowgli_scheduler_free(scheduler);
+}
+
+void
+mowgli_task_group_init(mowgli_task_group_t *group, mowgli_scheduler_t *scheduler)
+{
+	return_if_fail(group != NULL);
+	return_if_fail(scheduler != NULL);
+
+	group->scheduler = scheduler;
+	group->pending = 0;
+}
+
+void
+mowgli_task_group_spawn(mowgli_task_group_t *group, mowgli_task_fn_t *fn, void *arg)
+{
+	mowgli_scheduler_t *scheduler;
+	mowgli_scheduler_worker_t *self;
+	mowgli_task_t *task;
+
+	return_if_fail(group != NULL);
+	return_if_fail(fn != NULL);
+
+	scheduler = group->scheduler;
+	self = mowgli_scheduler_self(scheduler);
+
+	task = mowgli_scheduler_task_alloc(self);
+	task->fn = fn;
+	task->arg = arg;
+	task->group = group;
+
+	__atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+	if (self != NULL)
+	{
+		mowgli_deque_push(&self->deque, task);
+	}
+	else
+	{
+		mowgli_mutex_lock(&scheduler->external_lock);
+		mowgli_deque_push(&scheduler->workers[scheduler->nthreads].deque, task);
+		mowgli_mutex_unlock(&scheduler->external_lock);
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (LOAD(&scheduler->sleepers, __ATOMIC_SEQ_CST) > 0)
+	{
+		mowgli_mutex_lock(&scheduler->sleep_lock);
+		mowgli_cond_signal(&scheduler->sleep_cond);
+		mowgli_mutex_unlock(&scheduler->sleep_lock);
+	}
+}
+
+/* wait for every task spawned into group, running tasks in the meantime */
+void
+mowgli_task_group_wait(mowgli_task_group_t *group)
+{
+	mowgli_scheduler_t *scheduler;
+	mowgli_scheduler_worker_t *self;
+
+	return_if_fail(group != NULL);
+
+	scheduler = group->scheduler;
+	self = mowgli_scheduler_self(scheduler);
+
+	while (LOAD(&group->pending, __ATOMIC_ACQUIRE) > 0)
+	{
+		mowgli_task_t *task = mowgli_scheduler_find_task(scheduler, self);
+
+		if (task != NULL)
+			mowgli_scheduler_run(self, task);
+		else
+			mowgli_scheduler_yield();
+	}
+}
+
+typedef struct
+{
+	mowgli_task_group_t *group;
+	size_t begin, end, grain;
+	mowgli_parallel_for_fn_t *fn;
+	void *arg;
+} mowgli_parallel_for_range_t;
+
+/* split off the upper half until the range is small enough; the halves are
+ * there for other workers to steal.
+ */
+static void
+mowgli_parallel_for_task(void *arg)
+{
+	mowgli_parallel_for_range_t *range = arg;
+
+	while (range->end - range->begin > range->grain)
+	{
+		mowgli_parallel_for_range_t *upper = mowgli_alloc(sizeof *upper);
+		size_t mid = range->begin + (range->end - range->begin) / 2;
+
+		*upper = *range;
+		upper->begin = mid;
+		range->end = mid;
+
+		mowgli_task_group_spawn(range->group, mowgli_parallel_for_task, upper);
+	}
+
+	range->fn(range->begin, range->end, range->arg);
+	mowgli_free(range);
+}
+
+/* call fn on subranges of [begin, end) no larger than grain, in parallel,
+ * and return when all of them are done.
+ */
+void
+mowgli_parallel_for(mowgli_scheduler_t *scheduler, size_t begin, size_t end, size_t grain, mowgli_parallel_for_fn_t *fn, void *arg)
+{
+	mowgli_task_group_t group;
+	mowgli_parallel_for_range_t *range;
+
+	return_if_fail(scheduler != NULL);
+	return_if_fail(fn != NULL);
+
+	if (begin >= end)
+		return;
+
+	mowgli_task_group_init(&group, scheduler);
+
+	range = mowgli_alloc(sizeof *range);
+	range->group = &group;
+	range->begin = begin;
+	range->end = end;
+	range->grain = MAX(grain, 1);
+	range->fn = fn;
+	range->arg = arg;
+
+	mowgli_parallel_for_task(range);
+	mowgli_task_group_wait(&group);
+}
+
+#else
+
+mowgli_scheduler_t *
+mowgli_scheduler_create(unsigned int threads)
+{
+	mowgli_log("mowgli_scheduler_create(): not supported with this compiler");
+	return NULL;
+}
+
+unsigned int
+mowgli_scheduler_threads(mowgli_scheduler_t *scheduler)
+{
+	return 0;
+}
+
+void
+mowgli_scheduler_destroy(mowgli_scheduler_t *scheduler)
+{ }
+
+void
+mowgli_task_group_init(mowgli_task_group_t *group, mowgli_scheduler_t *scheduler)
+{ }
+
+void
+mowgli_task_group_spawn(mowgli_task_group_t *group, mowgli_task_fn_t *fn, void *arg)
+{
+	fn(arg);
+}
+
+void
+mowgli_task_group_wait(mowgli_task_group_t *group)
+{ }
+
+void
+mowgli_parallel_for(mowgli_scheduler_t *scheduler, size_t begin, size_t end, size_t grain, mowgli_parallel_for_fn_t *fn, void *arg)
+{
+	if (begin < end)
+		fn(begin, end, arg);
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * scheduler.h: Work-stealing task scheduler.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOWGLI_SRC_LIBMOWGLI_THREAD_SCHEDULER_H_INCLUDE_GUARD
+#define MOWGLI_SRC_LIBMOWGLI_THREAD_SCHEDULER_H_INCLUDE_GUARD 1
+
+#include "thread/cond.h"
+
+typedef struct _mowgli_scheduler mowgli_scheduler_t;
+
+typedef void mowgli_task_fn_t (void *arg);
+typedef void mowgli_parallel_for_fn_t (size_t begin, size_t end, void *arg);
+
+/* a set of tasks which can be waited for as a whole.  usually lives on the
+ * stack of the function spawning the tasks.
+ */
+typedef struct
+{
+	mowgli_scheduler_t *scheduler;
+	long pending;
+} mowgli_task_group_t;
+
+extern mowgli_scheduler_t *mowgli_scheduler_create(unsigned int threads);
+extern unsigned int mowgli_scheduler_threads(mowgli_scheduler_t *scheduler);
+extern void mowgli_scheduler_destroy(mowgli_scheduler_t *scheduler);
+
+extern void mowgli_task_group_init(mowgli_task_group_t *group, mowgli_scheduler_t *scheduler);
+extern void mowgli_task_group_spawn(mowgli_task_group_t *group, mowgli_task_fn_t *fn, void *arg);
+extern void mowgli_task_group_wait(mowgli_task_group_t *group);
+
+extern void mowgli_parallel_for(mowgli_scheduler_t *scheduler, size_t begin, size_t end, size_t grain, mowgli_parallel_for_fn_t *fn, void *arg);
+
+#endif /* MOWGLI_SRC_LIBMOWGLI_THREAD_SCHEDULER_H_INCLUDE_GUARD */
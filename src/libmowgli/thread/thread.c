@@ -0,0 +1,213 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * thread.c: Cross-platform threading helper routines.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* the start function gets the thread object, so it is passed through a small
+ * trampoline record which the new thread frees.
+ */
+typedef struct
+{
+	mowgli_thread_t *thread;
+	mowgli_thread_start_fn_t start_fn;
+	void *userdata;
+} mowgli_thread_start_req_t;
+
+#if defined(_WIN32)
+
+static DWORD WINAPI
+mowgli_win32_thread_trampoline(LPVOID arg)
+{
+	mowgli_thread_start_req_t req = *(mowgli_thread_start_req_t *) arg;
+
+	mowgli_free(arg);
+	req.start_fn(req.thread, req.userdata);
+
+	return 0;
+}
+
+static int
+mowgli_win32_thread_create(mowgli_thread_t *thread, mowgli_thread_start_fn_t start_fn, void *userdata)
+{
+	mowgli_thread_start_req_t *req = mowgli_alloc(sizeof *req);
+
+	req->thread = thread;
+	req->start_fn = start_fn;
+	req->userdata = userdata;
+
+	thread->thread = CreateThread(NULL, 0, mowgli_win32_thread_trampoline, req, 0, NULL);
+
+	if (thread->thread == NULL)
+	{
+		mowgli_free(req);
+		return GetLastError();
+	}
+
+	return 0;
+}
+
+static void
+mowgli_win32_thread_exit(mowgli_thread_t *thread)
+{
+	ExitThread(0);
+}
+
+static void *
+mowgli_win32_thread_join(mowgli_thread_t *thread)
+{
+	WaitForSingleObject(thread->thread, INFINITE);
+	return NULL;
+}
+
+static void
+mowgli_win32_thread_kill(mowgli_thread_t *thread)
+{
+	TerminateThread(thread->thread, 0);
+}
+
+static void
+mowgli_win32_thread_destroy(mowgli_thread_t *thread)
+{
+	CloseHandle(thread->thread);
+}
+
+static const mowgli_thread_ops_t _mowgli_win32_thread_ops =
+{
+	.thread_create = mowgli_win32_thread_create,
+	.thread_exit = mowgli_win32_thread_exit,
+	.thread_join = mowgli_win32_thread_join,
+	.thread_kill = mowgli_win32_thread_kill,
+	.thread_destroy = mowgli_win32_thread_destroy
+};
+
+# define MOWGLI_THREAD_OPS _mowgli_win32_thread_ops
+
+#elif !defined(MOWGLI_FEATURE_HAVE_NATIVE_THREADS)
+
+static void *
+mowgli_posix_thread_trampoline(void *arg)
+{
+	mowgli_thread_start_req_t req = *(mowgli_thread_start_req_t *) arg;
+
+	mowgli_free(arg);
+
+	return req.start_fn(req.thread, req.userdata);
+}
+
+static int
+mowgli_posix_thread_create(mowgli_thread_t *thread, mowgli_thread_start_fn_t start_fn, void *userdata)
+{
+	mowgli_thread_start_req_t *req = mowgli_alloc(sizeof *req);
+	int ret;
+
+	req->thread = thread;
+	req->start_fn = start_fn;
+	req->userdata = userdata;
+
+	if ((ret = pthread_create(&thread->thread, NULL, mowgli_posix_thread_trampoline, req)) != 0)
+		mowgli_free(req);
+
+	return ret;
+}
+
+static void
+mowgli_posix_thread_exit(mowgli_thread_t *thread)
+{
+	pthread_exit(NULL);
+}
+
+static void *
+mowgli_posix_thread_join(mowgli_thread_t *thread)
+{
+	void *result = NULL;
+
+	pthread_join(thread->thread, &result);
+
+	return result;
+}
+
+static void
+mowgli_posix_thread_kill(mowgli_thread_t *thread)
+{
+	pthread_cancel(thread->thread);
+}
+
+static void
+mowgli_posix_thread_destroy(mowgli_thread_t *thread)
+{ }
+
+static const mowgli_thread_ops_t _mowgli_posix_thread_ops =
+{
+	.thread_create = mowgli_posix_thread_create,
+	.thread_exit = mowgli_posix_thread_exit,
+	.thread_join = mowgli_posix_thread_join,
+	.thread_kill = mowgli_posix_thread_kill,
+	.thread_destroy = mowgli_posix_thread_destroy
+};
+
+# define MOWGLI_THREAD_OPS _mowgli_posix_thread_ops
+
+#endif
+
+#ifdef MOWGLI_THREAD_OPS
+
+int
+mowgli_thread_create(mowgli_thread_t *thread, mowgli_thread_start_fn_t start_fn, void *userdata)
+{
+	return_val_if_fail(thread != NULL, -1);
+	return_val_if_fail(start_fn != NULL, -1);
+
+	return MOWGLI_THREAD_OPS.thread_create(thread, start_fn, userdata);
+}
+
+void
+mowgli_thread_exit(mowgli_thread_t *thread)
+{
+	MOWGLI_THREAD_OPS.thread_exit(thread);
+}
+
+void *
+mowgli_thread_join(mowgli_thread_t *thread)
+{
+	return_val_if_fail(thread != NULL, NULL);
+
+	return MOWGLI_THREAD_OPS.thread_join(thread);
+}
+
+void
+mowgli_thread_kill(mowgli_thread_t *thread)
+{
+	return_if_fail(thread != NULL);
+
+	MOWGLI_THREAD_OPS.thread_kill(thread);
+}
+
+void
+mowgli_thread_destroy(mowgli_thread_t *thread)
+{
+	return_if_fail(thread != NULL);
+
+	MOWGLI_THREAD_OPS.thread_destroy(thread);
+}
+
+#endif
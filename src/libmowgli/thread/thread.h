@@ -25,21 +25,14 @@
 #ifndef MOWGLI_SRC_LIBMOWGLI_THREAD_THREAD_H_INCLUDE_GUARD
 #define MOWGLI_SRC_LIBMOWGLI_THREAD_THREAD_H_INCLUDE_GUARD 1
 
-#ifdef MOWGLI_OS_UNIX_TYPE
-#  include <thread.h>
+/* Solaris, HP-UX and SCO have pthreads too (machine.h says as much), so
+ * only Windows gets native threads.
+ */
+#if defined MOWGLI_OS_WIN
 #  define MOWGLI_FEATURE_HAVE_NATIVE_THREADS
-#  ifdef MOWGLI_OS_THREADS_SOLARIS
-#    define MOWGLI_NATIVE_THREAD_DECL(name) pthread_t(name)
-#  else
-#    define MOWGLI_NATIVE_THREAD_DECL(name) thread_t(name)
-#  endif
+#  define MOWGLI_NATIVE_THREAD_DECL(name) HANDLE(name)
 #else
-#  if defined MOWGLI_OS_WIN
-#    define MOWGLI_FEATURE_HAVE_NATIVE_THREADS
-#    define MOWGLI_NATIVE_THREAD_DECL(name) HANDLE(name)
-#  else
-#    include <pthread.h>
-#  endif
+#  include <pthread.h>
 #endif
 
 typedef struct
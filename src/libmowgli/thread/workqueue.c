@@ -0,0 +1,482 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * workqueue.c: Worker thread pools delivering results to an eventloop.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* Jobs are allocated, completed and freed on the eventloop's thread; worker
+ * threads only move them between the queue and the done list under the
+ * workqueue's mutex.  Finished jobs are handed back through a pipe which is
+ * polled by the eventloop, and the pipe is only written to when the done
+ * list goes from empty to non-empty.
+ *
+ * Threads above min_threads exit after being idle for idle_timeout
+ * milliseconds and are joined from the eventloop.
+ */
+
+#ifndef _WIN32
+
+typedef enum
+{
+	MOWGLI_WORKQUEUE_JOB_QUEUED,
+	MOWGLI_WORKQUEUE_JOB_RUNNING,
+	MOWGLI_WORKQUEUE_JOB_DONE,
+} mowgli_workqueue_job_state_t;
+
+struct _mowgli_workqueue_job
+{
+	mowgli_node_t node;
+
+	mowgli_workqueue_work_fn_t *work_fn;
+	mowgli_workqueue_done_fn_t *done_fn;
+	void *arg;
+
+	mowgli_workqueue_job_state_t state;
+};
+
+typedef struct
+{
+	mowgli_node_t node;
+	mowgli_thread_t thread;
+	mowgli_workqueue_t *wq;
+} mowgli_workqueue_worker_t;
+
+struct _mowgli_workqueue
+{
+	mowgli_eventloop_t *eventloop;
+
+	mowgli_mutex_t mutex;
+	mowgli_cond_t cond;
+
+	/* all protected by mutex */
+	mowgli_list_t queue;
+	mowgli_list_t done;
+	mowgli_list_t workers;
+	mowgli_list_t exited;
+
+	unsigned int min_threads;
+	unsigned int max_threads;
+	unsigned int idle_timeout;
+	unsigned int idle;
+	size_t running;
+	size_t queued_peak;
+	bool shutdown;
+
+	/* only touched from the eventloop */
+	unsigned long submitted;
+	unsigned long completed;
+	unsigned long cancelled;
+
+	int doorbell[2];
+	mowgli_eventloop_pollable_t *pfd;
+};
+
+static mowgli_heap_t *job_heap = NULL;
+
+static void
+mowgli_workqueue_ring(mowgli_workqueue_t *wq)
+{
+	ssize_t ret = write(wq->doorbell[1], "", 1);
+
+	(void) ret;
+}
+
+static void *
+mowgli_workqueue_worker(mowgli_thread_t *thread, void *userdata)
+{
+	mowgli_workqueue_worker_t *worker = userdata;
+	mowgli_workqueue_t *wq = worker->wq;
+	mowgli_workqueue_job_t *job;
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	for (;;)
+	{
+		while ((wq->queue.head == NULL) && !wq->shutdown)
+		{
+			bool elastic = MOWGLI_LIST_LENGTH(&wq->workers) > wq->min_threads;
+			int ret;
+
+			wq->idle++;
+
+			if (elastic)
+				ret = mowgli_cond_timedwait(&wq->cond, &wq->mutex, wq->idle_timeout);
+			else
+				ret = mowgli_cond_wait(&wq->cond, &wq->mutex);
+
+			wq->idle--;
+
+			if (elastic && (ret == ETIMEDOUT) && (wq->queue.head == NULL) &&
+			    (MOWGLI_LIST_LENGTH(&wq->workers) > wq->min_threads))
+				goto out;
+		}
+
+		if (wq->shutdown)
+			break;
+
+		job = wq->queue.head->data;
+		mowgli_node_delete(&job->node, &wq->queue);
+		job->state = MOWGLI_WORKQUEUE_JOB_RUNNING;
+		wq->running++;
+
+		mowgli_mutex_unlock(&wq->mutex);
+
+		job->work_fn(job->arg);
+
+		mowgli_mutex_lock(&wq->mutex);
+
+		wq->running--;
+		job->state = MOWGLI_WORKQUEUE_JOB_DONE;
+		mowgli_node_add(job, &job->node, &wq->done);
+
+		if (MOWGLI_LIST_LENGTH(&wq->done) == 1)
+			mowgli_workqueue_ring(wq);
+	}
+
+out:
+	mowgli_node_move(&worker->node, &wq->workers, &wq->exited);
+	mowgli_workqueue_ring(wq);
+
+	mowgli_mutex_unlock(&wq->mutex);
+
+	return NULL;
+}
+
+/* called with the mutex held */
+static void
+mowgli_workqueue_spawn(mowgli_workqueue_t *wq)
+{
+	mowgli_workqueue_worker_t *worker = mowgli_alloc(sizeof *worker);
+
+	worker->wq = wq;
+	mowgli_node_add(worker, &worker->node, &wq->workers);
+
+	if (mowgli_thread_create(&worker->thread, mowgli_workqueue_worker, worker) != 0)
+	{
+		mowgli_log("mowgli_workqueue: couldn't create worker thread");
+		mowgli_node_delete(&worker->node, &wq->workers);
+		mowgli_free(worker);
+	}
+}
+
+static void
+mowgli_workqueue_reap(mowgli_list_t *workers)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, workers->head)
+	{
+		mowgli_workqueue_worker_t *worker = n->data;
+
+		mowgli_node_delete(n, workers);
+		mowgli_thread_join(&worker->thread);
+		mowgli_thread_destroy(&worker->thread);
+		mowgli_free(worker);
+	}
+}
+
+static void
+mowgli_workqueue_complete(mowgli_workqueue_t *wq, mowgli_list_t *jobs, bool cancelled)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, jobs->head)
+	{
+		mowgli_workqueue_job_t *job = n->data;
+
+		mowgli_node_delete(n, jobs);
+
+		if (cancelled)
+			wq->cancelled++;
+		else
+			wq->completed++;
+
+		if (job->done_fn != NULL)
+			job->done_fn(wq, job->arg, cancelled);
+
+		mowgli_heap_free(job_heap, job);
+	}
+}
+
+static void
+mowgli_workqueue_doorbell_cb(mowgli_eventloop_t *eventloop, mowgli_eventloop_io_t *io, mowgli_eventloop_io_dir_t dir, void *userdata)
+{
+	mowgli_workqueue_t *wq = userdata;
+	mowgli_list_t done, exited;
+	char buf[64];
+
+	while (read(wq->doorbell[0], buf, sizeof buf) > 0)
+		;
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	done = wq->done;
+	exited = wq->exited;
+	memset(&wq->done, 0, sizeof wq->done);
+	memset(&wq->exited, 0, sizeof wq->exited);
+
+	mowgli_mutex_unlock(&wq->mutex);
+
+	mowgli_workqueue_reap(&exited);
+	mowgli_workqueue_complete(wq, &done, false);
+}
+
+/* create a pool of at least min_threads and at most max_threads threads.
+ * done callbacks are run from eventloop.
+ */
+mowgli_workqueue_t *
+mowgli_workqueue_create(mowgli_eventloop_t *eventloop, unsigned int min_threads, unsigned int max_threads)
+{
+	mowgli_workqueue_t *wq;
+	unsigned int i;
+
+	return_val_if_fail(eventloop != NULL, NULL);
+	return_val_if_fail(max_threads > 0, NULL);
+	return_val_if_fail(min_threads <= max_threads, NULL);
+
+	if (job_heap == NULL)
+		job_heap = mowgli_heap_create(sizeof(mowgli_workqueue_job_t), 64, BH_NOW);
+
+	wq = mowgli_alloc(sizeof *wq);
+	wq->eventloop = eventloop;
+	wq->min_threads = min_threads;
+	wq->max_threads = max_threads;
+	wq->idle_timeout = 30000;
+
+	if (pipe(wq->doorbell) < 0)
+	{
+		mowgli_log("mowgli_workqueue_create(): pipe failed: %s", strerror(errno));
+		mowgli_free(wq);
+		return NULL;
+	}
+
+	mowgli_mutex_init(&wq->mutex);
+	mowgli_cond_init(&wq->cond);
+
+	fcntl(wq->doorbell[1], F_SETFL, fcntl(wq->doorbell[1], F_GETFL) | O_NONBLOCK);
+
+	wq->pfd = mowgli_pollable_create(eventloop, wq->doorbell[0], wq);
+	mowgli_pollable_set_nonblocking(wq->pfd, true);
+	mowgli_pollable_setselect(eventloop, wq->pfd, MOWGLI_EVENTLOOP_IO_READ, mowgli_workqueue_doorbell_cb);
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	for (i = 0; i < min_threads; i++)
+		mowgli_workqueue_spawn(wq);
+
+	mowgli_mutex_unlock(&wq->mutex);
+
+	return wq;
+}
+
+/* how long threads above min_threads wait for work before exiting */
+void
+mowgli_workqueue_set_idle_timeout(mowgli_workqueue_t *wq, unsigned int msec)
+{
+	return_if_fail(wq != NULL);
+
+	mowgli_mutex_lock(&wq->mutex);
+	wq->idle_timeout = msec;
+	mowgli_mutex_unlock(&wq->mutex);
+}
+
+/* queue work_fn(arg) on a worker thread.  the returned handle stays valid
+ * until done_fn has been called.
+ */
+mowgli_workqueue_job_t *
+mowgli_workqueue_submit(mowgli_workqueue_t *wq, mowgli_workqueue_work_fn_t *work_fn, mowgli_workqueue_done_fn_t *done_fn, void *arg)
+{
+	mowgli_workqueue_job_t *job;
+	size_t queued;
+
+	return_val_if_fail(wq != NULL, NULL);
+	return_val_if_fail(work_fn != NULL, NULL);
+
+	job = mowgli_heap_alloc(job_heap);
+	job->work_fn = work_fn;
+	job->done_fn = done_fn;
+	job->arg = arg;
+	job->state = MOWGLI_WORKQUEUE_JOB_QUEUED;
+
+	wq->submitted++;
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	mowgli_node_add(job, &job->node, &wq->queue);
+	queued = MOWGLI_LIST_LENGTH(&wq->queue);
+
+	if (queued > wq->queued_peak)
+		wq->queued_peak = queued;
+
+	if ((queued > wq->idle) && (MOWGLI_LIST_LENGTH(&wq->workers) < wq->max_threads))
+		mowgli_workqueue_spawn(wq);
+	else
+		mowgli_cond_signal(&wq->cond);
+
+	mowgli_mutex_unlock(&wq->mutex);
+
+	return job;
+}
+
+/* cancel a job which has not been picked up by a thread yet.  its done_fn is
+ * called right away with cancelled set.  returns false if the job is already
+ * running or finished, in which case done_fn runs as usual.
+ */
+bool
+mowgli_workqueue_cancel(mowgli_workqueue_t *wq, mowgli_workqueue_job_t *job)
+{
+	mowgli_list_t jobs;
+
+	return_val_if_fail(wq != NULL, false);
+	return_val_if_fail(job != NULL, false);
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	if (job->state != MOWGLI_WORKQUEUE_JOB_QUEUED)
+	{
+		mowgli_mutex_unlock(&wq->mutex);
+		return false;
+	}
+
+	mowgli_node_delete(&job->node, &wq->queue);
+
+	mowgli_mutex_unlock(&wq->mutex);
+
+	memset(&jobs, 0, sizeof jobs);
+	mowgli_node_add(job, &job->node, &jobs);
+	mowgli_workqueue_complete(wq, &jobs, true);
+
+	return true;
+}
+
+void
+mowgli_workqueue_get_stats(mowgli_workqueue_t *wq, mowgli_workqueue_stats_t *stats)
+{
+	return_if_fail(wq != NULL);
+	return_if_fail(stats != NULL);
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	stats->queued = MOWGLI_LIST_LENGTH(&wq->queue);
+	stats->running = wq->running;
+	stats->completing = MOWGLI_LIST_LENGTH(&wq->done);
+	stats->queued_peak = wq->queued_peak;
+	stats->threads = MOWGLI_LIST_LENGTH(&wq->workers);
+	stats->idle_threads = wq->idle;
+
+	mowgli_mutex_unlock(&wq->mutex);
+
+	stats->submitted = wq->submitted;
+	stats->completed = wq->completed;
+	stats->cancelled = wq->cancelled;
+}
+
+/* stop the pool.  queued jobs are cancelled, running ones are waited for and
+ * completed.  must not be called from a done callback.
+ */
+void
+mowgli_workqueue_destroy(mowgli_workqueue_t *wq)
+{
+	mowgli_list_t queued, workers;
+	mowgli_node_t *n, *tn;
+
+	return_if_fail(wq != NULL);
+
+	mowgli_mutex_lock(&wq->mutex);
+
+	wq->shutdown = true;
+	queued = wq->queue;
+	memset(&wq->queue, 0, sizeof wq->queue);
+
+	/* worker nodes are only ever freed here, so it is fine to join them
+	 * after dropping the lock even though they still move between lists.
+	 */
+	memset(&workers, 0, sizeof workers);
+
+	MOWGLI_ITER_FOREACH(n, wq->workers.head)
+		mowgli_node_add(n->data, mowgli_node_create(), &workers);
+
+	MOWGLI_ITER_FOREACH(n, wq->exited.head)
+		mowgli_node_add(n->data, mowgli_node_create(), &workers);
+
+	mowgli_cond_broadcast(&wq->cond);
+	mowgli_mutex_unlock(&wq->mutex);
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, workers.head)
+	{
+		mowgli_workqueue_worker_t *worker = n->data;
+
+		mowgli_thread_join(&worker->thread);
+		mowgli_thread_destroy(&worker->thread);
+		mowgli_free(worker);
+
+		mowgli_node_delete(n, &workers);
+		mowgli_node_free(n);
+	}
+
+	mowgli_workqueue_complete(wq, &queued, true);
+	mowgli_workqueue_complete(wq, &wq->done, false);
+
+	mowgli_pollable_destroy(wq->eventloop, wq->pfd);
+	close(wq->doorbell[0]);
+	close(wq->doorbell[1]);
+
+	mowgli_cond_uninit(&wq->cond);
+	mowgli_mutex_uninit(&wq->mutex);
+
+	mowgli_free(wq);
+}
+
+#else
+
+mowgli_workqueue_t *
+mowgli_workqueue_create(mowgli_eventloop_t *eventloop, unsigned int min_threads, unsigned int max_threads)
+{
+	mowgli_log("mowgli_workqueue_create(): not supported on this platform");
+	return NULL;
+}
+
+void
+mowgli_workqueue_set_idle_timeout(mowgli_workqueue_t *wq, unsigned int msec)
+{ }
+
+mowgli_workqueue_job_t *
+mowgli_workqueue_submit(mowgli_workqueue_t *wq, mowgli_workqueue_work_fn_t *work_fn, mowgli_workqueue_done_fn_t *done_fn, void *arg)
+{
+	return NULL;
+}
+
+bool
+mowgli_workqueue_cancel(mowgli_workqueue_t *wq, mowgli_workqueue_job_t *job)
+{
+	return false;
+}
+
+void
+mowgli_workqueue_get_stats(mowgli_workqueue_t *wq, mowgli_workqueue_stats_t *stats)
+{ }
+
+void
+mowgli_workqueue_destroy(mowgli_workqueue_t *wq)
+{ }
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * workqueue.h: Worker thread pools delivering results to an eventloop.
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOWGLI_SRC_LIBMOWGLI_THREAD_WORKQUEUE_H_INCLUDE_GUARD
+#define MOWGLI_SRC_LIBMOWGLI_THREAD_WORKQUEUE_H_INCLUDE_GUARD 1
+
+#include "eventloop/eventloop.h"
+#include "thread/cond.h"
+
+typedef struct _mowgli_workqueue mowgli_workqueue_t;
+typedef struct _mowgli_workqueue_job mowgli_workqueue_job_t;
+
+/* runs on a worker thread */
+typedef void mowgli_workqueue_work_fn_t (void *arg);
+
+/* runs on the workqueue's eventloop once work_fn has returned, or with
+ * cancelled set if the job was cancelled before it started.
+ */
+typedef void mowgli_workqueue_done_fn_t (mowgli_workqueue_t * wq, void *arg, bool cancelled);
+
+typedef struct
+{
+	size_t queued;		/* waiting for a thread */
+	size_t running;
+	size_t completing;	/* finished, done_fn not called yet */
+	size_t queued_peak;
+
+	unsigned int threads;
+	unsigned int idle_threads;
+
+	unsigned long submitted;
+	unsigned long completed;
+	unsigned long cancelled;
+} mowgli_workqueue_stats_t;
+
+extern mowgli_workqueue_t *mowgli_workqueue_create(mowgli_eventloop_t *eventloop, unsigned int min_threads, unsigned int max_threads);
+extern void mowgli_workqueue_set_idle_timeout(mowgli_workqueue_t *wq, unsigned int msec);
+extern mowgli_workqueue_job_t *mowgli_workqueue_submit(mowgli_workqueue_t *wq, mowgli_workqueue_work_fn_t *work_fn, mowgli_workqueue_done_fn_t *done_fn, void *arg);
+extern bool mowgli_workqueue_cancel(mowgli_workqueue_t *wq, mowgli_workqueue_job_t *job);
+extern void mowgli_workqueue_get_stats(mowgli_workqueue_t *wq, mowgli_workqueue_stats_t *stats);
+extern void mowgli_workqueue_destroy(mowgli_workqueue_t *wq);
+
+#endif /* MOWGLI_SRC_LIBMOWGLI_THREAD_WORKQUEUE_H_INCLUDE_GUARD */
@@ -52,6 +52,16 @@ mowgli_vio_ops_t mowgli_vio_default_ops =
 	.close = mowgli_vio_default_close,
 	.seek = mowgli_vio_default_seek,
 	.tell = mowgli_vio_default_tell,
+	.readv = mowgli_vio_default_readv,
+	.writev = mowgli_vio_default_writev,
+	.sendfile = mowgli_vio_default_sendfile,
+	.recvmmsg = mowgli_vio_default_recvmmsg,
+	.sendmmsg = mowgli_vio_default_sendmmsg,
+	.acceptmany = mowgli_vio_default_acceptmany,
+	.sendfds = mowgli_vio_default_sendfds,
+	.recvfds = mowgli_vio_default_recvfds,
+	.flush = mowgli_vio_default_flush,
+	.pending = mowgli_vio_default_pending,
 };
 
 /* Null ops */
@@ -102,6 +112,7 @@ mowgli_vio_init(mowgli_vio_t *vio, void *userdata)
 	vio->ops = &mowgli_vio_default_ops;
 
 	vio->userdata = userdata;
+	vio->sockopts = NULL;
 }
 
 /* mowgli_vio_eventloop_attach - attach a VIO object to an eventloop
@@ -129,7 +140,8 @@ mowgli_vio_eventloop_attach(mowgli_vio_t *vio, mowgli_eventloop_t *eventloop, mo
 		vio->eventloop = eventloop;
 
 		/* You're probably going to want this */
-		mowgli_pollable_set_nonblocking(vio->io.e, true);
+		if (!mowgli_vio_hasflag(vio, MOWGLI_VIO_FLAGS_NONBLOCKING))
+			mowgli_pollable_set_nonblocking(vio->io.e, true);
 
 		if (evops)
 			vio->evops = evops;
@@ -179,7 +191,8 @@ mowgli_vio_destroy(mowgli_vio_t *vio)
 	if (vio->eventloop != NULL)
 		mowgli_vio_eventloop_detach(vio);
 
-	if (!MOWGLI_VIO_IS_CLOSED(vio))
+	/* a spare never given a descriptor, say, has nothing to close */
+	if (!MOWGLI_VIO_IS_CLOSED(vio) && (mowgli_vio_getfd(vio) != -1))
 		mowgli_vio_close(vio);
 
 	if (mowgli_vio_hasflag(vio, MOWGLI_VIO_FLAGS_ISONHEAP))
@@ -83,6 +83,25 @@ typedef struct _mowgli_vio_sockdata
 	uint16_t port;
 } mowgli_vio_sockdata_t;
 
+/* A datagram for mowgli_vio_recvmmsg() and mowgli_vio_sendmmsg(): buf
+ * holds size bytes and len is how many of them are the datagram (set on
+ * receipt), to or from addr.
+ *
+ * segsize is for UDP segmentation offload on Linux.  A datagram sent with
+ * it set goes out as datagrams of segsize bytes, bar the last, for the cost
+ * of one; elsewhere it is split up before sending.  On a socket with
+ * mowgli_vio_udp_gro() on, it is set on receipt when the kernel has joined
+ * several datagrams from one peer into buf this way, and 0 otherwise.
+ */
+typedef struct _mowgli_vio_dgram
+{
+	void *buf;
+	size_t size;
+	size_t len;
+	mowgli_vio_sockaddr_t addr;
+	uint16_t segsize;
+} mowgli_vio_dgram_t;
+
 /* Various typedefs bleh */
 typedef int mowgli_vio_func_t (mowgli_vio_t *);
 typedef int mowgli_vio_bind_connect_func_t (mowgli_vio_t *, mowgli_vio_sockaddr_t *);
@@ -95,6 +114,14 @@ typedef int mowgli_vio_accept_func_t (mowgli_vio_t *, mowgli_vio_t *);
 typedef int mowgli_vio_listen_func_t (mowgli_vio_t *, int);
 typedef int mowgli_vio_socket_func_t (mowgli_vio_t *, int, int, int);
 typedef int mowgli_vio_seek_func_t (mowgli_vio_t *, long, int);
+typedef int mowgli_vio_readv_func_t (mowgli_vio_t *, const struct iovec *, int);
+typedef int mowgli_vio_writev_func_t (mowgli_vio_t *, const struct iovec *, int);
+typedef int mowgli_vio_sendfile_func_t (mowgli_vio_t *, int, off_t *, size_t);
+typedef int mowgli_vio_recvmmsg_func_t (mowgli_vio_t *, mowgli_vio_dgram_t *, int);
+typedef int mowgli_vio_sendmmsg_func_t (mowgli_vio_t *, mowgli_vio_dgram_t *, int);
+typedef int mowgli_vio_acceptmany_func_t (mowgli_vio_t *, mowgli_vio_t **, int);
+typedef int mowgli_vio_sendfds_func_t (mowgli_vio_t *, const void *, size_t, const int *, int);
+typedef int mowgli_vio_recvfds_func_t (mowgli_vio_t *, void *, size_t, int *, int *);
 
 /* These are workalikes vis-a-vis the Berkeley sockets API */
 typedef struct
@@ -113,6 +140,53 @@ typedef struct
 	mowgli_vio_func_t *close;
 	mowgli_vio_seek_func_t *seek;
 	mowgli_vio_func_t *tell;
+
+	/* Like read and write, but scattering into or gathering from iovcnt
+	 * buffers in one go; a short count means the later ones were not
+	 * reached.  Kept last so older ops tables still line up.
+	 */
+	mowgli_vio_readv_func_t *readv;
+	mowgli_vio_writev_func_t *writev;
+
+	/* Send up to count bytes of the file fd, from *offset (which is then
+	 * moved on) or, if offset is NULL, from and moving on the file position.
+	 * Returns what write would: bytes sent, 0 if none could be for now, or
+	 * an error, which includes the file ending before count.
+	 */
+	mowgli_vio_sendfile_func_t *sendfile;
+
+	/* Like recvfrom and sendto, for up to count datagrams at a time.
+	 * Returns how many were received or sent, 0 if none could be for now,
+	 * or an error.
+	 */
+	mowgli_vio_recvmmsg_func_t *recvmmsg;
+	mowgli_vio_sendmmsg_func_t *sendmmsg;
+
+	/* Like accept, into newvios in turn until there are no more
+	 * connections waiting or count have been taken.  Returns how many
+	 * were, 0 if none were waiting, or an error if the first accept failed.
+	 */
+	mowgli_vio_acceptmany_func_t *acceptmany;
+
+	/* Like write and read, passing up to MOWGLI_VIO_MAX_FDS descriptors
+	 * over a UNIX socket with the data, of which there must be at least a
+	 * byte.  recvfds has room for *nfds and sets it to how many came; they
+	 * are the receiver's own, to close when done with.
+	 */
+	mowgli_vio_sendfds_func_t *sendfds;
+	mowgli_vio_recvfds_func_t *recvfds;
+
+	/* Push out whatever a layer is holding back.  Returns how many bytes
+	 * are still held, which the write callback should try again, or an
+	 * error; plain sockets hold nothing.
+	 */
+	mowgli_vio_func_t *flush;
+
+	/* How many bytes of input a layer has taken off the socket and not yet
+	 * handed out, which the eventloop will not wake anyone up for; plain
+	 * sockets hold none.
+	 */
+	mowgli_vio_func_t *pending;
 } mowgli_vio_ops_t;
 
 /* Callbacks for eventloop stuff */
@@ -122,6 +196,32 @@ typedef struct
 	mowgli_eventloop_io_cb_t *write_cb;
 } mowgli_vio_evops_t;
 
+/* Socket tuning, for mowgli_vio_set_sockopts().  Anything zero is left as
+ * the system has it, and options the system lacks are skipped.
+ */
+typedef struct _mowgli_vio_sockopts
+{
+	bool nodelay;	/* TCP_NODELAY: small writes go out at once */
+	bool cork;	/* linebufs cork the socket while flushing several writes */
+	int sndbuf;	/* SO_SNDBUF and SO_RCVBUF, in bytes */
+	int rcvbuf;
+	bool reuseport;	/* SO_REUSEPORT, for listeners sharing a port */
+	int defer_accept;	/* TCP_DEFER_ACCEPT: listeners wait up to this many seconds for data */
+	int fastopen;	/* TCP_FASTOPEN: listeners queue up to this many fast opens */
+	bool fastopen_connect;	/* TCP_FASTOPEN_CONNECT: clients send their first write with the SYN */
+	unsigned int user_timeout;	/* TCP_USER_TIMEOUT: ms data may go unacknowledged */
+	int keepalive_idle;	/* any of these turns SO_KEEPALIVE on: seconds idle, */
+	int keepalive_interval;	/* seconds between probes, */
+	int keepalive_count;	/* and probes unanswered before giving up */
+} mowgli_vio_sockopts_t;
+
+typedef enum
+{
+	MOWGLI_VIO_SOCKOPTS_DEFAULT = 0,	/* nothing changed */
+	MOWGLI_VIO_SOCKOPTS_LATENCY,	/* interactive traffic: nodelay, fast open for listeners */
+	MOWGLI_VIO_SOCKOPTS_THROUGHPUT,	/* bulk traffic: corked, full segments */
+} mowgli_vio_sockopts_profile_t;
+
 struct _mowgli_vio
 {
 	mowgli_vio_ops_t *ops;	/* VIO operations */
@@ -157,6 +257,8 @@ struct _mowgli_vio
 
 	void *userdata;	/* User data for VIO object */
 	void *privdata;	/* Private data for stuff like SSL */
+
+	const mowgli_vio_sockopts_t *sockopts;	/* Tuning applied to new sockets */
 };
 
 /* SSL settings... members subject to change */
@@ -166,8 +268,35 @@ typedef struct _mowgli_vio_ssl_settings
 	const char *privatekey_path;
 	int (*password_func)(char *, int, int, void *);
 	int (*verify_func)(int, void *);
+
+	/* Session resumption, fixed when a context is made: how many seconds
+	 * a session can be resumed for and how many are kept (0 leaves
+	 * OpenSSL's 300 and 20480; clients keep one per peer, up to
+	 * MOWGLI_VIO_SSL_CLIENT_SESSIONS), and whether a server keeps every
+	 * session itself instead of handing clients tickets.
+	 */
+	unsigned int session_timeout;
+	size_t session_cache_size;
+	bool no_tickets;
+
+	/* A context from mowgli_vio_openssl_context_create() to share.
+	 * Otherwise a listener makes its own, which the connections accepted
+	 * from it share, and clients share a default one.
+	 */
+	void *context;
+
+	/* Hand OpenSSL's record buffers back whenever a connection has nothing
+	 * in them.  Idle connections then cost a few KiB instead of tens, at
+	 * the price of taking the buffers again for every burst.
+	 */
+	bool lean;
 } mowgli_vio_ssl_settings_t;
 
+#define MOWGLI_VIO_SSL_CLIENT_SESSIONS 1024
+
+/* Most descriptors sendfds and recvfds take at once */
+#define MOWGLI_VIO_MAX_FDS 16
+
 /* Flags */
 #define MOWGLI_VIO_FLAGS_ISCONNECTING 0x00001
 #define MOWGLI_VIO_FLAGS_ISSSLCONNECTING 0x00002
@@ -181,6 +310,9 @@ typedef struct _mowgli_vio_ssl_settings
 #define MOWGLI_VIO_FLAGS_NEEDREAD 0x00040
 #define MOWGLI_VIO_FLAGS_NEEDWRITE 0x00080
 
+/* The descriptor came nonblocking, so attaching need not make it so */
+#define MOWGLI_VIO_FLAGS_NONBLOCKING 0x00100
+
 /* Flag setting/getting */
 static inline bool
 mowgli_vio_hasflag(mowgli_vio_t *vio, unsigned int flag)
@@ -220,7 +352,8 @@ mowgli_vio_getfd(mowgli_vio_t *vio)
 	mowgli_vio_setflag(v, MOWGLI_VIO_FLAGS_ISCLOSED, true);	\
 	mowgli_vio_setflag(v, MOWGLI_VIO_FLAGS_ISSSLCONNECTING, false);	\
 	mowgli_vio_setflag(v, MOWGLI_VIO_FLAGS_NEEDREAD, false); \
-	mowgli_vio_setflag(v, MOWGLI_VIO_FLAGS_NEEDWRITE, false)
+	mowgli_vio_setflag(v, MOWGLI_VIO_FLAGS_NEEDWRITE, false); \
+	mowgli_vio_setflag(v, MOWGLI_VIO_FLAGS_NONBLOCKING, false)
 
 #define MOWGLI_VIO_IS_CLOSED(v) mowgli_vio_hasflag(v, MOWGLI_VIO_FLAGS_ISCLOSED)
 
@@ -268,12 +401,81 @@ extern int mowgli_vio_default_error(mowgli_vio_t *vio);
 extern int mowgli_vio_default_close(mowgli_vio_t *vio);
 extern int mowgli_vio_default_seek(mowgli_vio_t *vio, long offset, int whence);
 extern int mowgli_vio_default_tell(mowgli_vio_t *vio);
+extern int mowgli_vio_default_readv(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt);
+extern int mowgli_vio_default_writev(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt);
+extern int mowgli_vio_default_sendfile(mowgli_vio_t *vio, int fd, off_t *offset, size_t count);
+extern int mowgli_vio_default_recvmmsg(mowgli_vio_t *vio, mowgli_vio_dgram_t *dgrams, int count);
+extern int mowgli_vio_default_sendmmsg(mowgli_vio_t *vio, mowgli_vio_dgram_t *dgrams, int count);
+extern int mowgli_vio_default_acceptmany(mowgli_vio_t *vio, mowgli_vio_t **newvios, int count);
+extern int mowgli_vio_default_sendfds(mowgli_vio_t *vio, const void *buffer, size_t len, const int *fds, int nfds);
+extern int mowgli_vio_default_recvfds(mowgli_vio_t *vio, void *buffer, size_t len, int *fds, int *nfds);
+extern int mowgli_vio_default_flush(mowgli_vio_t *vio);
+extern int mowgli_vio_default_pending(mowgli_vio_t *vio);
+
+/* Turn UDP receive offload on or off for a datagram socket; see
+ * mowgli_vio_dgram_t.  Needs Linux 5.0 or later.
+ */
+extern int mowgli_vio_udp_gro(mowgli_vio_t *vio, bool enable);
+
+/* Tune the socket now, if there is one, and every socket the VIO makes
+ * from here on; opts must outlive the VIO (the profiles do).  Connections
+ * accepted from a tuned listener carry its options over, from the kernel
+ * and in their sockopts.  Set before bind and listen for reuseport,
+ * defer_accept and fastopen to count.  fastopen_connect is left to the
+ * caller, as connect() then returns before the handshake: the connection
+ * is only made with the first write, which is where any connect error
+ * shows up, and a protocol whose server speaks first would never start.
+ */
+extern int mowgli_vio_set_sockopts(mowgli_vio_t *vio, const mowgli_vio_sockopts_t *opts);
+extern const mowgli_vio_sockopts_t *mowgli_vio_sockopts_profile(mowgli_vio_sockopts_profile_t profile);
+
+/* Hold back partial segments until uncorked (TCP_CORK, or TCP_NOPUSH) */
+extern int mowgli_vio_cork(mowgli_vio_t *vio, bool cork);
+
+/* helper.c: hand a connected socket, with up to MOWGLI_HELPER_HANDOFF_MAX
+ * bytes of data to go with it (whatever has been read from it already,
+ * say), to a helper over its socketpair.  Only the socket goes, so TLS
+ * VIOs cannot be; destroy the VIO once it has.  mowgli_helper_send_vio()
+ * returns 0 once sent, 1 if the socketpair is full and nothing went, to be
+ * tried again later or with another helper, or -1 on error.  In the
+ * helper, mowgli_helper_recv_vio() makes newvio the connection as an
+ * accept would, and the data is copied into buf, with *len its size going
+ * in and the data's on return, anything more being dropped.  It returns 1
+ * with a connection, 0 if none is waiting, or -1 if the parent is gone or
+ * the stream has broken.
+ */
+#define MOWGLI_HELPER_HANDOFF_MAX 4096
+
+extern int mowgli_helper_send_vio(mowgli_eventloop_helper_proc_t *helper, mowgli_vio_t *vio, const void *data, size_t len);
+extern int mowgli_helper_recv_vio(mowgli_eventloop_helper_proc_t *helper, mowgli_vio_t *newvio, void *buf, size_t *len);
+
+/* vio_buffered.c: a buffering layer over whatever ops the VIO has, TLS
+ * or another layer included, for callers making many small reads and
+ * writes on a stream.  Reads shorter than readahead take up to that much
+ * more in the same call, to be handed out before the next goes to the
+ * socket, so keep reading until a read returns 0, or check
+ * mowgli_vio_buffered_pending(), before waiting on the eventloop again.
+ * Writes are held while they fit in writebuf, until mowgli_vio_flush(),
+ * or until one does not fit and they all go together.  Either size may be
+ * 0.  Push after mowgli_vio_openssl_setssl(), not before; close flushes
+ * what it can and takes the layer off again.
+ */
+extern int mowgli_vio_buffered_push(mowgli_vio_t *vio, size_t readahead, size_t writebuf);
+extern size_t mowgli_vio_buffered_pending(mowgli_vio_t *vio);
 
 extern int mowgli_vio_err_errcode(mowgli_vio_t *vio, char *(*int_to_error)(int), int errcode);
 extern int mowgli_vio_err_sslerrcode(mowgli_vio_t *vio, unsigned long int errcode);
 
 extern int mowgli_vio_openssl_setssl(mowgli_vio_t *vio, mowgli_vio_ssl_settings_t *settings, mowgli_vio_ops_t *ops);
 
+/* A context holds the certificate and the session cache.  setssl takes a
+ * reference to the one in its settings, so the creator's can be dropped
+ * once the VIOs that want it are set up.  A server context needs cert_path
+ * and privatekey_path; a client one presents them if set.
+ */
+extern void *mowgli_vio_openssl_context_create(mowgli_vio_ssl_settings_t *settings, bool server);
+extern void mowgli_vio_openssl_context_unref(void *context);
+
 /* These are void ptr's so they can be null ops if SSL isn't available */
 extern void *mowgli_vio_openssl_getsslhandle(mowgli_vio_t *vio);
 extern void *mowgli_vio_openssl_getsslcontext(mowgli_vio_t *vio);
@@ -285,7 +487,10 @@ extern int mowgli_vio_openssl_default_listen(mowgli_vio_t *vio, int backlog);
 extern int mowgli_vio_openssl_default_accept(mowgli_vio_t *vio, mowgli_vio_t *newvio);
 extern int mowgli_vio_openssl_default_read(mowgli_vio_t *vio, void *buffer, size_t len);
 extern int mowgli_vio_openssl_default_write(mowgli_vio_t *vio, const void *buffer, size_t len);
+extern int mowgli_vio_openssl_default_readv(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt);
+extern int mowgli_vio_openssl_default_writev(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt);
 extern int mowgli_vio_openssl_default_close(mowgli_vio_t *vio);
+extern int mowgli_vio_openssl_default_pending(mowgli_vio_t *vio);
 
 #else
 #  define NOSSLSUPPORT { mowgli_log("Attempting to use default OpenSSL op with no SSL support; this will not work!"); return -255; }
@@ -295,7 +500,10 @@ static inline int mowgli_vio_openssl_default_listen(mowgli_vio_t *vio, int backl
 static inline int mowgli_vio_openssl_default_accept(mowgli_vio_t *vio, mowgli_vio_t *newvio) NOSSLSUPPORT
 static inline int mowgli_vio_openssl_default_read(mowgli_vio_t *vio, void *buffer, size_t len) NOSSLSUPPORT
 static inline int mowgli_vio_openssl_default_write(mowgli_vio_t *vio, const void *buffer, size_t len) NOSSLSUPPORT
+static inline int mowgli_vio_openssl_default_readv(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt) NOSSLSUPPORT
+static inline int mowgli_vio_openssl_default_writev(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt) NOSSLSUPPORT
 static inline int mowgli_vio_openssl_default_close(mowgli_vio_t *vio) NOSSLSUPPORT
+static inline int mowgli_vio_openssl_default_pending(mowgli_vio_t *vio) NOSSLSUPPORT
 
 #endif
 
@@ -313,12 +521,27 @@ extern mowgli_vio_evops_t mowgli_vio_default_evops;
 #define mowgli_vio_listen(vio, ...) vio->ops->listen(vio, __VA_ARGS__)
 #define mowgli_vio_bind(vio, ...) vio->ops->bind(vio, __VA_ARGS__)
 #define mowgli_vio_accept(vio, ...) vio->ops->accept(vio, __VA_ARGS__)
+#define mowgli_vio_acceptmany(vio, ...) (vio->ops->acceptmany != NULL ? vio->ops->acceptmany : mowgli_vio_default_acceptmany)(vio, __VA_ARGS__)
 #define mowgli_vio_reuseaddr(vio) vio->ops->reuseaddr(vio)
 #define mowgli_vio_connect(vio, ...) vio->ops->connect(vio, __VA_ARGS__)
 #define mowgli_vio_read(vio, ...) vio->ops->read(vio, __VA_ARGS__)
 #define mowgli_vio_write(vio, ...) vio->ops->write(vio, __VA_ARGS__)
+/* Ops tables filled in by hand may leave these NULL; the defaults then go
+ * through the table's read and write one buffer at a time.  The same goes
+ * for sendfile, the batched datagram ops and acceptmany, while descriptor
+ * passing is refused unless the table reads and writes the socket itself. */
+#define mowgli_vio_readv(vio, ...) (vio->ops->readv != NULL ? vio->ops->readv : mowgli_vio_default_readv)(vio, __VA_ARGS__)
+#define mowgli_vio_writev(vio, ...) (vio->ops->writev != NULL ? vio->ops->writev : mowgli_vio_default_writev)(vio, __VA_ARGS__)
+#define mowgli_vio_sendfile(vio, ...) (vio->ops->sendfile != NULL ? vio->ops->sendfile : mowgli_vio_default_sendfile)(vio, __VA_ARGS__)
 #define mowgli_vio_sendto(vio, ...) vio->ops->sendto(vio, __VA_ARGS__)
 #define mowgli_vio_recvfrom(vio, ...) vio->ops->recvfrom(vio, __VA_ARGS__)
+#define mowgli_vio_recvmmsg(vio, ...) (vio->ops->recvmmsg != NULL ? vio->ops->recvmmsg : mowgli_vio_default_recvmmsg)(vio, __VA_ARGS__)
+#define mowgli_vio_sendmmsg(vio, ...) (vio->ops->sendmmsg != NULL ? vio->ops->sendmmsg : mowgli_vio_default_sendmmsg)(vio, __VA_ARGS__)
+#define mowgli_vio_sendfds(vio, ...) (vio->ops->sendfds != NULL ? vio->ops->sendfds : mowgli_vio_default_sendfds)(vio, __VA_ARGS__)
+#define mowgli_vio_recvfds(vio, ...) (vio->ops->recvfds != NULL ? vio->ops->recvfds : mowgli_vio_default_recvfds)(vio, __VA_ARGS__)
+/* Likewise, without a flush op nothing is held back */
+#define mowgli_vio_flush(vio) (vio->ops->flush != NULL ? vio->ops->flush(vio) : 0)
+#define mowgli_vio_pending(vio) (vio->ops->pending != NULL ? vio->ops->pending(vio) : 0)
 #define mowgli_vio_error(vio) vio->ops->error(vio)
 #define mowgli_vio_close(vio) vio->ops->close(vio)
 #define mowgli_vio_seek(vio, ...) vio->ops->seek(vio, __VA_ARGS__)
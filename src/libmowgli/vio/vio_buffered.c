@@ -0,0 +1,399 @@
+/*
+ * libmowgli: A collection of useful routines for programming.
+ * vio_buffered.c: A buffering layer over any VIO ops
+ *
+ * Copyright (c) 2026 Atheme Project (http://atheme.org/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice is present in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mowgli.h"
+
+/* A layer is its own copy of the ops table it was pushed over, with the
+ * buffered ops swapped in, followed by the buffers; the VIO's ops pointer
+ * finds it, so layers stack without anything more in the VIO.  Calls down
+ * put the lower ops back for their duration, so that lower ops which go
+ * through the VIO's ops themselves (the readv and writev fallbacks, say)
+ * get their own and not ours.
+ */
+typedef struct
+{
+	mowgli_vio_ops_t ops;	/* must be first */
+	mowgli_vio_ops_t *lower;
+
+	char *rbuf;
+	size_t rsize, rpos, rlen;
+
+	char *wbuf;
+	size_t wsize, wlen;
+} mowgli_vio_buffered_t;
+
+/* Most iovecs a readv or writev is added to rather than split */
+#define MOWGLI_VIO_BUFFERED_IOV_MAX 64
+
+static inline mowgli_vio_buffered_t *
+mowgli_vio_buffered_layer(mowgli_vio_t *vio)
+{
+	return (mowgli_vio_buffered_t *) vio->ops;
+}
+
+static int
+mowgli_vio_buffered_lower_readv(mowgli_vio_t *vio, mowgli_vio_buffered_t *layer, const struct iovec *iov, int iovcnt)
+{
+	int ret;
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_readv(vio, iov, iovcnt);
+	vio->ops = &layer->ops;
+
+	return ret;
+}
+
+static int
+mowgli_vio_buffered_lower_write(mowgli_vio_t *vio, mowgli_vio_buffered_t *layer, const void *buffer, size_t len)
+{
+	int ret;
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_write(vio, buffer, len);
+	vio->ops = &layer->ops;
+
+	return ret;
+}
+
+static int
+mowgli_vio_buffered_lower_writev(mowgli_vio_t *vio, mowgli_vio_buffered_t *layer, const struct iovec *iov, int iovcnt)
+{
+	int ret;
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_writev(vio, iov, iovcnt);
+	vio->ops = &layer->ops;
+
+	return ret;
+}
+
+/* The layer below may have no sendfile or sendfds of its own, in which
+ * case there is nothing to pass the call down to.
+ */
+static int
+mowgli_vio_buffered_unsupported(mowgli_vio_t *vio, const char *what)
+{
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+	vio->error.type = MOWGLI_VIO_ERR_API;
+	snprintf(vio->error.string, sizeof(vio->error.string), "The layer below a buffered VIO has no %s", what);
+	return mowgli_vio_error(vio);
+}
+
+static int
+mowgli_vio_buffered_readv(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+	struct iovec riov[MOWGLI_VIO_BUFFERED_IOV_MAX + 1];
+	size_t want = 0, n;
+	int i, ret = 0;
+
+	/* What was read ahead comes out first, and on its own */
+	if (layer->rpos < layer->rlen)
+	{
+		for (i = 0; (i < iovcnt) && (layer->rpos < layer->rlen); i++)
+		{
+			n = MIN(iov[i].iov_len, layer->rlen - layer->rpos);
+			memcpy(iov[i].iov_base, layer->rbuf + layer->rpos, n);
+			layer->rpos += n;
+			ret += n;
+		}
+
+		if (layer->rpos == layer->rlen)
+			layer->rpos = layer->rlen = 0;
+
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, true);
+
+		return ret;
+	}
+
+	for (i = 0; i < iovcnt; i++)
+		want += iov[i].iov_len;
+
+	/* Big reads gain nothing from reading ahead */
+	if ((want >= layer->rsize) || (iovcnt > MOWGLI_VIO_BUFFERED_IOV_MAX))
+		return mowgli_vio_buffered_lower_readv(vio, layer, iov, iovcnt);
+
+	memcpy(riov, iov, iovcnt * sizeof *iov);
+	riov[iovcnt].iov_base = layer->rbuf;
+	riov[iovcnt].iov_len = layer->rsize;
+
+	if ((ret = mowgli_vio_buffered_lower_readv(vio, layer, riov, iovcnt + 1)) <= 0)
+		return ret;
+
+	if ((size_t) ret <= want)
+		return ret;
+
+	layer->rlen = ret - want;
+
+	return (int) want;
+}
+
+static int
+mowgli_vio_buffered_read(mowgli_vio_t *vio, void *buffer, size_t len)
+{
+	struct iovec iov = { buffer, len };
+
+	return mowgli_vio_buffered_readv(vio, &iov, 1);
+}
+
+/* Copy len bytes of iov, from skip bytes in, onto what is held */
+static void
+mowgli_vio_buffered_hold(mowgli_vio_buffered_t *layer, const struct iovec *iov, int iovcnt, size_t skip, size_t len)
+{
+	size_t n;
+	int i;
+
+	for (i = 0; (i < iovcnt) && (len > 0); i++)
+	{
+		if (skip >= iov[i].iov_len)
+		{
+			skip -= iov[i].iov_len;
+			continue;
+		}
+
+		n = MIN(iov[i].iov_len - skip, len);
+		memcpy(layer->wbuf + layer->wlen, (const char *) iov[i].iov_base + skip, n);
+		layer->wlen += n;
+		len -= n;
+		skip = 0;
+	}
+}
+
+static int
+mowgli_vio_buffered_flush(mowgli_vio_t *vio)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+	int ret;
+
+	while (layer->wlen > 0)
+	{
+		if ((ret = mowgli_vio_buffered_lower_write(vio, layer, layer->wbuf, layer->wlen)) <= 0)
+			return (ret < 0) ? ret : (int) layer->wlen;
+
+		memmove(layer->wbuf, layer->wbuf + ret, layer->wlen - ret);
+		layer->wlen -= ret;
+	}
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_flush(vio);
+	vio->ops = &layer->ops;
+
+	return ret;
+}
+
+/* What is read ahead here, and whatever the layer below holds besides */
+static int
+mowgli_vio_buffered_unread(mowgli_vio_t *vio)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+	int ret;
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_pending(vio);
+	vio->ops = &layer->ops;
+
+	return (int) (layer->rlen - layer->rpos) + ret;
+}
+
+/* A write that does not fit goes out in one go with what is held, and as
+ * much of what the socket would not take as fits is held in turn.  Held
+ * bytes count as written.
+ */
+static int
+mowgli_vio_buffered_writev(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+	struct iovec wiov[MOWGLI_VIO_BUFFERED_IOV_MAX + 1];
+	size_t want = 0, n;
+	int i, ret;
+
+	for (i = 0; i < iovcnt; i++)
+		want += iov[i].iov_len;
+
+	/* Nothing to write still gets a write, for the sake of TLS handshakes */
+	if ((want == 0) && (layer->wlen == 0))
+		return mowgli_vio_buffered_lower_write(vio, layer, "", 0);
+
+	if ((want > 0) && (layer->wlen + want <= layer->wsize))
+	{
+		mowgli_vio_buffered_hold(layer, iov, iovcnt, 0, want);
+		return (int) want;
+	}
+
+	if (iovcnt > MOWGLI_VIO_BUFFERED_IOV_MAX)
+	{
+		if ((ret = mowgli_vio_buffered_flush(vio)) != 0)
+			return (ret < 0) ? ret : 0;
+
+		return mowgli_vio_buffered_lower_writev(vio, layer, iov, iovcnt);
+	}
+
+	wiov[0].iov_base = layer->wbuf;
+	wiov[0].iov_len = layer->wlen;
+	memcpy(wiov + 1, iov, iovcnt * sizeof *iov);
+
+	if (layer->wlen > 0)
+		ret = mowgli_vio_buffered_lower_writev(vio, layer, wiov, iovcnt + 1);
+	else
+		ret = mowgli_vio_buffered_lower_writev(vio, layer, iov, iovcnt);
+
+	if (ret < 0)
+		return ret;
+
+	if ((size_t) ret < layer->wlen)
+	{
+		memmove(layer->wbuf, layer->wbuf + ret, layer->wlen - ret);
+		layer->wlen -= ret;
+		n = MIN(want, layer->wsize - layer->wlen);
+		mowgli_vio_buffered_hold(layer, iov, iovcnt, 0, n);
+
+		return (int) n;
+	}
+
+	ret -= layer->wlen;
+	layer->wlen = 0;
+
+	if (((n = want - ret) > 0) && (n <= layer->wsize))
+	{
+		mowgli_vio_buffered_hold(layer, iov, iovcnt, ret, n);
+		return (int) want;
+	}
+
+	return ret;
+}
+
+static int
+mowgli_vio_buffered_write(mowgli_vio_t *vio, const void *buffer, size_t len)
+{
+	struct iovec iov = { (void *) buffer, len };
+
+	return mowgli_vio_buffered_writev(vio, &iov, 1);
+}
+
+/* Files and descriptors go after what is held, or not yet */
+static int
+mowgli_vio_buffered_sendfile(mowgli_vio_t *vio, int fd, off_t *offset, size_t count)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+	int ret;
+
+	if (layer->lower->sendfile == NULL)
+		return mowgli_vio_buffered_unsupported(vio, "sendfile");
+
+	if ((ret = mowgli_vio_buffered_flush(vio)) != 0)
+		return (ret < 0) ? ret : 0;
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_sendfile(vio, fd, offset, count);
+	vio->ops = &layer->ops;
+
+	return ret;
+}
+
+static int
+mowgli_vio_buffered_sendfds(mowgli_vio_t *vio, const void *buffer, size_t len, const int *fds, int nfds)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+	int ret;
+
+	if (layer->lower->sendfds == NULL)
+		return mowgli_vio_buffered_unsupported(vio, "sendfds");
+
+	if ((ret = mowgli_vio_buffered_flush(vio)) != 0)
+		return (ret < 0) ? ret : 0;
+
+	vio->ops = layer->lower;
+	ret = mowgli_vio_sendfds(vio, buffer, len, fds, nfds);
+	vio->ops = &layer->ops;
+
+	return ret;
+}
+
+static int
+mowgli_vio_buffered_close(mowgli_vio_t *vio)
+{
+	mowgli_vio_buffered_t *layer = mowgli_vio_buffered_layer(vio);
+
+	if (!MOWGLI_VIO_IS_CLOSED(vio) && (layer->wlen > 0))
+		mowgli_vio_buffered_flush(vio);
+
+	vio->ops = layer->lower;
+
+	if (layer->rbuf != NULL)
+		mowgli_free(layer->rbuf);
+
+	if (layer->wbuf != NULL)
+		mowgli_free(layer->wbuf);
+
+	mowgli_free(layer);
+
+	return mowgli_vio_close(vio);
+}
+
+int
+mowgli_vio_buffered_push(mowgli_vio_t *vio, size_t readahead, size_t writebuf)
+{
+	mowgli_vio_buffered_t *layer;
+
+	return_val_if_fail(vio != NULL, -255);
+	return_val_if_fail((readahead <= INT_MAX) && (writebuf <= INT_MAX), -255);
+
+	layer = mowgli_alloc(sizeof *layer);
+	layer->lower = vio->ops;
+	memcpy(&layer->ops, vio->ops, sizeof layer->ops);
+
+	if ((layer->rsize = readahead) > 0)
+		layer->rbuf = mowgli_alloc(readahead);
+
+	if ((layer->wsize = writebuf) > 0)
+		layer->wbuf = mowgli_alloc(writebuf);
+
+	mowgli_vio_ops_set_op((&layer->ops), read, mowgli_vio_buffered_read);
+	mowgli_vio_ops_set_op((&layer->ops), readv, mowgli_vio_buffered_readv);
+	mowgli_vio_ops_set_op((&layer->ops), write, mowgli_vio_buffered_write);
+	mowgli_vio_ops_set_op((&layer->ops), writev, mowgli_vio_buffered_writev);
+	mowgli_vio_ops_set_op((&layer->ops), sendfile, mowgli_vio_buffered_sendfile);
+	mowgli_vio_ops_set_op((&layer->ops), sendfds, mowgli_vio_buffered_sendfds);
+	mowgli_vio_ops_set_op((&layer->ops), flush, mowgli_vio_buffered_flush);
+	mowgli_vio_ops_set_op((&layer->ops), pending, mowgli_vio_buffered_unread);
+	mowgli_vio_ops_set_op((&layer->ops), close, mowgli_vio_buffered_close);
+
+	vio->ops = &layer->ops;
+
+	return 0;
+}
+
+size_t
+mowgli_vio_buffered_pending(mowgli_vio_t *vio)
+{
+	mowgli_vio_buffered_t *layer;
+
+	return_val_if_fail(vio != NULL, 0);
+
+	if (vio->ops->read != mowgli_vio_buffered_read)
+		return 0;
+
+	layer = mowgli_vio_buffered_layer(vio);
+
+	return layer->rlen - layer->rpos;
+}
@@ -48,11 +48,35 @@
 #  endif
 #endif
 
+/* Most plaintext one TLS record carries */
+#define MOWGLI_VIO_SSL_RECORD 16384
+
+/* An SSL_CTX shared between listeners, the connections accepted from
+ * them and clients.  OpenSSL caches a server's sessions itself; a client's
+ * are kept here, one per peer, to offer when connecting there again.
+ */
+typedef struct
+{
+	SSL_CTX *ssl_context;
+	bool server;
+	unsigned int refs;
+	mowgli_patricia_t *sessions;
+	size_t max_sessions;
+} mowgli_ssl_context_t;
+
+typedef struct
+{
+	char peer[INET6_ADDRSTRLEN + 8];
+	SSL_SESSION *session;
+} mowgli_ssl_session_t;
+
 typedef struct
 {
 	SSL *ssl_handle;
 	SSL_CTX *ssl_context;
+	mowgli_ssl_context_t *context;
 	mowgli_vio_ssl_settings_t settings;
+	char peer[INET6_ADDRSTRLEN + 8];	/* clients: where the session is kept */
 } mowgli_ssl_connection_t;
 
 static int mowgli_vio_openssl_client_handshake(mowgli_vio_t *vio, mowgli_ssl_connection_t *connection);
@@ -64,6 +88,242 @@ static bool openssl_init = false;
 
 static mowgli_vio_ops_t *openssl_ops = NULL;
 
+static mowgli_ssl_context_t *default_client_context = NULL;
+
+static void
+mowgli_vio_openssl_init(void)
+{
+	if (!openssl_init)
+	{
+		openssl_init = true;
+		SSL_library_init();
+		SSL_load_error_strings();
+		ERR_load_BIO_strings();
+		OpenSSL_add_all_algorithms();
+	}
+}
+
+static bool
+mowgli_ssl_session_expired(SSL_SESSION *session)
+{
+	return (long) time(NULL) >= SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+}
+
+static void
+mowgli_ssl_session_destroy(const char *key, void *data, void *privdata)
+{
+	mowgli_ssl_session_t *entry = data;
+
+	SSL_SESSION_free(entry->session);
+	mowgli_free(entry);
+}
+
+/* A client has a new session, after the handshake or, with TLS 1.3, when
+ * a ticket turns up later; it replaces whatever was kept for the peer.
+ */
+static int
+mowgli_vio_openssl_new_session(SSL *ssl, SSL_SESSION *session)
+{
+	mowgli_ssl_connection_t *connection = SSL_get_app_data(ssl);
+	mowgli_ssl_context_t *context;
+	mowgli_ssl_session_t *entry;
+	mowgli_patricia_iteration_state_t state;
+
+	if ((connection == NULL) || (*connection->peer == '\0'))
+		return 0;
+
+	context = connection->context;
+
+	if ((entry = mowgli_patricia_retrieve(context->sessions, connection->peer)) != NULL)
+	{
+		SSL_SESSION_free(entry->session);
+		entry->session = session;
+		return 1;
+	}
+
+	if (mowgli_patricia_size(context->sessions) >= context->max_sessions)
+	{
+		MOWGLI_PATRICIA_FOREACH(entry, &state, context->sessions)
+		{
+			if (mowgli_ssl_session_expired(entry->session))
+			{
+				mowgli_patricia_delete(context->sessions, entry->peer);
+				mowgli_ssl_session_destroy(NULL, entry, NULL);
+			}
+		}
+
+		if (mowgli_patricia_size(context->sessions) >= context->max_sessions)
+			return 0;
+	}
+
+	entry = mowgli_alloc(sizeof *entry);
+	mowgli_strlcpy(entry->peer, connection->peer, sizeof(entry->peer));
+	entry->session = session;
+	mowgli_patricia_add(context->sessions, entry->peer, entry);
+
+	return 1;
+}
+
+static void
+mowgli_ssl_context_unref(mowgli_ssl_context_t *context)
+{
+	if (--context->refs > 0)
+		return;
+
+	if (context->sessions != NULL)
+		mowgli_patricia_destroy(context->sessions, mowgli_ssl_session_destroy, NULL);
+
+	SSL_CTX_free(context->ssl_context);
+	mowgli_free(context);
+}
+
+/* Leaves the reason in OpenSSL's error queue on failure */
+static mowgli_ssl_context_t *
+mowgli_ssl_context_create(mowgli_vio_ssl_settings_t *settings, bool server, void *userdata)
+{
+	mowgli_ssl_context_t *context;
+	SSL_CTX *ssl_context;
+
+	mowgli_vio_openssl_init();
+
+#ifndef MOWGLI_HAVE_OPENSSL_TLS_METHOD_API
+	ssl_context = SSL_CTX_new(server ? SSLv23_server_method() : SSLv23_client_method());
+#else
+	ssl_context = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+#endif
+
+	if (ssl_context == NULL)
+		return NULL;
+
+	context = mowgli_alloc(sizeof *context);
+	context->ssl_context = ssl_context;
+	context->server = server;
+	context->refs = 1;
+
+#ifndef MOWGLI_HAVE_OPENSSL_TLS_METHOD_API
+#  ifdef SSL_OP_NO_SSLv2
+	SSL_CTX_set_options(ssl_context, SSL_OP_NO_SSLv2);
+#  endif
+#  ifdef SSL_OP_NO_SSLv3
+	SSL_CTX_set_options(ssl_context, SSL_OP_NO_SSLv3);
+#  endif
+#endif
+
+	SSL_CTX_set_mode(ssl_context, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+	if (settings->session_timeout != 0)
+		SSL_CTX_set_timeout(ssl_context, settings->session_timeout);
+
+	if (server)
+	{
+		SSL_CTX_set_options(ssl_context, SSL_OP_SINGLE_DH_USE);
+
+#ifdef OPENSSL_EC_AVAILABLE
+#  ifdef MOWGLI_HAVE_OPENSSL_ECDH_AUTO
+		SSL_CTX_set_ecdh_auto(ssl_context, 1);
+#  else
+
+		EC_KEY *ec_key_p256 = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+
+		if (ec_key_p256 != NULL)
+		{
+			SSL_CTX_set_tmp_ecdh(ssl_context, ec_key_p256);
+			EC_KEY_free(ec_key_p256);
+			ec_key_p256 = NULL;
+		}
+
+#  endif
+#  ifdef SSL_OP_SINGLE_ECDH_USE
+		SSL_CTX_set_options(ssl_context, SSL_OP_SINGLE_ECDH_USE);
+#  endif
+#endif
+
+		SSL_CTX_set_session_id_context(ssl_context, (const unsigned char *) "libmowgli", 9);
+		SSL_CTX_set_session_cache_mode(ssl_context, SSL_SESS_CACHE_SERVER);
+
+		if (settings->session_cache_size != 0)
+			SSL_CTX_sess_set_cache_size(ssl_context, settings->session_cache_size);
+
+		if (settings->no_tickets)
+			SSL_CTX_set_options(ssl_context, SSL_OP_NO_TICKET);
+	}
+	else
+	{
+		SSL_CTX_set_session_cache_mode(ssl_context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(ssl_context, mowgli_vio_openssl_new_session);
+
+		context->sessions = mowgli_patricia_create(NULL);
+		context->max_sessions = settings->session_cache_size != 0 ? settings->session_cache_size : MOWGLI_VIO_SSL_CLIENT_SESSIONS;
+	}
+
+	if (settings->password_func)
+	{
+		SSL_CTX_set_default_passwd_cb(ssl_context, settings->password_func);
+		SSL_CTX_set_default_passwd_cb_userdata(ssl_context, userdata);
+	}
+
+	if (server || (settings->cert_path != NULL))
+	{
+		if ((SSL_CTX_use_certificate_file(ssl_context, settings->cert_path, SSL_FILETYPE_PEM) != 1) ||
+		    (SSL_CTX_use_PrivateKey_file(ssl_context, settings->privatekey_path, SSL_FILETYPE_PEM) != 1))
+		{
+			mowgli_ssl_context_unref(context);
+			return NULL;
+		}
+	}
+
+	return context;
+}
+
+void *
+mowgli_vio_openssl_context_create(mowgli_vio_ssl_settings_t *settings, bool server)
+{
+	mowgli_vio_ssl_settings_t defaults;
+	mowgli_ssl_context_t *context;
+	char buf[128];
+
+	if (settings == NULL)
+	{
+		memset(&defaults, 0, sizeof defaults);
+		settings = &defaults;
+	}
+
+	if ((context = mowgli_ssl_context_create(settings, server, NULL)) == NULL)
+	{
+		ERR_error_string_n(ERR_get_error(), buf, sizeof buf);
+		mowgli_log("Unable to create SSL context: %s", buf);
+	}
+
+	return context;
+}
+
+void
+mowgli_vio_openssl_context_unref(void *context)
+{
+	return_if_fail(context != NULL);
+
+	mowgli_ssl_context_unref(context);
+}
+
+static void
+mowgli_ssl_connection_set_lean(mowgli_ssl_connection_t *connection)
+{
+	if (!connection->settings.lean)
+		return;
+
+#ifdef SSL_MODE_RELEASE_BUFFERS
+	SSL_set_mode(connection->ssl_handle, SSL_MODE_RELEASE_BUFFERS);
+#endif
+}
+
+static int
+mowgli_ssl_context_wrong_side(mowgli_vio_t *vio, bool server)
+{
+	vio->error.type = MOWGLI_VIO_ERR_API;
+	mowgli_strlcpy(vio->error.string, server ? "SSL context is for clients" : "SSL context is for servers", sizeof(vio->error.string));
+	return mowgli_vio_error(vio);
+}
+
 int
 mowgli_vio_openssl_setssl(mowgli_vio_t *vio, mowgli_vio_ssl_settings_t *settings, mowgli_vio_ops_t *ops)
 {
@@ -80,6 +340,9 @@ mowgli_vio_openssl_setssl(mowgli_vio_t *vio, mowgli_vio_ssl_settings_t *settings
 	if (settings)
 		memcpy(&connection->settings, settings, sizeof(mowgli_vio_ssl_settings_t));
 
+	if ((connection->context = connection->settings.context) != NULL)
+		connection->context->refs++;
+
 	if (ops == NULL)
 	{
 		if (!openssl_ops)
@@ -99,19 +362,15 @@ mowgli_vio_openssl_setssl(mowgli_vio_t *vio, mowgli_vio_ssl_settings_t *settings
 	mowgli_vio_ops_set_op(vio->ops, connect, mowgli_vio_openssl_default_connect);
 	mowgli_vio_ops_set_op(vio->ops, read, mowgli_vio_openssl_default_read);
 	mowgli_vio_ops_set_op(vio->ops, write, mowgli_vio_openssl_default_write);
+	mowgli_vio_ops_set_op(vio->ops, readv, mowgli_vio_openssl_default_readv);
+	mowgli_vio_ops_set_op(vio->ops, writev, mowgli_vio_openssl_default_writev);
 	mowgli_vio_ops_set_op(vio->ops, close, mowgli_vio_openssl_default_close);
 	mowgli_vio_ops_set_op(vio->ops, accept, mowgli_vio_openssl_default_accept);
 	mowgli_vio_ops_set_op(vio->ops, listen, mowgli_vio_openssl_default_listen);
+	mowgli_vio_ops_set_op(vio->ops, pending, mowgli_vio_openssl_default_pending);
 
 	/* SSL setup */
-	if (!openssl_init)
-	{
-		openssl_init = true;
-		SSL_library_init();
-		SSL_load_error_strings();
-		ERR_load_BIO_strings();
-		OpenSSL_add_all_algorithms();
-	}
+	mowgli_vio_openssl_init();
 
 	return 0;
 }
@@ -144,6 +403,10 @@ mowgli_vio_openssl_default_connect(mowgli_vio_t *vio, mowgli_vio_sockaddr_t *add
 
 	vio->error.op = MOWGLI_VIO_ERR_OP_CONNECT;
 
+	/* Wanted for the handshake, whenever that comes */
+	memcpy(&vio->addr.addr, &addr->addr, addr->addrlen);
+	vio->addr.addrlen = addr->addrlen;
+
 	if (connect(fd, (struct sockaddr *) &addr->addr, addr->addrlen) < 0)
 	{
 		if (!mowgli_eventloop_ignore_errno(errno))
@@ -159,9 +422,6 @@ mowgli_vio_openssl_default_connect(mowgli_vio_t *vio, mowgli_vio_sockaddr_t *add
 		}
 	}
 
-	memcpy(&vio->addr.addr, &addr->addr, addr->addrlen);
-	vio->addr.addrlen = addr->addrlen;
-
 	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCLIENT, true);
 	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISSERVER, false);
 
@@ -180,63 +440,25 @@ mowgli_vio_openssl_default_listen(mowgli_vio_t *vio, int backlog)
 
 	vio->error.op = MOWGLI_VIO_ERR_OP_LISTEN;
 
-#ifndef MOWGLI_HAVE_OPENSSL_TLS_METHOD_API
-	connection->ssl_context = SSL_CTX_new(SSLv23_server_method());
-#else
-	connection->ssl_context = SSL_CTX_new(TLS_server_method());
-#endif
-
-	if (connection->ssl_context == NULL)
-		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
+	if (connection->context == NULL)
+	{
+		connection->context = mowgli_ssl_context_create(&connection->settings, true, vio->userdata);
 
-#ifndef MOWGLI_HAVE_OPENSSL_TLS_METHOD_API
-#  ifdef SSL_OP_NO_SSLv2
-	SSL_CTX_set_options(connection->ssl_context, SSL_OP_NO_SSLv2);
-#  endif
-#  ifdef SSL_OP_NO_SSLv3
-	SSL_CTX_set_options(connection->ssl_context, SSL_OP_NO_SSLv3);
-#  endif
-#endif
+		if (connection->context == NULL)
+			return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
+	}
+	else if (!connection->context->server)
+	{
+		return mowgli_ssl_context_wrong_side(vio, true);
+	}
 
+	connection->ssl_context = connection->context->ssl_context;
 	connection->ssl_handle = SSL_new(connection->ssl_context);
 
 	if (connection->ssl_handle == NULL)
 		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
 
 	SSL_set_accept_state(connection->ssl_handle);
-	SSL_CTX_set_options(connection->ssl_context, SSL_OP_SINGLE_DH_USE);
-
-#ifdef OPENSSL_EC_AVAILABLE
-#  ifdef MOWGLI_HAVE_OPENSSL_ECDH_AUTO
-	SSL_CTX_set_ecdh_auto(connection->ssl_context, 1);
-#  else
-
-	EC_KEY *ec_key_p256 = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
-
-	if (ec_key_p256 != NULL)
-	{
-		SSL_CTX_set_tmp_ecdh(connection->ssl_context, ec_key_p256);
-		EC_KEY_free(ec_key_p256);
-		ec_key_p256 = NULL;
-	}
-
-#  endif
-#  ifdef SSL_OP_SINGLE_ECDH_USE
-	SSL_CTX_set_options(connection->ssl_context, SSL_OP_SINGLE_ECDH_USE);
-#  endif
-#endif
-
-	if (connection->settings.password_func)
-	{
-		SSL_CTX_set_default_passwd_cb(connection->ssl_context, connection->settings.password_func);
-		SSL_CTX_set_default_passwd_cb_userdata(connection->ssl_context, vio->userdata);
-	}
-
-	if (SSL_CTX_use_certificate_file(connection->ssl_context, connection->settings.cert_path, SSL_FILETYPE_PEM) != 1)
-		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
-
-	if (SSL_CTX_use_PrivateKey_file(connection->ssl_context, connection->settings.privatekey_path, SSL_FILETYPE_PEM) != 1)
-		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
 
 	if (listen(fd, backlog) != 0)
 		return mowgli_vio_err_errcode(vio, strerror, errno);
@@ -281,15 +503,39 @@ mowgli_vio_openssl_default_accept(mowgli_vio_t *vio, mowgli_vio_t *newvio)
 	}
 
 	newvio->io.fd = afd;
+	newvio->sockopts = vio->sockopts;
+
+	/* The handshake is driven by reads and writes on the new connection from
+	 * here on; waiting for the client's half of it now would stall everyone
+	 * else.
+	 */
+#if defined(HAVE_FCNTL)
+	fcntl(afd, F_SETFL, fcntl(afd, F_GETFL) | O_NONBLOCK);
+#elif defined(HAVE_WINSOCK2_H)
+	{
+		u_long mode = 1;
+
+		ioctlsocket(afd, FIONBIO, &mode);
+	}
+#endif
 
 	mowgli_vio_openssl_setssl(newvio, &connection->settings, vio->ops);
 	newconnection = newvio->privdata;
+
+	if (newconnection->context == NULL)
+	{
+		newconnection->context = connection->context;
+		newconnection->context->refs++;
+	}
+
 	newconnection->ssl_context = connection->ssl_context;
 	newconnection->ssl_handle = SSL_new(newconnection->ssl_context);
 
 	if (!SSL_set_fd(newconnection->ssl_handle, afd))
 		return mowgli_vio_err_sslerrcode(newvio, ERR_get_error());
 
+	mowgli_ssl_connection_set_lean(newconnection);
+
 	if ((ret = SSL_accept(newconnection->ssl_handle)) != 1)
 	{
 		unsigned long err;
@@ -297,12 +543,12 @@ mowgli_vio_openssl_default_accept(mowgli_vio_t *vio, mowgli_vio_t *newvio)
 		switch (SSL_get_error(newconnection->ssl_handle, ret))
 		{
 		case SSL_ERROR_WANT_READ:
-			mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, true);
-			MOWGLI_VIO_SETREAD(vio)
+			mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_NEEDREAD, true);
+			MOWGLI_VIO_SETREAD(newvio)
 			return 0;
 		case SSL_ERROR_WANT_WRITE:
-			mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
-			MOWGLI_VIO_SETWRITE(vio)
+			mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+			MOWGLI_VIO_SETWRITE(newvio)
 			return 0;
 		case SSL_ERROR_ZERO_RETURN:
 			return 0;
@@ -337,36 +583,63 @@ mowgli_vio_openssl_client_handshake(mowgli_vio_t *vio, mowgli_ssl_connection_t *
 
 	vio->error.op = MOWGLI_VIO_ERR_OP_CONNECT;
 
-#ifndef MOWGLI_HAVE_OPENSSL_TLS_METHOD_API
-	connection->ssl_context = SSL_CTX_new(SSLv23_client_method());
-#else
-	connection->ssl_context = SSL_CTX_new(TLS_client_method());
-#endif
+	if (connection->ssl_handle == NULL)
+	{
+		mowgli_ssl_session_t *entry;
+		mowgli_vio_sockdata_t peer;
 
-	if (connection->ssl_context == NULL)
-		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
+		if (connection->context == NULL)
+		{
+			static mowgli_vio_ssl_settings_t defaults;
 
-#ifndef MOWGLI_HAVE_OPENSSL_TLS_METHOD_API
-#  ifdef SSL_OP_NO_SSLv2
-	SSL_CTX_set_options(connection->ssl_context, SSL_OP_NO_SSLv2);
-#  endif
-#  ifdef SSL_OP_NO_SSLv3
-	SSL_CTX_set_options(connection->ssl_context, SSL_OP_NO_SSLv3);
-#  endif
-#endif
+			if ((default_client_context == NULL) &&
+			    ((default_client_context = mowgli_ssl_context_create(&defaults, false, NULL)) == NULL))
+				return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
 
-	connection->ssl_handle = SSL_new(connection->ssl_context);
+			connection->context = default_client_context;
+			connection->context->refs++;
+		}
+		else if (connection->context->server)
+		{
+			return mowgli_ssl_context_wrong_side(vio, false);
+		}
 
-	if (connection->ssl_handle == NULL)
-		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
+		connection->ssl_context = connection->context->ssl_context;
+		connection->ssl_handle = SSL_new(connection->ssl_context);
 
-	SSL_set_connect_state(connection->ssl_handle);
+		if (connection->ssl_handle == NULL)
+			return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
 
-	if (!SSL_set_fd(connection->ssl_handle, fd))
-		return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
+		SSL_set_app_data(connection->ssl_handle, connection);
+		SSL_set_connect_state(connection->ssl_handle);
+
+		if (!SSL_set_fd(connection->ssl_handle, fd))
+			return mowgli_vio_err_sslerrcode(vio, ERR_get_error());
+
+		if (vio->eventloop)
+			SSL_set_mode(connection->ssl_handle, SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+		mowgli_ssl_connection_set_lean(connection);
+
+		/* Offer the last session with this peer */
+		if ((connection->context->sessions != NULL) && (mowgli_vio_sockaddr_info(&vio->addr, &peer) == 0))
+		{
+			snprintf(connection->peer, sizeof(connection->peer), "%s/%hu", peer.host, peer.port);
 
-	if (vio->eventloop)
-		SSL_CTX_set_mode(connection->ssl_context, SSL_MODE_ENABLE_PARTIAL_WRITE);
+			if ((entry = mowgli_patricia_retrieve(connection->context->sessions, connection->peer)) != NULL)
+			{
+				if (mowgli_ssl_session_expired(entry->session))
+				{
+					mowgli_patricia_delete(connection->context->sessions, entry->peer);
+					mowgli_ssl_session_destroy(NULL, entry, NULL);
+				}
+				else
+				{
+					SSL_set_session(connection->ssl_handle, entry->session);
+				}
+			}
+		}
+	}
 
 	if ((ret = SSL_connect(connection->ssl_handle)) != 1)
 	{
@@ -420,6 +693,107 @@ mowgli_vio_openssl_default_write(mowgli_vio_t *vio, const void *buffer, size_t l
 	return mowgli_openssl_read_or_write(MOWGLI_VIO_SSL_DOWRITE, vio, NULL, buffer, len);
 }
 
+/* Only carry on into the next buffer while OpenSSL has decrypted input in
+ * hand; going back to the socket for more would most likely come up empty.
+ */
+int
+mowgli_vio_openssl_default_readv(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
+{
+	mowgli_ssl_connection_t *connection = vio->privdata;
+	size_t off;
+	int i, ret, total = 0;
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_READ;
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		for (off = 0; off < iov[i].iov_len; off += ret)
+		{
+			if ((total > 0) && ((connection->ssl_handle == NULL) || (SSL_pending(connection->ssl_handle) == 0)))
+				return total;
+
+			ret = mowgli_openssl_read_or_write(MOWGLI_VIO_SSL_DOREAD, vio, (char *) iov[i].iov_base + off, NULL, iov[i].iov_len - off);
+
+			if (ret <= 0)
+				return (total > 0) ? total : ret;
+
+			total += ret;
+		}
+	}
+
+	return total;
+}
+
+/* Decrypted input from a record only partly read so far */
+int
+mowgli_vio_openssl_default_pending(mowgli_vio_t *vio)
+{
+	mowgli_ssl_connection_t *connection = vio->privdata;
+
+	if ((connection == NULL) || (connection->ssl_handle == NULL))
+		return 0;
+
+	return SSL_pending(connection->ssl_handle);
+}
+
+/* SSL_write() puts each call in a record of its own, with its own header,
+ * MAC and padding, so small buffers are gathered into full-sized records
+ * first; big ones go straight through.  A record built here may be retried
+ * from a different place, which SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER allows.
+ */
+int
+mowgli_vio_openssl_default_writev(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
+{
+	char record[MOWGLI_VIO_SSL_RECORD];
+	const char *buf;
+	size_t len, take, off = 0;
+	int i = 0, ret, total = 0;
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+
+	while (i < iovcnt)
+	{
+		if (iov[i].iov_len - off >= sizeof record)
+		{
+			buf = (const char *) iov[i].iov_base + off;
+			len = iov[i].iov_len - off;
+			i++;
+			off = 0;
+		}
+		else
+		{
+			for (len = 0; (i < iovcnt) && (len < sizeof record); )
+			{
+				take = MIN(iov[i].iov_len - off, sizeof record - len);
+				memcpy(record + len, (const char *) iov[i].iov_base + off, take);
+				len += take;
+				off += take;
+
+				if (off == iov[i].iov_len)
+				{
+					i++;
+					off = 0;
+				}
+			}
+
+			buf = record;
+		}
+
+		if (len == 0)
+			continue;
+
+		if ((ret = mowgli_openssl_read_or_write(MOWGLI_VIO_SSL_DOWRITE, vio, NULL, buf, len)) <= 0)
+			return (total > 0) ? total : ret;
+
+		total += ret;
+
+		if ((size_t) ret < len)
+			break;
+	}
+
+	return total;
+}
+
 static int
 mowgli_openssl_read_or_write(bool read, mowgli_vio_t *vio, void *readbuf, const void *writebuf, size_t len)
 {
@@ -504,7 +878,7 @@ mowgli_vio_openssl_default_close(mowgli_vio_t *vio)
 
 	SSL_shutdown(connection->ssl_handle);
 	SSL_free(connection->ssl_handle);
-	SSL_CTX_free(connection->ssl_context);
+	mowgli_ssl_context_unref(connection->context);
 
 	mowgli_heap_free(ssl_heap, connection);
 
@@ -538,4 +912,16 @@ mowgli_vio_openssl_getsslcontext(mowgli_vio_t *vio)
 	return NULL;
 }
 
+void *
+mowgli_vio_openssl_context_create(mowgli_vio_ssl_settings_t *settings, bool server)
+{
+	mowgli_log("Cannot create an SSL context as libmowgli was built without OpenSSL support");
+	return NULL;
+}
+
+void
+mowgli_vio_openssl_context_unref(void *context)
+{
+}
+
 #endif
@@ -21,8 +21,41 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE 1	/* recvmmsg(), sendmmsg(), splice(), accept4() */
+#endif
+
 #include "mowgli.h"
 
+#if defined(__linux__)
+# include <netinet/udp.h>
+# include <sys/sendfile.h>
+
+# ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
+#endif
+
+#ifndef _WIN32
+# include <netinet/tcp.h>
+# include <sys/un.h>
+#endif
+
+#ifndef MSG_CMSG_CLOEXEC
+# define MSG_CMSG_CLOEXEC 0
+#endif
+
+/* Most mowgli_vio_default_sendfile() reads at a time when it has to copy */
+#define MOWGLI_VIO_SENDFILE_CHUNK 16384
+
+/* Most datagrams handed to recvmmsg() or sendmmsg() at once */
+#define MOWGLI_VIO_MMSG_MAX 64
+
+static int mowgli_vio_sockopts_apply(int fd, const mowgli_vio_sockopts_t *opts, int type);
+
 int
 mowgli_vio_default_socket(mowgli_vio_t *vio, int family, int type, int proto)
 {
@@ -41,6 +74,9 @@ mowgli_vio_default_socket(mowgli_vio_t *vio, int family, int type, int proto)
 
 	vio->io.fd = fd;
 
+	if ((vio->sockopts != NULL) && (mowgli_vio_sockopts_apply(fd, vio->sockopts, type) != 0))
+		return mowgli_vio_err_errcode(vio, strerror, errno);
+
 	if (type == SOCK_STREAM)
 	{
 		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
@@ -116,6 +152,7 @@ mowgli_vio_default_accept(mowgli_vio_t *vio, mowgli_vio_t *newvio)
 	}
 
 	newvio->io.fd = afd;
+	newvio->sockopts = vio->sockopts;
 
 	/* The new VIO object is most certainly not a server */
 	mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_ISCLIENT, true);
@@ -125,6 +162,87 @@ mowgli_vio_default_accept(mowgli_vio_t *vio, mowgli_vio_t *newvio)
 	return 0;
 }
 
+/* Accept one at a time with whatever accept op the VIO has */
+static int
+mowgli_vio_acceptmany_each(mowgli_vio_t *vio, mowgli_vio_t **newvios, int count)
+{
+	int i, ret;
+
+	for (i = 0; i < count; i++)
+	{
+		if ((ret = mowgli_vio_accept(vio, newvios[i])) != 0)
+			return (i > 0) ? i : ret;
+
+		if (mowgli_vio_getfd(newvios[i]) == -1)
+			break;
+	}
+
+	return i;
+}
+
+/* The new descriptors come nonblocking and close-on-exec: from accept4()
+ * where there is one (as there is wherever SOCK_NONBLOCK is), otherwise
+ * with fcntl().  An error after the first connection is left for the next
+ * call to run into.
+ */
+int
+mowgli_vio_default_acceptmany(mowgli_vio_t *vio, mowgli_vio_t **newvios, int count)
+{
+	const int fd = mowgli_vio_getfd(vio);
+	mowgli_vio_t *newvio;
+	int i, afd;
+
+	if (vio->ops->accept != mowgli_vio_default_accept)
+		return mowgli_vio_acceptmany_each(vio, newvios, count);
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_ACCEPT;
+
+	for (i = 0; i < count; i++)
+	{
+		newvio = newvios[i];
+		newvio->addr.addrlen = sizeof(newvio->addr.addr);
+
+#if defined(SOCK_NONBLOCK) && defined(SOCK_CLOEXEC)
+		afd = accept4(fd, (struct sockaddr *) &newvio->addr.addr, &newvio->addr.addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+		afd = accept(fd, (struct sockaddr *) &newvio->addr.addr, &newvio->addr.addrlen);
+#endif
+
+		if (afd < 0)
+		{
+			if ((i == 0) && !mowgli_eventloop_ignore_errno(errno))
+				return mowgli_vio_err_errcode(vio, strerror, errno);
+
+			break;
+		}
+
+#if !(defined(SOCK_NONBLOCK) && defined(SOCK_CLOEXEC))
+# if defined(HAVE_FCNTL)
+		fcntl(afd, F_SETFL, fcntl(afd, F_GETFL) | O_NONBLOCK);
+		fcntl(afd, F_SETFD, FD_CLOEXEC);
+# elif defined(HAVE_WINSOCK2_H)
+		{
+			u_long mode = 1;
+
+			ioctlsocket(afd, FIONBIO, &mode);
+		}
+# endif
+#endif
+
+		newvio->io.fd = afd;
+		newvio->sockopts = vio->sockopts;
+
+		mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_ISCLIENT, true);
+		mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_ISSERVER, false);
+		mowgli_vio_setflag(newvio, MOWGLI_VIO_FLAGS_NONBLOCKING, true);
+	}
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return i;
+}
+
 int
 mowgli_vio_default_reuseaddr(mowgli_vio_t *vio)
 {
@@ -250,53 +368,73 @@ mowgli_vio_default_write(mowgli_vio_t *vio, const void *buffer, size_t len)
 	return ret;
 }
 
-int
-mowgli_vio_default_sendto(mowgli_vio_t *vio, const void *buffer, size_t len, mowgli_vio_sockaddr_t *addr)
+/* One buffer at a time through the read or write op, for when those have
+ * been replaced by something the system calls would go around, and for
+ * Windows, which has no readv() or writev().
+ */
+static int
+mowgli_vio_readv_each(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
 {
-	const int fd = mowgli_vio_getfd(vio);
-	int ret;
-
-	return_val_if_fail(fd != -1, -255);
+	int i, ret, total = 0;
 
-	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+	for (i = 0; i < iovcnt; i++)
+	{
+		if (iov[i].iov_len == 0)
+			continue;
 
-	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+		if ((ret = mowgli_vio_read(vio, iov[i].iov_base, iov[i].iov_len)) <= 0)
+			return (total > 0) ? total : ret;
 
-	if ((ret = (int) sendto(fd, buffer, len, 0, (struct sockaddr *) &addr->addr, addr->addrlen)) == -1)
-	{
-		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, false);
-		MOWGLI_VIO_UNSETWRITE(vio)
+		total += ret;
 
-		if (!mowgli_eventloop_ignore_errno(errno))
-			return mowgli_vio_err_errcode(vio, strerror, errno);
-		else
-			/* Further writes unnecessary */
-			return 0;
+		if ((size_t) ret < iov[i].iov_len)
+			break;
 	}
 
-	if (ret < (int) len)
+	return total;
+}
+
+static int
+mowgli_vio_writev_each(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
+{
+	int i, ret, total = 0;
+
+	for (i = 0; i < iovcnt; i++)
 	{
-		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
-		MOWGLI_VIO_SETWRITE(vio)
+		if (iov[i].iov_len == 0)
+			continue;
+
+		if ((ret = mowgli_vio_write(vio, iov[i].iov_base, iov[i].iov_len)) <= 0)
+			return (total > 0) ? total : ret;
+
+		total += ret;
+
+		if ((size_t) ret < iov[i].iov_len)
+			break;
 	}
 
-	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
-	return ret;
+	return total;
 }
 
 int
-mowgli_vio_default_recvfrom(mowgli_vio_t *vio, void *buffer, size_t len, mowgli_vio_sockaddr_t *addr)
+mowgli_vio_default_readv(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
 {
 	const int fd = mowgli_vio_getfd(vio);
 	int ret;
 
+#ifdef _WIN32
+	return mowgli_vio_readv_each(vio, iov, iovcnt);
+#else
+	if (vio->ops->read != mowgli_vio_default_read)
+		return mowgli_vio_readv_each(vio, iov, iovcnt);
+
 	return_val_if_fail(fd != -1, -255);
 
 	vio->error.op = MOWGLI_VIO_ERR_OP_READ;
 
 	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
 
-	if ((ret = (int) recvfrom(fd, buffer, len, 0, (struct sockaddr *) &addr->addr, &addr->addrlen)) <= 0)
+	if ((ret = (int) readv(fd, iov, iovcnt)) <= 0)
 	{
 		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, false);
 
@@ -305,7 +443,6 @@ mowgli_vio_default_recvfrom(mowgli_vio_t *vio, void *buffer, size_t len, mowgli_
 			if (!mowgli_eventloop_ignore_errno(errno))
 				return mowgli_vio_err_errcode(vio, strerror, errno);
 			else if (errno != 0)
-				/* Further reads unnecessary */
 				return 0;
 		}
 		else
@@ -323,169 +460,907 @@ mowgli_vio_default_recvfrom(mowgli_vio_t *vio, void *buffer, size_t len, mowgli_
 
 	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
 	return ret;
+#endif
 }
 
 int
-mowgli_vio_default_error(mowgli_vio_t *vio)
+mowgli_vio_default_writev(mowgli_vio_t *vio, const struct iovec *iov, int iovcnt)
 {
-	const char *errtype;
+	const int fd = mowgli_vio_getfd(vio);
+	size_t len = 0;
+	int i, ret;
 
-	switch (vio->error.op)
-	{
-	case MOWGLI_VIO_ERR_OP_READ:
-		errtype = "Read";
-		break;
-	case MOWGLI_VIO_ERR_OP_WRITE:
-		errtype = "Write";
-		break;
-	case MOWGLI_VIO_ERR_OP_LISTEN:
-		errtype = "Listen";
-		break;
-	case MOWGLI_VIO_ERR_OP_ACCEPT:
-		errtype = "Accept";
-		break;
-	case MOWGLI_VIO_ERR_OP_CONNECT:
-		errtype = "Connect";
-		break;
-	case MOWGLI_VIO_ERR_OP_SOCKET:
-		errtype = "Socket";
-		break;
-	case MOWGLI_VIO_ERR_OP_BIND:
-		errtype = "Bind";
-		break;
-	case MOWGLI_VIO_ERR_OP_OTHER:
-		errtype = "Application";
-		break;
-	default:
-		errtype = "Generic/Unknown";
-	}
+#ifdef _WIN32
+	return mowgli_vio_writev_each(vio, iov, iovcnt);
+#else
+	if (vio->ops->write != mowgli_vio_default_write)
+		return mowgli_vio_writev_each(vio, iov, iovcnt);
 
-	mowgli_log("%s error: %s\n", errtype, vio->error.string);
+	return_val_if_fail(fd != -1, -255);
 
-	return -1;
-}
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
 
-int
-mowgli_vio_default_close(mowgli_vio_t *vio)
-{
-	const int fd = mowgli_vio_getfd(vio);
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
 
-	return_val_if_fail(fd != -1, -255);
+	if ((ret = (int) writev(fd, iov, iovcnt)) == -1)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, false);
+		MOWGLI_VIO_UNSETWRITE(vio)
 
-	MOWGLI_VIO_SET_CLOSED(vio);
-#ifndef _WIN32
-	close(fd);
-#else
-	closesocket(fd);
+		if (!mowgli_eventloop_ignore_errno(errno))
+			return mowgli_vio_err_errcode(vio, strerror, errno);
+		else
+			return 0;
+	}
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+
+	if ((size_t) ret < len)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+		MOWGLI_VIO_SETWRITE(vio)
+	}
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
 #endif
-	return 0;
 }
 
-int
-mowgli_vio_default_seek(mowgli_vio_t *vio, long offset, int whence)
+static int
+mowgli_vio_sendfile_eof(mowgli_vio_t *vio)
 {
-	return_val_if_fail(vio, -255);
-	vio->error.op = MOWGLI_VIO_ERR_OP_SEEK;
-	errno = ENOSYS;
-	return mowgli_vio_err_errcode(vio, strerror, errno);
+	vio->error.type = MOWGLI_VIO_ERR_CUSTOM;
+	mowgli_strlcpy(vio->error.string, "File ended before all of it was sent", sizeof(vio->error.string));
+	return mowgli_vio_error(vio);
 }
 
-int
-mowgli_vio_default_tell(mowgli_vio_t *vio)
+/* Read the file into memory and hand it to the write op, for when data
+ * has to go through that (TLS, say) or the kernel can't send it for us.
+ * Reads are at an explicit position, so whatever a short write leaves
+ * behind is simply read again next time.
+ */
+static int
+mowgli_vio_sendfile_copy(mowgli_vio_t *vio, int fd, off_t *offset, size_t count)
 {
-	return_val_if_fail(vio, -255);
-	vio->error.op = MOWGLI_VIO_ERR_OP_TELL;
-	errno = ENOSYS;
-	return mowgli_vio_err_errcode(vio, strerror, errno);
-}
+	char buf[MOWGLI_VIO_SENDFILE_CHUNK];
+	off_t pos;
+	ssize_t n;
+	int ret, total = 0;
 
-/* Generate a mowgli_sockaddr_t struct */
-mowgli_vio_sockaddr_t *
-mowgli_vio_sockaddr_create(mowgli_vio_sockaddr_t *naddr, int proto, const char *addr, int port)
-{
-	struct sockaddr_storage saddr;
+	if ((pos = (offset != NULL) ? *offset : lseek(fd, 0, SEEK_CUR)) == -1)
+		return mowgli_vio_err_errcode(vio, strerror, errno);
 
-	return_val_if_fail(naddr, NULL);
-	return_val_if_fail(addr, NULL);
+	while ((count > 0) && (total <= INT_MAX - (int) sizeof buf))
+	{
+#ifdef _WIN32
+		if (lseek(fd, pos, SEEK_SET) == -1)
+			n = -1;
+		else
+			n = read(fd, buf, MIN(count, sizeof buf));
+#else
+		n = pread(fd, buf, MIN(count, sizeof buf), pos);
+#endif
 
-	if (naddr == NULL)
-		naddr = mowgli_alloc(sizeof *naddr);
+		if (n <= 0)
+		{
+			if (total > 0)
+				break;
 
-	if (proto == AF_INET)
-	{
-		struct sockaddr_in *addr_in = (struct sockaddr_in *) &saddr;
+			vio->error.op = MOWGLI_VIO_ERR_OP_READ;
 
-		addr_in->sin_family = proto;
-		addr_in->sin_port = htons(port);
+			return (n == 0) ? mowgli_vio_sendfile_eof(vio) : mowgli_vio_err_errcode(vio, strerror, errno);
+		}
 
-		if (addr != NULL)
-			if (inet_pton(proto, addr, &addr_in->sin_addr) != 1)
-				mowgli_log("Error with inet_pton!");
+		if ((ret = mowgli_vio_write(vio, buf, n)) <= 0)
+		{
+			if (total > 0)
+				break;
 
-		memcpy(&naddr->addr, &saddr, sizeof(struct sockaddr_in));
-		naddr->addrlen = sizeof(struct sockaddr_in);
-	}
-	else if (proto == AF_INET6)
-	{
-		struct sockaddr_in6 *addr_in6 = (struct sockaddr_in6 *) &saddr;
+			if (ret == 0)
+			{
+				mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+				MOWGLI_VIO_SETWRITE(vio)
+			}
 
-		addr_in6->sin6_family = proto;
-		addr_in6->sin6_port = htons(port);
+			return ret;
+		}
 
-		if (addr != NULL)
-			if (inet_pton(proto, addr, &addr_in6->sin6_addr) != 1)
-				mowgli_log("Error with inet_pton!");
+		pos += ret;
+		total += ret;
+		count -= ret;
 
-		memcpy(&naddr->addr, &saddr, sizeof(struct sockaddr_in6));
-		naddr->addrlen = sizeof(struct sockaddr_in6);
+		if (ret < n)
+			break;
 	}
+
+	if (offset != NULL)
+		*offset = pos;
 	else
-	{
-		naddr = NULL;
-	}
+		lseek(fd, pos, SEEK_SET);
 
-	return naddr;
+	return total;
 }
 
-mowgli_vio_sockaddr_t *
-mowgli_vio_sockaddr_from_struct(mowgli_vio_sockaddr_t *naddr, const void *addr, socklen_t size)
+/* On Linux the kernel moves the data itself: sendfile() from anything it
+ * can map, such as a regular file, or splice() from a pipe.  Anything else
+ * is copied.  Unlike write, a send that has to wait leaves the evops write
+ * callback set, so a transfer can carry itself on from the eventloop.
+ */
+int
+mowgli_vio_default_sendfile(mowgli_vio_t *vio, int fd, off_t *offset, size_t count)
 {
-	const struct sockaddr_storage *saddr = addr;
-
-	return_val_if_fail(addr != NULL, NULL);
-	return_val_if_fail(saddr->ss_family == AF_INET || saddr->ss_family == AF_INET6, NULL);
+#if defined(__linux__)
+	const int sockfd = mowgli_vio_getfd(vio);
+	struct stat st;
+	ssize_t ret;
 
-	if (naddr == NULL)
-		naddr = mowgli_alloc(sizeof *naddr);
+	if (vio->ops->write != mowgli_vio_default_write)
+		return mowgli_vio_sendfile_copy(vio, fd, offset, count);
 
-	memcpy(&naddr->addr, saddr, size);
-	naddr->addrlen = size;
+	return_val_if_fail(sockfd != -1, -255);
 
-	return naddr;
-}
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
 
-int
-mowgli_vio_sockaddr_info(const mowgli_vio_sockaddr_t *addr, mowgli_vio_sockdata_t *data)
-{
-	const void *sockptr;
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
 
-	return_val_if_fail(addr, -255);
-	return_val_if_fail(data, -255);
+	count = MIN(count, INT_MAX);
 
-	const struct sockaddr *saddr = (const struct sockaddr *) &addr->addr;
+	if ((offset == NULL) && (fstat(fd, &st) == 0) && S_ISFIFO(st.st_mode))
+		ret = splice(fd, NULL, sockfd, NULL, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	else
+		ret = sendfile(sockfd, fd, offset, count);
 
-	if (saddr->sa_family == AF_INET)
+	if (ret == -1)
 	{
-		const struct sockaddr_in *saddr4 = (const struct sockaddr_in *) &addr->addr;
-		data->port = ntohs(saddr4->sin_port);
-		sockptr = &saddr4->sin_addr;
+		if ((errno == EINVAL) || (errno == ENOSYS))
+			return mowgli_vio_sendfile_copy(vio, fd, offset, count);
+
+		if (!mowgli_eventloop_ignore_errno(errno))
+		{
+			mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, false);
+			MOWGLI_VIO_UNSETWRITE(vio)
+			return mowgli_vio_err_errcode(vio, strerror, errno);
+		}
+
+		/* carry on once there is room */
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+		MOWGLI_VIO_SETWRITE(vio)
+		return 0;
 	}
-	else if (saddr->sa_family == AF_INET6)
+
+	if ((ret == 0) && (count > 0))
+		return mowgli_vio_sendfile_eof(vio);
+
+	if ((size_t) ret < count)
 	{
-		const struct sockaddr_in6 *saddr6 = (const struct sockaddr_in6 *) &addr->addr;
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+		MOWGLI_VIO_SETWRITE(vio)
+	}
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return (int) ret;
+#else
+	return mowgli_vio_sendfile_copy(vio, fd, offset, count);
+#endif
+}
+
+int
+mowgli_vio_default_sendto(mowgli_vio_t *vio, const void *buffer, size_t len, mowgli_vio_sockaddr_t *addr)
+{
+	const int fd = mowgli_vio_getfd(vio);
+	int ret;
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+
+	if ((ret = (int) sendto(fd, buffer, len, 0, (struct sockaddr *) &addr->addr, addr->addrlen)) == -1)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, false);
+		MOWGLI_VIO_UNSETWRITE(vio)
+
+		if (!mowgli_eventloop_ignore_errno(errno))
+			return mowgli_vio_err_errcode(vio, strerror, errno);
+		else
+			/* Further writes unnecessary */
+			return 0;
+	}
+
+	if (ret < (int) len)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+		MOWGLI_VIO_SETWRITE(vio)
+	}
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
+}
+
+int
+mowgli_vio_default_recvfrom(mowgli_vio_t *vio, void *buffer, size_t len, mowgli_vio_sockaddr_t *addr)
+{
+	const int fd = mowgli_vio_getfd(vio);
+	int ret;
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_READ;
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+
+	if ((ret = (int) recvfrom(fd, buffer, len, 0, (struct sockaddr *) &addr->addr, &addr->addrlen)) <= 0)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, false);
+
+		if (ret < 0)
+		{
+			if (!mowgli_eventloop_ignore_errno(errno))
+				return mowgli_vio_err_errcode(vio, strerror, errno);
+			else if (errno != 0)
+				/* Further reads unnecessary */
+				return 0;
+		}
+		else
+		{
+			vio->error.type = MOWGLI_VIO_ERR_REMOTE_HANGUP;
+			mowgli_strlcpy(vio->error.string, "Remote host closed the socket", sizeof(vio->error.string));
+
+			MOWGLI_VIO_SET_CLOSED(vio);
+
+			return mowgli_vio_error(vio);
+		}
+	}
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, true);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
+}
+
+/* Without an eventloop the socket may well block, so only the first
+ * datagram is waited for.
+ */
+static int
+mowgli_vio_recvmmsg_each(mowgli_vio_t *vio, mowgli_vio_dgram_t *dgrams, int count)
+{
+	int i, ret;
+
+	for (i = 0; i < count; i++)
+	{
+		dgrams[i].addr.addrlen = sizeof(dgrams[i].addr.addr);
+		dgrams[i].segsize = 0;
+
+		if ((ret = mowgli_vio_recvfrom(vio, dgrams[i].buf, dgrams[i].size, &dgrams[i].addr)) <= 0)
+			return (i > 0) ? i : ret;
+
+		dgrams[i].len = ret;
+
+		if (vio->eventloop == NULL)
+			return 1;
+	}
+
+	return i;
+}
+
+/* Datagrams with segsize set are sent a segment at a time.  If only some
+ * of one go, buf and len are moved past those so they are not sent twice.
+ */
+static int
+mowgli_vio_sendmmsg_each(mowgli_vio_t *vio, mowgli_vio_dgram_t *dgrams, int count)
+{
+	size_t n;
+	int i, ret;
+
+	for (i = 0; i < count; i++)
+	{
+		for (;;)
+		{
+			n = dgrams[i].len;
+
+			if ((dgrams[i].segsize > 0) && (n > dgrams[i].segsize))
+				n = dgrams[i].segsize;
+
+			if (((ret = mowgli_vio_sendto(vio, dgrams[i].buf, n, &dgrams[i].addr)) < 0) || ((ret == 0) && (n > 0)))
+				return (i > 0) ? i : ret;
+
+			if (n == dgrams[i].len)
+				break;
+
+			dgrams[i].buf = (char *) dgrams[i].buf + n;
+			dgrams[i].len -= n;
+		}
+	}
+
+	return i;
+}
+
+int
+mowgli_vio_default_recvmmsg(mowgli_vio_t *vio, mowgli_vio_dgram_t *dgrams, int count)
+{
+#if defined(__linux__)
+	const int fd = mowgli_vio_getfd(vio);
+	struct mmsghdr msgs[MOWGLI_VIO_MMSG_MAX];
+	struct iovec iov[MOWGLI_VIO_MMSG_MAX];
+	union
+	{
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} ctl[MOWGLI_VIO_MMSG_MAX];
+	struct cmsghdr *cmsg;
+	int i, gso, ret;
+
+	if (vio->ops->recvfrom != mowgli_vio_default_recvfrom)
+		return mowgli_vio_recvmmsg_each(vio, dgrams, count);
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_READ;
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+
+	count = MIN(count, MOWGLI_VIO_MMSG_MAX);
+	memset(msgs, 0, count * sizeof msgs[0]);
+
+	for (i = 0; i < count; i++)
+	{
+		iov[i].iov_base = dgrams[i].buf;
+		iov[i].iov_len = dgrams[i].size;
+
+		msgs[i].msg_hdr.msg_name = &dgrams[i].addr.addr;
+		msgs[i].msg_hdr.msg_namelen = sizeof(dgrams[i].addr.addr);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = ctl[i].buf;
+		msgs[i].msg_hdr.msg_controllen = sizeof(ctl[i].buf);
+	}
+
+	/* MSG_WAITFORONE: on a blocking socket, wait for the first only */
+	if ((ret = recvmmsg(fd, msgs, count, MSG_WAITFORONE, NULL)) == -1)
+	{
+		if (errno == ENOSYS)
+			return mowgli_vio_recvmmsg_each(vio, dgrams, count);
+
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, false);
+
+		if (!mowgli_eventloop_ignore_errno(errno))
+			return mowgli_vio_err_errcode(vio, strerror, errno);
+		else
+			return 0;
+	}
+
+	for (i = 0; i < ret; i++)
+	{
+		dgrams[i].len = msgs[i].msg_len;
+		dgrams[i].addr.addrlen = msgs[i].msg_hdr.msg_namelen;
+		dgrams[i].segsize = 0;
+
+		for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+		{
+			if ((cmsg->cmsg_level == IPPROTO_UDP) && (cmsg->cmsg_type == UDP_GRO))
+			{
+				memcpy(&gso, CMSG_DATA(cmsg), sizeof gso);
+				dgrams[i].segsize = gso;
+			}
+		}
+	}
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, true);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
+#else
+	return mowgli_vio_recvmmsg_each(vio, dgrams, count);
+#endif
+}
+
+int
+mowgli_vio_default_sendmmsg(mowgli_vio_t *vio, mowgli_vio_dgram_t *dgrams, int count)
+{
+#if defined(__linux__)
+	const int fd = mowgli_vio_getfd(vio);
+	struct mmsghdr msgs[MOWGLI_VIO_MMSG_MAX];
+	struct iovec iov[MOWGLI_VIO_MMSG_MAX];
+	union
+	{
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} ctl[MOWGLI_VIO_MMSG_MAX];
+	struct cmsghdr *cmsg;
+	bool segmented = false;
+	int i, ret;
+
+	if (vio->ops->sendto != mowgli_vio_default_sendto)
+		return mowgli_vio_sendmmsg_each(vio, dgrams, count);
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+
+	count = MIN(count, MOWGLI_VIO_MMSG_MAX);
+	memset(msgs, 0, count * sizeof msgs[0]);
+
+	for (i = 0; i < count; i++)
+	{
+		iov[i].iov_base = dgrams[i].buf;
+		iov[i].iov_len = dgrams[i].len;
+
+		msgs[i].msg_hdr.msg_name = &dgrams[i].addr.addr;
+		msgs[i].msg_hdr.msg_namelen = dgrams[i].addr.addrlen;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+
+		if ((dgrams[i].segsize > 0) && (dgrams[i].len > dgrams[i].segsize))
+		{
+			msgs[i].msg_hdr.msg_control = ctl[i].buf;
+			msgs[i].msg_hdr.msg_controllen = sizeof(ctl[i].buf);
+
+			cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+			cmsg->cmsg_level = IPPROTO_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			memcpy(CMSG_DATA(cmsg), &dgrams[i].segsize, sizeof(uint16_t));
+
+			segmented = true;
+		}
+	}
+
+	if ((ret = sendmmsg(fd, msgs, count, 0)) == -1)
+	{
+		/* Too old a kernel, or more than it will segment in one go */
+		if ((errno == ENOSYS) || (segmented && ((errno == EINVAL) || (errno == ENOPROTOOPT) || (errno == EIO))))
+			return mowgli_vio_sendmmsg_each(vio, dgrams, count);
+
+		if (!mowgli_eventloop_ignore_errno(errno))
+		{
+			mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, false);
+			MOWGLI_VIO_UNSETWRITE(vio)
+			return mowgli_vio_err_errcode(vio, strerror, errno);
+		}
+
+		ret = 0;
+	}
+
+	if (ret < count)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+		MOWGLI_VIO_SETWRITE(vio)
+	}
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
+#else
+	return mowgli_vio_sendmmsg_each(vio, dgrams, count);
+#endif
+}
+
+int
+mowgli_vio_udp_gro(mowgli_vio_t *vio, bool enable)
+{
+	const int fd = mowgli_vio_getfd(vio);
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_OTHER;
+
+#if defined(__linux__)
+	int on = enable;
+
+	if (setsockopt(fd, IPPROTO_UDP, UDP_GRO, &on, sizeof on) == -1)
+		return mowgli_vio_err_errcode(vio, strerror, errno);
+#else
+	if (enable)
+	{
+		vio->error.type = MOWGLI_VIO_ERR_CUSTOM;
+		mowgli_strlcpy(vio->error.string, "UDP receive offload is not supported here", sizeof(vio->error.string));
+		return mowgli_vio_error(vio);
+	}
+#endif
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return 0;
+}
+
+/* Descriptors go as they are, so the data has to as well */
+static int
+mowgli_vio_fds_unsupported(mowgli_vio_t *vio)
+{
+	vio->error.type = MOWGLI_VIO_ERR_API;
+	mowgli_strlcpy(vio->error.string, "Descriptors can only be passed over a plain UNIX socket", sizeof(vio->error.string));
+	return mowgli_vio_error(vio);
+}
+
+int
+mowgli_vio_default_sendfds(mowgli_vio_t *vio, const void *buffer, size_t len, const int *fds, int nfds)
+{
+#ifndef _WIN32
+	const int fd = mowgli_vio_getfd(vio);
+	union
+	{
+		struct cmsghdr hdr;
+		char buf[CMSG_SPACE(sizeof(int) * MOWGLI_VIO_MAX_FDS)];
+	} control;
+	struct iovec iov = { (void *) buffer, len };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	int ret;
+
+	return_val_if_fail(fd != -1, -255);
+	return_val_if_fail(len > 0, -255);
+	return_val_if_fail((nfds >= 0) && (nfds <= MOWGLI_VIO_MAX_FDS), -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+
+	if (vio->ops->write != mowgli_vio_default_write)
+		return mowgli_vio_fds_unsupported(vio);
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+
+	memset(&msg, 0, sizeof msg);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	if (nfds > 0)
+	{
+		memset(&control, 0, sizeof control);
+		msg.msg_control = control.buf;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+	}
+
+	if ((ret = (int) sendmsg(fd, &msg, 0)) == -1)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, false);
+		MOWGLI_VIO_UNSETWRITE(vio)
+
+		if (!mowgli_eventloop_ignore_errno(errno))
+			return mowgli_vio_err_errcode(vio, strerror, errno);
+		else
+			/* Nothing went, descriptors included */
+			return 0;
+	}
+
+	/* the descriptors went with the first byte */
+	if (ret < (int) len)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDWRITE, true);
+		MOWGLI_VIO_SETWRITE(vio)
+	}
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
+#else
+	vio->error.op = MOWGLI_VIO_ERR_OP_WRITE;
+	return mowgli_vio_fds_unsupported(vio);
+#endif
+}
+
+int
+mowgli_vio_default_recvfds(mowgli_vio_t *vio, void *buffer, size_t len, int *fds, int *nfds)
+{
+#ifndef _WIN32
+	const int fd = mowgli_vio_getfd(vio);
+	union
+	{
+		struct cmsghdr hdr;
+		char buf[CMSG_SPACE(sizeof(int) * MOWGLI_VIO_MAX_FDS)];
+	} control;
+	struct iovec iov = { buffer, len };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	int i, n, room, got = 0, ret;
+
+	return_val_if_fail(fd != -1, -255);
+	return_val_if_fail(nfds != NULL, -255);
+	return_val_if_fail((*nfds >= 0) && (*nfds <= MOWGLI_VIO_MAX_FDS), -255);
+
+	room = *nfds;
+	*nfds = 0;
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_READ;
+
+	if (vio->ops->read != mowgli_vio_default_read)
+		return mowgli_vio_fds_unsupported(vio);
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_ISCONNECTING, false);
+
+	memset(&msg, 0, sizeof msg);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	if (room > 0)
+	{
+		msg.msg_control = control.buf;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * room);
+	}
+
+	if ((ret = (int) recvmsg(fd, &msg, MSG_CMSG_CLOEXEC)) <= 0)
+	{
+		mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, false);
+
+		if (ret < 0)
+		{
+			if (!mowgli_eventloop_ignore_errno(errno))
+				return mowgli_vio_err_errcode(vio, strerror, errno);
+			else if (errno != 0)
+				/* Further reads unnecessary */
+				return 0;
+		}
+		else
+		{
+			vio->error.type = MOWGLI_VIO_ERR_REMOTE_HANGUP;
+			mowgli_strlcpy(vio->error.string, "Remote host closed the socket", sizeof(vio->error.string));
+
+			MOWGLI_VIO_SET_CLOSED(vio);
+
+			return mowgli_vio_error(vio);
+		}
+	}
+
+	/* CMSG_SPACE() rounds up, so there may be one more than was asked for */
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS))
+			continue;
+
+		n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+		for (i = 0; i < n; i++)
+		{
+			int rfd;
+
+			memcpy(&rfd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof rfd);
+
+			if (got < room)
+				fds[got++] = rfd;
+			else
+				close(rfd);
+		}
+	}
+
+	*nfds = got;
+
+	if (msg.msg_flags & MSG_CTRUNC)
+		mowgli_log("VIO object [%p] was sent more descriptors than it had room for; the rest were dropped", (void *) vio);
+
+	mowgli_vio_setflag(vio, MOWGLI_VIO_FLAGS_NEEDREAD, true);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return ret;
+#else
+	vio->error.op = MOWGLI_VIO_ERR_OP_READ;
+	*nfds = 0;
+	return mowgli_vio_fds_unsupported(vio);
+#endif
+}
+
+/* Nothing is held back without a layer on top */
+int
+mowgli_vio_default_flush(mowgli_vio_t *vio)
+{
+	return 0;
+}
+
+int
+mowgli_vio_default_pending(mowgli_vio_t *vio)
+{
+	return 0;
+}
+
+int
+mowgli_vio_default_error(mowgli_vio_t *vio)
+{
+	const char *errtype;
+
+	switch (vio->error.op)
+	{
+	case MOWGLI_VIO_ERR_OP_READ:
+		errtype = "Read";
+		break;
+	case MOWGLI_VIO_ERR_OP_WRITE:
+		errtype = "Write";
+		break;
+	case MOWGLI_VIO_ERR_OP_LISTEN:
+		errtype = "Listen";
+		break;
+	case MOWGLI_VIO_ERR_OP_ACCEPT:
+		errtype = "Accept";
+		break;
+	case MOWGLI_VIO_ERR_OP_CONNECT:
+		errtype = "Connect";
+		break;
+	case MOWGLI_VIO_ERR_OP_SOCKET:
+		errtype = "Socket";
+		break;
+	case MOWGLI_VIO_ERR_OP_BIND:
+		errtype = "Bind";
+		break;
+	case MOWGLI_VIO_ERR_OP_OTHER:
+		errtype = "Application";
+		break;
+	default:
+		errtype = "Generic/Unknown";
+	}
+
+	mowgli_log("%s error: %s\n", errtype, vio->error.string);
+
+	return -1;
+}
+
+int
+mowgli_vio_default_close(mowgli_vio_t *vio)
+{
+	const int fd = mowgli_vio_getfd(vio);
+
+	return_val_if_fail(fd != -1, -255);
+
+	MOWGLI_VIO_SET_CLOSED(vio);
+#ifndef _WIN32
+	close(fd);
+#else
+	closesocket(fd);
+#endif
+	return 0;
+}
+
+int
+mowgli_vio_default_seek(mowgli_vio_t *vio, long offset, int whence)
+{
+	return_val_if_fail(vio, -255);
+	vio->error.op = MOWGLI_VIO_ERR_OP_SEEK;
+	errno = ENOSYS;
+	return mowgli_vio_err_errcode(vio, strerror, errno);
+}
+
+int
+mowgli_vio_default_tell(mowgli_vio_t *vio)
+{
+	return_val_if_fail(vio, -255);
+	vio->error.op = MOWGLI_VIO_ERR_OP_TELL;
+	errno = ENOSYS;
+	return mowgli_vio_err_errcode(vio, strerror, errno);
+}
+
+/* Generate a mowgli_sockaddr_t struct */
+mowgli_vio_sockaddr_t *
+mowgli_vio_sockaddr_create(mowgli_vio_sockaddr_t *naddr, int proto, const char *addr, int port)
+{
+	struct sockaddr_storage saddr;
+
+	return_val_if_fail(naddr, NULL);
+	return_val_if_fail(addr, NULL);
+
+	if (naddr == NULL)
+		naddr = mowgli_alloc(sizeof *naddr);
+
+	if (proto == AF_INET)
+	{
+		struct sockaddr_in *addr_in = (struct sockaddr_in *) &saddr;
+
+		addr_in->sin_family = proto;
+		addr_in->sin_port = htons(port);
+
+		if (addr != NULL)
+			if (inet_pton(proto, addr, &addr_in->sin_addr) != 1)
+				mowgli_log("Error with inet_pton!");
+
+		memcpy(&naddr->addr, &saddr, sizeof(struct sockaddr_in));
+		naddr->addrlen = sizeof(struct sockaddr_in);
+	}
+	else if (proto == AF_INET6)
+	{
+		struct sockaddr_in6 *addr_in6 = (struct sockaddr_in6 *) &saddr;
+
+		addr_in6->sin6_family = proto;
+		addr_in6->sin6_port = htons(port);
+
+		if (addr != NULL)
+			if (inet_pton(proto, addr, &addr_in6->sin6_addr) != 1)
+				mowgli_log("Error with inet_pton!");
+
+		memcpy(&naddr->addr, &saddr, sizeof(struct sockaddr_in6));
+		naddr->addrlen = sizeof(struct sockaddr_in6);
+	}
+#ifndef _WIN32
+	else if (proto == AF_UNIX)
+	{
+		/* addr is the path; port means nothing here */
+		struct sockaddr_un *addr_un = (struct sockaddr_un *) &saddr;
+
+		if (strlen(addr) >= sizeof(addr_un->sun_path))
+		{
+			mowgli_log("UNIX socket path is too long: %s", addr);
+			return NULL;
+		}
+
+		memset(addr_un, 0, sizeof *addr_un);
+		addr_un->sun_family = AF_UNIX;
+		mowgli_strlcpy(addr_un->sun_path, addr, sizeof(addr_un->sun_path));
+
+		memcpy(&naddr->addr, &saddr, sizeof(struct sockaddr_un));
+		naddr->addrlen = offsetof(struct sockaddr_un, sun_path) + strlen(addr) + 1;
+	}
+#endif
+	else
+	{
+		naddr = NULL;
+	}
+
+	return naddr;
+}
+
+mowgli_vio_sockaddr_t *
+mowgli_vio_sockaddr_from_struct(mowgli_vio_sockaddr_t *naddr, const void *addr, socklen_t size)
+{
+	const struct sockaddr_storage *saddr = addr;
+
+	return_val_if_fail(addr != NULL, NULL);
+#ifndef _WIN32
+	return_val_if_fail(saddr->ss_family == AF_INET || saddr->ss_family == AF_INET6 || saddr->ss_family == AF_UNIX, NULL);
+#else
+	return_val_if_fail(saddr->ss_family == AF_INET || saddr->ss_family == AF_INET6, NULL);
+#endif
+
+	if (naddr == NULL)
+		naddr = mowgli_alloc(sizeof *naddr);
+
+	memcpy(&naddr->addr, saddr, size);
+	naddr->addrlen = size;
+
+	return naddr;
+}
+
+int
+mowgli_vio_sockaddr_info(const mowgli_vio_sockaddr_t *addr, mowgli_vio_sockdata_t *data)
+{
+	const void *sockptr;
+
+	return_val_if_fail(addr, -255);
+	return_val_if_fail(data, -255);
+
+	const struct sockaddr *saddr = (const struct sockaddr *) &addr->addr;
+
+	if (saddr->sa_family == AF_INET)
+	{
+		const struct sockaddr_in *saddr4 = (const struct sockaddr_in *) &addr->addr;
+		data->port = ntohs(saddr4->sin_port);
+		sockptr = &saddr4->sin_addr;
+	}
+	else if (saddr->sa_family == AF_INET6)
+	{
+		const struct sockaddr_in6 *saddr6 = (const struct sockaddr_in6 *) &addr->addr;
 		data->port = ntohs(saddr6->sin6_port);
 		sockptr = &saddr6->sin6_addr;
 	}
+#ifndef _WIN32
+	else if (saddr->sa_family == AF_UNIX)
+	{
+		/* the path, if it fits; unnamed sockets have none */
+		const struct sockaddr_un *saddr_un = (const struct sockaddr_un *) &addr->addr;
+		size_t pathlen = 0;
+
+		if (addr->addrlen > offsetof(struct sockaddr_un, sun_path))
+			pathlen = strnlen(saddr_un->sun_path, addr->addrlen - offsetof(struct sockaddr_un, sun_path));
+
+		if (pathlen >= sizeof(data->host))
+			return -1;
+
+		memcpy(data->host, saddr_un->sun_path, pathlen);
+		data->host[pathlen] = '\0';
+		data->port = 0;
+
+		return 0;
+	}
+#endif
 	else
 	{
 		return -1;
@@ -496,3 +1371,157 @@ mowgli_vio_sockaddr_info(const mowgli_vio_sockaddr_t *addr, mowgli_vio_sockdata_
 
 	return 0;
 }
+
+/* Buffer sizes are left to the kernel's autotuning, which setting them
+ * turns off on Linux.
+ */
+static const mowgli_vio_sockopts_t mowgli_vio_sockopts_profiles[] =
+{
+	[MOWGLI_VIO_SOCKOPTS_DEFAULT] = { .nodelay = false },
+	[MOWGLI_VIO_SOCKOPTS_LATENCY] =
+	{
+		.nodelay = true,
+		.fastopen = 256,
+		.user_timeout = 60000,
+		.keepalive_idle = 60,
+		.keepalive_interval = 10,
+		.keepalive_count = 6,
+	},
+	[MOWGLI_VIO_SOCKOPTS_THROUGHPUT] =
+	{
+		.cork = true,
+		.user_timeout = 60000,
+		.keepalive_idle = 60,
+		.keepalive_interval = 10,
+		.keepalive_count = 6,
+	},
+};
+
+/* Options this kind of socket or this system does not know are skipped */
+static int
+mowgli_vio_setsockopt_int(int fd, int level, int name, int value)
+{
+	if (setsockopt(fd, level, name, (void *) &value, sizeof value) == 0)
+		return 0;
+
+	return ((errno == ENOPROTOOPT) || (errno == EOPNOTSUPP)) ? 0 : -1;
+}
+
+/* Leaves errno set on failure */
+static int
+mowgli_vio_sockopts_apply(int fd, const mowgli_vio_sockopts_t *opts, int type)
+{
+	if ((opts->sndbuf > 0) && (mowgli_vio_setsockopt_int(fd, SOL_SOCKET, SO_SNDBUF, opts->sndbuf) != 0))
+		return -1;
+
+	if ((opts->rcvbuf > 0) && (mowgli_vio_setsockopt_int(fd, SOL_SOCKET, SO_RCVBUF, opts->rcvbuf) != 0))
+		return -1;
+
+#ifdef SO_REUSEPORT
+	if (opts->reuseport && (mowgli_vio_setsockopt_int(fd, SOL_SOCKET, SO_REUSEPORT, 1) != 0))
+		return -1;
+#endif
+
+	if (type != SOCK_STREAM)
+		return 0;
+
+	if (opts->nodelay && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_NODELAY, 1) != 0))
+		return -1;
+
+#ifdef TCP_DEFER_ACCEPT
+	if ((opts->defer_accept > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, opts->defer_accept) != 0))
+		return -1;
+#endif
+
+#ifdef TCP_FASTOPEN
+	if ((opts->fastopen > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_FASTOPEN, opts->fastopen) != 0))
+		return -1;
+#endif
+
+#ifdef TCP_FASTOPEN_CONNECT
+	if (opts->fastopen_connect && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1) != 0))
+		return -1;
+#endif
+
+#ifdef TCP_USER_TIMEOUT
+	if ((opts->user_timeout > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, opts->user_timeout) != 0))
+		return -1;
+#endif
+
+	if ((opts->keepalive_idle > 0) || (opts->keepalive_interval > 0) || (opts->keepalive_count > 0))
+	{
+		if (mowgli_vio_setsockopt_int(fd, SOL_SOCKET, SO_KEEPALIVE, 1) != 0)
+			return -1;
+
+#if defined(TCP_KEEPIDLE)
+		if ((opts->keepalive_idle > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_KEEPIDLE, opts->keepalive_idle) != 0))
+			return -1;
+#elif defined(TCP_KEEPALIVE)
+		if ((opts->keepalive_idle > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_KEEPALIVE, opts->keepalive_idle) != 0))
+			return -1;
+#endif
+
+#ifdef TCP_KEEPINTVL
+		if ((opts->keepalive_interval > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_KEEPINTVL, opts->keepalive_interval) != 0))
+			return -1;
+#endif
+
+#ifdef TCP_KEEPCNT
+		if ((opts->keepalive_count > 0) && (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_KEEPCNT, opts->keepalive_count) != 0))
+			return -1;
+#endif
+	}
+
+	return 0;
+}
+
+int
+mowgli_vio_set_sockopts(mowgli_vio_t *vio, const mowgli_vio_sockopts_t *opts)
+{
+	int fd, type;
+	socklen_t len = sizeof type;
+
+	return_val_if_fail(vio != NULL, -255);
+
+	vio->sockopts = opts;
+
+	if ((opts == NULL) || ((fd = mowgli_vio_getfd(vio)) == -1))
+		return 0;
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_OTHER;
+
+	if ((getsockopt(fd, SOL_SOCKET, SO_TYPE, (void *) &type, &len) != 0) || (mowgli_vio_sockopts_apply(fd, opts, type) != 0))
+		return mowgli_vio_err_errcode(vio, strerror, errno);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return 0;
+}
+
+const mowgli_vio_sockopts_t *
+mowgli_vio_sockopts_profile(mowgli_vio_sockopts_profile_t profile)
+{
+	return_val_if_fail(profile <= MOWGLI_VIO_SOCKOPTS_THROUGHPUT, NULL);
+
+	return &mowgli_vio_sockopts_profiles[profile];
+}
+
+int
+mowgli_vio_cork(mowgli_vio_t *vio, bool cork)
+{
+	const int fd = mowgli_vio_getfd(vio);
+
+	return_val_if_fail(fd != -1, -255);
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_OTHER;
+
+#if defined(TCP_CORK)
+	if (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_CORK, cork) != 0)
+		return mowgli_vio_err_errcode(vio, strerror, errno);
+#elif defined(TCP_NOPUSH)
+	if (mowgli_vio_setsockopt_int(fd, IPPROTO_TCP, TCP_NOPUSH, cork) != 0)
+		return mowgli_vio_err_errcode(vio, strerror, errno);
+#endif
+
+	vio->error.op = MOWGLI_VIO_ERR_OP_NONE;
+	return 0;
+}